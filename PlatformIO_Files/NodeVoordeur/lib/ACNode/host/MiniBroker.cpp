@@ -0,0 +1,252 @@
+#include "MiniBroker.h"
+#include <HostBroker.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <algorithm>
+
+bool MiniBroker::begin(uint16_t port) {
+  _listen = socket(AF_INET, SOCK_STREAM, 0);
+  if (_listen < 0)
+    return false;
+  int one = 1;
+  setsockopt(_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in sa = {};
+  sa.sin_family = AF_INET;
+  sa.sin_port = htons(port);
+  sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(_listen, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(_listen, 1024) < 0) {
+    close(_listen);
+    _listen = -1;
+    return false;
+  };
+  _thread = std::thread([this]() { run(); });
+  return true;
+}
+
+void MiniBroker::end() {
+  _stop = true;
+  if (_thread.joinable())
+    _thread.join();
+  for (auto &c : _conns)
+    close(c.fd);
+  _conns.clear();
+  if (_listen >= 0)
+    close(_listen);
+  _listen = -1;
+}
+
+// Blocking writes; a slow subscriber holds up everyone, as it would
+// hold up a single threaded broker. Good enough on loopback.
+//
+void MiniBroker::send(conn_t &c, const std::vector<uint8_t> &packet) {
+  size_t at = 0;
+  while (c.fd >= 0 && at < packet.size()) {
+    ssize_t n = ::send(c.fd, packet.data() + at, packet.size() - at, MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      struct pollfd p = { c.fd, POLLOUT, 0 };
+      poll(&p, 1, 100);
+      continue;
+    };
+    if (n <= 0) {
+      close(c.fd);
+      c.fd = -1;
+      return;
+    };
+    at += n;
+  };
+}
+
+void MiniBroker::route(const std::string &topic, const std::vector<uint8_t> &packet) {
+  published++;
+  for (auto &c : _conns) {
+    if (!c.connected)
+      continue;
+    for (auto &f : c.subscriptions)
+      if (HostBroker::matches(f.c_str(), topic.c_str())) {
+        send(c, packet);
+        delivered++;
+        break;
+      };
+  };
+}
+
+static void put16(std::vector<uint8_t> &b, uint16_t v) {
+  b.push_back(v >> 8);
+  b.push_back(v & 0xFF);
+}
+
+static std::vector<uint8_t> packet(uint8_t header, const std::vector<uint8_t> &body) {
+  std::vector<uint8_t> pkt(1, header);
+  size_t len = body.size();
+  do {
+    uint8_t d = len % 128;
+    len /= 128;
+    pkt.push_back(len ? d | 0x80 : d);
+  } while (len);
+  pkt.insert(pkt.end(), body.begin(), body.end());
+  return pkt;
+}
+
+bool MiniBroker::handle(conn_t &c, uint8_t header, const uint8_t *body, size_t len) {
+  switch (header >> 4) {
+  case 1: { // CONNECT
+    if (len < 12)
+      return false;
+    size_t at = 2 + ((body[0] << 8) | body[1]) + 4; // name, level, flags, keepalive
+    if (at + 2 > len)
+      return false;
+    size_t idlen = (body[at] << 8) | body[at + 1];
+    c.id.assign((const char *)body + at + 2, std::min(idlen, len - at - 2));
+    // Same client id kicks out the old one.
+    for (auto &o : _conns)
+      if (&o != &c && o.connected && o.id == c.id) {
+        close(o.fd);
+        o.fd = -1;
+      };
+    c.connected = true;
+    send(c, { 0x20, 0x02, 0x00, 0x00 });
+    return true;
+  };
+  case 3: { // PUBLISH
+    if (len < 2)
+      return false;
+    size_t tlen = (body[0] << 8) | body[1];
+    if (2 + tlen > len)
+      return false;
+    std::string topic((const char *)body + 2, tlen);
+    size_t at = 2 + tlen;
+    uint8_t qos = (header >> 1) & 3;
+    if (qos) {
+      // Acked; but passed on at QoS 0 like the rest.
+      if (at + 2 > len)
+        return false;
+      send(c, { 0x40, 0x02, body[at], body[at + 1] });
+      at += 2;
+    };
+    std::vector<uint8_t> out;
+    put16(out, tlen);
+    out.insert(out.end(), topic.begin(), topic.end());
+    out.insert(out.end(), body + at, body + len);
+    std::vector<uint8_t> pkt = packet(0x30, out);
+    if (header & 1) {
+      _retained.erase(std::remove_if(_retained.begin(), _retained.end(),
+                                     [&](const retained_t &r) { return r.topic == topic; }),
+                      _retained.end());
+      if (at < len)
+        _retained.push_back({ topic, packet(0x31, out) });
+    };
+    route(topic, pkt);
+    return true;
+  };
+  case 8: { // SUBSCRIBE
+    if (len < 2)
+      return false;
+    std::vector<uint8_t> ack(body, body + 2);
+    for (size_t at = 2; at + 2 <= len;) {
+      size_t flen = (body[at] << 8) | body[at + 1];
+      if (at + 2 + flen + 1 > len)
+        return false;
+      std::string filter((const char *)body + at + 2, flen);
+      if (std::find(c.subscriptions.begin(), c.subscriptions.end(), filter) == c.subscriptions.end())
+        c.subscriptions.push_back(filter);
+      ack.push_back(0);
+      at += 2 + flen + 1;
+      for (auto &r : _retained)
+        if (HostBroker::matches(filter.c_str(), r.topic.c_str()))
+          send(c, r.packet);
+    };
+    send(c, packet(0x90, ack));
+    return true;
+  };
+  case 10: { // UNSUBSCRIBE
+    if (len < 2)
+      return false;
+    for (size_t at = 2; at + 2 <= len;) {
+      size_t flen = (body[at] << 8) | body[at + 1];
+      std::string filter((const char *)body + at + 2, std::min(flen, len - at - 2));
+      c.subscriptions.erase(std::remove(c.subscriptions.begin(), c.subscriptions.end(), filter), c.subscriptions.end());
+      at += 2 + flen;
+    };
+    send(c, { 0xB0, 0x02, body[0], body[1] });
+    return true;
+  };
+  case 12: // PINGREQ
+    send(c, { 0xD0, 0x00 });
+    return true;
+  case 14: // DISCONNECT
+    return false;
+  default:
+    return true;
+  };
+}
+
+void MiniBroker::run() {
+  std::vector<struct pollfd> fds;
+  while (!_stop) {
+    fds.clear();
+    fds.push_back({ _listen, POLLIN, 0 });
+    for (auto &c : _conns)
+      fds.push_back({ c.fd, POLLIN, 0 });
+    if (poll(fds.data(), fds.size(), 50) <= 0)
+      continue;
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(_listen, NULL, NULL);
+      if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        _conns.push_back({ fd, "", {}, {}, false });
+      };
+    };
+
+    for (size_t i = 1; i < fds.size(); i++) {
+      if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      conn_t &c = _conns[i - 1];
+      if (c.fd < 0)
+        continue;
+      uint8_t buf[4096];
+      ssize_t n = recv(c.fd, buf, sizeof(buf), MSG_DONTWAIT);
+      if (n <= 0) {
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+          continue;
+        close(c.fd);
+        c.fd = -1;
+        continue;
+      };
+      c.rx.insert(c.rx.end(), buf, buf + n);
+
+      // Whole packets only; the rest waits for more data.
+      for (;;) {
+        size_t len = 0, mult = 1, at = 1;
+        bool complete = false;
+        for (; at < c.rx.size() && at <= 4; at++) {
+          len += (c.rx[at] & 0x7F) * mult;
+          mult *= 128;
+          if (!(c.rx[at] & 0x80)) {
+            complete = true;
+            break;
+          };
+        };
+        if (!complete || c.rx.size() < at + 1 + len)
+          break;
+        bool ok = handle(c, c.rx[0], c.rx.data() + at + 1, len);
+        c.rx.erase(c.rx.begin(), c.rx.begin() + at + 1 + len);
+        if (!ok && c.fd >= 0) {
+          close(c.fd);
+          c.fd = -1;
+        };
+        if (c.fd < 0)
+          break;
+      };
+    };
+    _conns.erase(std::remove_if(_conns.begin(), _conns.end(), [](const conn_t &c) { return c.fd < 0; }), _conns.end());
+  };
+}
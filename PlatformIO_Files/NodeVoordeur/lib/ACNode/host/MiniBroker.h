@@ -0,0 +1,47 @@
+#ifndef _H_MINIBROKER
+#define _H_MINIBROKER
+
+// Just enough of an MQTT 3.1.1 broker (QoS 0, retained messages, '+'
+// and '#') for acnode-load to run without a mosquitto; it runs in its
+// own thread. Routing as in the in-process HostBroker.
+//
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MiniBroker {
+public:
+  bool begin(uint16_t port);
+  void end();
+  int listen_fd() { return _listen; }
+
+  std::atomic<unsigned long> published { 0 }, delivered { 0 };
+
+private:
+  struct conn_t {
+    int fd;
+    std::string id;
+    std::vector<uint8_t> rx;
+    std::vector<std::string> subscriptions;
+    bool connected;
+  };
+  struct retained_t {
+    std::string topic;
+    std::vector<uint8_t> packet;
+  };
+
+  void run();
+  bool handle(conn_t &c, uint8_t header, const uint8_t *body, size_t len);
+  void route(const std::string &topic, const std::vector<uint8_t> &packet);
+  void send(conn_t &c, const std::vector<uint8_t> &packet);
+
+  int _listen = -1;
+  std::atomic<bool> _stop { false };
+  std::thread _thread;
+  std::vector<conn_t> _conns;
+  std::vector<retained_t> _retained;
+};
+
+#endif
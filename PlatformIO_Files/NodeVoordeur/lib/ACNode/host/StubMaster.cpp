@@ -0,0 +1,451 @@
+#include "StubMaster.h"
+
+#include <Crypto.h>
+#include <Curve25519.h>
+#include <Ed25519.h>
+#include <ChaChaPoly.h>
+#include <SHA256.h>
+#include <base64.hpp>
+#include <stdarg.h>
+#include <time.h>
+
+void StubMaster::begin(PubSubClient &client, const char *seed) {
+  _client = &client;
+
+  // An Ed25519 private key is just 32 random bytes.
+  SHA256 sha256;
+  sha256.reset();
+  sha256.update(seed, strlen(seed));
+  sha256.finalize(_private, sizeof(_private));
+  Ed25519::derivePublicKey(_public, _private);
+  encode_base64(_public, sizeof(_public), (unsigned char *)_public_b64);
+
+  // The private half is only needed for SIG/3; the only cloaks we open.
+  Curve25519::dh1(_session_public, _session_private);
+  encode_base64(_session_public, sizeof(_session_public), (unsigned char *)_session_public_b64);
+
+  _client->setCallback([this](char *topic, uint8_t *payload, unsigned int len) { on_message(topic, payload, len); });
+  std::string all = _prefix + "/#";
+  _client->subscribe(all.c_str());
+}
+
+void StubMaster::loop() {
+  // Drain what is there; then verify it in one go and answer it in order.
+  size_t before;
+  do {
+    before = _pending.size();
+    _client->loop();
+  } while (_pending.size() != before && _pending.size() < 256);
+
+  if (_batch && _verify)
+    verify_pending();
+
+  std::vector<pending_t> pending;
+  pending.swap(_pending);
+  for (auto & m : pending)
+    handle(m.node.c_str(), &m.payload[0], m.verified);
+}
+
+static void hmac(const uint8_t key[32], const char *label, const char *msg, uint8_t out[32]) {
+  SHA256 sha256;
+  sha256.resetHMAC(key, 32);
+  if (label)
+    sha256.update(label, strlen(label));
+  if (msg)
+    sha256.update(msg, strlen(msg));
+  sha256.finalizeHMAC(key, 32, out, 32);
+}
+
+// As the node does it; SHA256 of the shared secret, then a key per direction.
+static void session_keys(const uint8_t node_pubsession[32], const uint8_t master_private[32], uint8_t to_master[32], uint8_t from_master[32], uint8_t cloak[32]) {
+  uint8_t k[32], priv[32];
+  memcpy(k, node_pubsession, sizeof(k));
+  memcpy(priv, master_private, sizeof(priv));
+  Curve25519::dh2(k, priv);
+
+  SHA256 sha256;
+  sha256.reset();
+  sha256.update(k, sizeof(k));
+  sha256.finalize(k, sizeof(k));
+
+  hmac(k, "SIG/3 node to master", NULL, to_master);
+  hmac(k, "SIG/3 master to node", NULL, from_master);
+  hmac(k, "SIG/3 cloak", NULL, cloak);
+}
+
+// ccp.<base64 of a 12 byte nonce, the tag, a 16 byte Poly1305 tag>; bound to
+// "<cmd> <node> <target>". The tag goes in plain, if given; for checking the
+// audit events.
+//
+// See protocol.txt; the beat of the request may trail that of the cloak
+// by the time it sat in the publish queue and its retransmits.
+#define CLOAK_MAX_AGE (10)
+
+static bool uncloak(const uint8_t key[32], const char *cloaked, const char *cmd, const char *node, const char *target, unsigned long beat, std::string *plain_out = nullptr) {
+  if (strncmp(cloaked, "ccp.", 4))
+    return false;
+  unsigned int len = decode_base64_length((unsigned char *)cloaked + 4);
+  if (len <= 12 + 16 || len > 256)
+    return false;
+  uint8_t buff[256], plain[256];
+  decode_base64((unsigned char *)cloaked + 4, buff);
+
+  unsigned long sealed = ((unsigned long)buff[0] << 24) | (buff[1] << 16) | (buff[2] << 8) | buff[3];
+  if (beat < sealed || beat - sealed > CLOAK_MAX_AGE)
+    return false;
+
+  char aad[256];
+  snprintf(aad, sizeof(aad), "%s %s %s %lu", cmd, node, target, sealed);
+  ChaChaPoly cipher;
+  cipher.setKey(key, 32);
+  cipher.setIV(buff, 12);
+  cipher.addAuthData(aad, strlen(aad));
+  cipher.decrypt(plain, buff + 12, len - 12 - 16);
+  if (!cipher.checkTag(buff + len - 16, 16))
+    return false;
+  if (plain_out)
+    plain_out->assign((char *)plain, len - 12 - 16);
+  return true;
+}
+
+void StubMaster::reply(const char *node, const char *fmt, ...) {
+  char rest[512];
+  int n = snprintf(rest, sizeof(rest), "%lu ", (unsigned long)time(NULL));
+
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(rest + n, sizeof(rest) - n, fmt, ap);
+  va_end(ap);
+
+  char payload[640], topic[128];
+  auto it = _nodes.find(node);
+  if (it != _nodes.end() && it->second.sig3 && strncmp(fmt, "welcome", 7) && strncmp(fmt, "trust", 5)) {
+    uint8_t mac[32];
+    char mac_b64[48];
+    hmac(it->second.mac_from_master, NULL, rest, mac);
+    encode_base64(mac, sizeof(mac), (unsigned char *)mac_b64);
+    snprintf(payload, sizeof(payload), "SIG/3.0 %s %s", mac_b64, rest);
+  } else {
+    uint8_t signature[64];
+    char signature_b64[100];
+    Ed25519::sign(signature, _private, _public, rest, strlen(rest));
+    encode_base64(signature, sizeof(signature), (unsigned char *)signature_b64);
+    snprintf(payload, sizeof(payload), "SIG/2.0 %s %s", signature_b64, rest);
+  };
+  snprintf(topic, sizeof(topic), "%s/%s/%s", _prefix.c_str(), node, _name.c_str());
+  _client->publish(topic, payload);
+  if (_duplicate)
+    _client->publish(topic, payload);
+}
+
+// "trust <nonce> <peer> <key>"; always signed, as it (re)keys.
+void StubMaster::vouch(const char *node, const char *nonce, const char *peer) {
+  char b64[48];
+  encode_base64(_nodes[peer].pubsign.key, 32, (unsigned char *)b64);
+  reply(node, "trust %s %s %s", nonce, peer, b64);
+  trusts++;
+}
+
+void StubMaster::on_message(char *topic, uint8_t *payload, unsigned int len) {
+  const char *t = topic + _prefix.size() + 1;
+  if (strncmp(topic, _prefix.c_str(), _prefix.size()) || topic[_prefix.size()] != '/') {
+    other++;
+    return;
+  };
+
+  const char *slash = strchr(t, '/');
+  std::string first = slash ? std::string(t, slash - t) : std::string(t);
+  const char *node = slash ? slash + 1 : "";
+
+  if (first != _name) {
+    if (!strcmp(node, _name.c_str()))
+      from_master++;
+    else if (first == "log")
+      logs++;
+    else
+      other++;
+    return;
+  };
+  if (!strcmp(node, _name.c_str())) {
+    // A broadcast; ours or another master its.
+    other++;
+    return;
+  };
+  to_master++;
+
+  if (len > MQTT_MAX_PACKET_SIZE) {
+    bad++;
+    return;
+  };
+  _pending.push_back({ node, std::string((char *)payload, len), false });
+}
+
+static char *token(char **p) {
+  while (**p == ' ')
+    (*p)++;
+  if (!**p)
+    return NULL;
+  char *tok = *p;
+  while (**p && **p != ' ')
+    (*p)++;
+  if (**p)
+    *(*p)++ = 0;
+  return tok;
+}
+
+// The SIG/2 signatures of known nodes; as one batch. If that fails
+// handle() checks them one by one as usual.
+//
+void StubMaster::verify_pending() {
+  std::vector<uint8_t> signatures(_pending.size() * 64);
+  std::vector<const uint8_t *> sigs, keys;
+  std::vector<const void *> msgs;
+  std::vector<size_t> lens;
+  std::vector<pending_t *> which;
+
+  // Leave out nodes that (re)announce in this batch; their key may change.
+  auto is_announce = [](const std::string &payload) {
+    const char *c = payload.c_str();
+    for (int i = 0; i < 3 && c; i++) {
+      c = strchr(c, ' ');
+      while (c && *c == ' ')
+        c++;
+    };
+    return c && !strncmp(c, "announce", 8);
+  };
+  std::map<std::string, bool> announcing;
+  for (auto & m : _pending)
+    if (is_announce(m.payload))
+      announcing[m.node] = true;
+
+  for (auto & m : _pending) {
+    const char *p = m.payload.c_str();
+    if (strncmp(p, "SIG/2", 5) || announcing.count(m.node))
+      continue;
+    auto it = _nodes.find(m.node);
+    if (it == _nodes.end())
+      continue;
+
+    // Same split as handle(); version, signature, then the signed rest.
+    const char *s = strchr(p, ' ');
+    while (s && *s == ' ')
+      s++;
+    const char *e = s ? strchr(s, ' ') : NULL;
+    if (!e || e - s > 100)
+      continue;
+    char b64[101];
+    memcpy(b64, s, e - s);
+    b64[e - s] = 0;
+    if (decode_base64_length((unsigned char *)b64) != 64)
+      continue;
+    while (*e == ' ')
+      e++;
+
+    uint8_t *sig = &signatures[sigs.size() * 64];
+    decode_base64((unsigned char *)b64, sig);
+    sigs.push_back(sig);
+    keys.push_back(it->second.pubsign.key);
+    msgs.push_back(e);
+    lens.push_back(strlen(e));
+    which.push_back(&m);
+  };
+  if (sigs.size() < 2)
+    return;
+
+  if (!Ed25519::verifyBatch(sigs.data(), keys.data(), msgs.data(), lens.data(), sigs.size())) {
+    batches_failed++;
+    return;
+  };
+  for (auto m : which)
+    m->verified = true;
+  batches++;
+  batched += sigs.size();
+}
+
+// SIG/2.0 <signature> <beat> <cmd> <args..>; the signature is over
+// everything after it. SIG/3.0 <hmac> ..; likewise, under the session.
+//
+void StubMaster::handle(const char *node, char *payload, bool verified) {
+  char *p = payload;
+  char *version = token(&p);
+  char *signature_b64 = token(&p);
+  bool sig3 = version && !strncmp(version, "SIG/3", 5);
+  if (!version || (!sig3 && strncmp(version, "SIG/2", 5)) || !signature_b64 ||
+      decode_base64_length((unsigned char *)signature_b64) != (sig3 ? 32 : 64)) {
+    bad++;
+    return;
+  };
+  while (*p == ' ')
+    p++;
+  char *rest = p;
+  size_t rest_len = strlen(rest);
+
+  uint8_t signature[64];
+  decode_base64((unsigned char *)signature_b64, signature);
+
+  char tmp[MQTT_MAX_PACKET_SIZE + 1];
+  strcpy(tmp, rest);
+  p = tmp;
+  char *beat = token(&p);
+  char *cmd = token(&p);
+  if (!beat || !cmd) {
+    bad++;
+    return;
+  };
+
+  if (!strcmp(cmd, "announce") && !sig3) {
+    char *ip = token(&p);
+    char *pubsign_b64 = token(&p);
+    char *pubsession_b64 = token(&p);
+    char *nonce = token(&p);
+    if (!ip || !pubsign_b64 || !pubsession_b64 || !nonce || decode_base64_length((unsigned char *)pubsign_b64) != 32) {
+      bad++;
+      return;
+    };
+    node_t n;
+    uint8_t pubsign[32];
+    decode_base64((unsigned char *)pubsign_b64, pubsign);
+    if (_verify && (!Ed25519::prepareVerifyKey(n.pubsign, pubsign) || !Ed25519::verify(signature, n.pubsign, rest, rest_len))) {
+      bad++;
+      return;
+    };
+    char *offer = token(&p);
+    n.sig3 = offer && !strcmp(offer, "SIG/3.0") && decode_base64_length((unsigned char *)pubsession_b64) == 32;
+    if (n.sig3) {
+      uint8_t pubsession[32];
+      decode_base64((unsigned char *)pubsession_b64, pubsession);
+      session_keys(pubsession, _session_private, n.mac_to_master, n.mac_from_master, n.cloak);
+    };
+    _nodes[node] = n;
+    announces++;
+
+    reply(node, "welcome 127.0.0.1 %s %s %s%s", _public_b64, _session_public_b64, nonce, n.sig3 ? " SIG/3.0" : "");
+    // Tells acnode-load the node can now verify what we send it.
+    reply(node, "loadgen ready");
+
+    // Anyone who asked for this node its key before it was here.
+    auto waiting = _awaiting.equal_range(node);
+    for (auto w = waiting.first; w != waiting.second; ++w)
+      vouch(w->second.first.c_str(), w->second.second.c_str(), node);
+    _awaiting.erase(waiting.first, waiting.second);
+    return;
+  };
+
+  auto it = _nodes.find(node);
+  if (it == _nodes.end() || (sig3 && !it->second.sig3)) {
+    bad++;
+    return;
+  };
+  if (sig3) {
+    uint8_t mac[32];
+    hmac(it->second.mac_to_master, NULL, rest, mac);
+    if (!secure_compare(mac, signature, sizeof(mac))) {
+      bad++;
+      return;
+    };
+  } else if (_verify && !verified && !Ed25519::verify(signature, it->second.pubsign, rest, rest_len)) {
+    bad++;
+    return;
+  };
+
+  if (!strcmp(cmd, "pubkey")) {
+    char *nonce = token(&p);
+    char *peer = token(&p);
+    if (!nonce || !peer) {
+      bad++;
+      return;
+    };
+    if (_nodes.count(peer))
+      vouch(node, nonce, peer);
+    else
+      _awaiting.insert({ peer, { node, nonce } });
+    return;
+  };
+
+  // The key of the audit tags; cloaked as a tag would be. It outlives
+  // the session; a real master keeps it with the node its keys.
+  if (!strcmp(cmd, "auditkey")) {
+    char *from = token(&p);
+    char *target = token(&p);
+    char *tag = token(&p);
+    std::string key;
+    if (!from || !target || !tag) {
+      bad++;
+      return;
+    };
+    if (!it->second.sig3)
+      return;
+    if (!uncloak(it->second.cloak, tag, cmd, from, target, strtoul(beat, NULL, 10), &key) ||
+        decode_base64_length((unsigned char *)key.c_str()) != sizeof(it->second.audit)) {
+      bad_cloaks++;
+      return;
+    };
+    decode_base64((unsigned char *)key.c_str(), it->second.audit);
+    it->second.has_audit = true;
+    audit_keys++;
+    return;
+  };
+
+  // event <what> <device> <beat> <tag mac>; the tag should be that of the
+  // last request we saw from the node.
+  if (!strcmp(cmd, "event")) {
+    char *what = token(&p);
+    char *device = token(&p);
+    char *when = token(&p);
+    char *mac = token(&p);
+    if (!what || !device || !when || !mac) {
+      bad++;
+      return;
+    };
+    events++;
+    if (!it->second.has_audit || it->second.last_tag.empty())
+      return;
+    uint8_t digest[32];
+    char hex[17];
+    SHA256 sha256;
+    sha256.resetHMAC(it->second.audit, sizeof(it->second.audit));
+    sha256.update("audit ", 6);
+    sha256.update(it->second.last_tag.c_str(), it->second.last_tag.size());
+    sha256.finalizeHMAC(it->second.audit, sizeof(it->second.audit), digest, sizeof(digest));
+    for (int i = 0; i < 8; i++)
+      snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+    if (!strcmp(hex, mac))
+      events_resolved++;
+    return;
+  };
+
+  if (!strcmp(cmd, "energize") || !strcmp(cmd, "open")) {
+    char *from = token(&p);
+    char *target = token(&p);
+    char *tag = token(&p);
+    if (!from || !target || !tag) {
+      bad++;
+      return;
+    };
+    if (it->second.sig3 && !uncloak(it->second.cloak, tag, cmd, from, target, strtoul(beat, NULL, 10), &it->second.last_tag)) {
+      bad_cloaks++;
+      return;
+    };
+    requests++;
+    if (_split && strchr(target, ',')) {
+      std::vector<char *> devices;
+      for (char *dev = strtok(target, ","); dev; dev = strtok(NULL, ","))
+        devices.push_back(dev);
+      for (auto dev = devices.rbegin(); dev != devices.rend(); ++dev) {
+        bool ok = (unsigned int)(random() % 100) >= _deny;
+        if (ok)
+          approved++;
+        else
+          denied++;
+        reply(node, "%s %s %s %s", ok ? "approved" : "denied", cmd, *dev, beat);
+      };
+      return;
+    };
+    bool ok = (unsigned int)(random() % 100) >= _deny;
+    if (ok)
+      approved++;
+    else
+      denied++;
+    reply(node, "%s %s %s %s", ok ? "approved" : "denied", cmd, target, beat);
+  };
+}
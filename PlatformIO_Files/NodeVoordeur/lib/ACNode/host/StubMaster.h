@@ -0,0 +1,79 @@
+#ifndef _H_STUBMASTER
+#define _H_STUBMASTER
+
+// The master side of SIG/2 (and SIG/3, the session MAC, for nodes that
+// offer it); just enough to welcome nodes, answer their approval requests
+// and vouch for the keys of their peers (pubkey/trust). Signs with an
+// Ed25519 key derived from a seed; so nodes that did TOFU on an earlier
+// run keep trusting it.
+// Used by acnode-load; not a replacement for the real master.
+//
+#include <PubSubClient.h>
+#include <Ed25519.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class StubMaster {
+public:
+  StubMaster(const char *prefix = "ac", const char *name = "master") : _prefix(prefix), _name(name) {};
+
+  void begin(PubSubClient &client, const char *seed);
+  void loop();
+
+  void set_deny(unsigned int percent) { _deny = percent; };
+  void set_verify(bool verify) { _verify = verify; };
+  // Verify what came in since the last loop() as one Ed25519 batch.
+  void set_batch(bool batch) { _batch = batch; };
+  // Publish every reply twice; as a broker redelivering would.
+  void set_duplicate(bool duplicate) { _duplicate = duplicate; };
+  // Answer a request for a list of devices (dev1,dev2) one device at a
+  // time, last one first; each with its own outcome. Rather than once.
+  void set_split(bool split) { _split = split; };
+
+  // Every message seen on <prefix>/#; by what it is.
+  unsigned long to_master = 0, from_master = 0, logs = 0, other = 0;
+  unsigned long announces = 0, requests = 0, approved = 0, denied = 0, bad = 0;
+  unsigned long batches = 0, batched = 0, batches_failed = 0, bad_cloaks = 0;
+  unsigned long trusts = 0;
+  // Audit keys received; audit events, and those whose tag matched the
+  // last request of the node (SIG/3 only; we can only open those cloaks).
+  unsigned long audit_keys = 0, events = 0, events_resolved = 0;
+
+private:
+  struct node_t {
+    Ed25519::VerifyKey pubsign;
+    bool sig3 = false;
+    uint8_t mac_to_master[32], mac_from_master[32], cloak[32];
+    uint8_t audit[32];
+    bool has_audit = false;
+    std::string last_tag;
+  };
+
+  struct pending_t {
+    std::string node, payload;
+    bool verified;
+  };
+
+  void on_message(char *topic, uint8_t *payload, unsigned int len);
+  void verify_pending();
+  void handle(const char *node, char *payload, bool verified);
+  void vouch(const char *node, const char *nonce, const char *peer);
+  void reply(const char *node, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+  PubSubClient *_client = nullptr;
+  std::string _prefix, _name;
+  uint8_t _private[32], _public[32], _session_private[32], _session_public[32];
+  char _public_b64[48], _session_public_b64[48];
+  unsigned int _deny = 0;
+  bool _verify = true;
+  bool _batch = true;
+  bool _duplicate = false;
+  bool _split = false;
+  std::vector<pending_t> _pending;
+  std::map<std::string, node_t> _nodes;
+  // pubkey requests for nodes not yet announced; peer -> (node, nonce).
+  std::multimap<std::string, std::pair<std::string, std::string>> _awaiting;
+};
+
+#endif
@@ -0,0 +1,529 @@
+// Micro benchmarks of the crypto on the message path; what a node spends
+// per message to or from the master. Host numbers; a node its ESP32 is a
+// lot slower, but the ratios between the cases are what matter.
+//
+//   acnode-bench [-n iterations] [case ..]
+//
+// Without a case all are run.
+//
+#include <Arduino.h>
+#include <Crypto.h>
+#include <Ed25519.h>
+#include <SHA256.h>
+#include <BLAKE2s.h>
+#include <AES.h>
+#include <CBC.h>
+#include <GCM.h>
+#include <ChaChaPoly.h>
+#include <RNG.h>
+#include <base64.hpp>
+#include <ACNode.h>
+#include <ACBase.h>
+#include <ACReport.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <functional>
+
+static unsigned long iterations = 1000;
+
+// Heap allocations; counted per case. Through malloc() with glibc (which
+// operator new ends up in too); elsewhere only operator new.
+//
+static unsigned long allocs = 0;
+#ifdef __GLIBC__
+extern "C" void * __libc_malloc(size_t n);
+extern "C" void * malloc(size_t n) { allocs++; return __libc_malloc(n); }
+#else
+void * operator new(size_t n) { allocs++; void * p = malloc(n); if (!p) throw std::bad_alloc(); return p; }
+void operator delete(void * p) noexcept { free(p); }
+void operator delete(void * p, size_t) noexcept { free(p); }
+#endif
+
+// Typical approval request; as signed, so after the version and signature.
+static const char msg[] = "1697635201 energize front-door door 12-34-56-78 "
+  "wPh6dJ5sXuFQPp0j1lK2FQ== 1697635201";
+
+static uint8_t privsign[32], pubsign[32], signature[64];
+static Ed25519::VerifyKey verifykey;
+static uint8_t session[32], mac[32];
+
+static void hmac(const uint8_t key[32], const char * m, uint8_t out[32]) {
+  SHA256 sha256;
+  sha256.resetHMAC(key, 32);
+  sha256.update(m, strlen(m));
+  sha256.finalizeHMAC(key, 32, out, 32);
+}
+
+static volatile bool sink;
+
+// The tag cloaks of SIG2::cloak(); SIG/2 (CBC, PKCS#7, two base64
+// encodes) and SIG/3 (ChaChaPoly, one encode); and AES-GCM for comparison.
+// Same tag, same context. The IV is a counter here; the node takes
+// it from RNG.rand(), which is timed on its own (rng-rand-16).
+//
+static const char tag[] = "04-a2-2b-6a-3c-5e-80";
+static const char context[] = "energize front-door door";
+static char cloaked[256];
+static uint64_t iv_counter = 0;
+
+static void cloak_cbc() {
+  CBC<AES256> cipher;
+  uint8_t iv[16] = { 0 };
+  memcpy(iv, &++iv_counter, sizeof(iv_counter));
+  cipher.setKey(session, cipher.keySize());
+  cipher.setIV(iv, cipher.ivSize());
+
+  size_t len = strlen(tag);
+  int pad = 16 - (len % 16);
+  size_t paddedlen = len + pad;
+  uint8_t input[paddedlen], output[paddedlen], output_b64[paddedlen * 4 / 3 + 4], iv_b64[32];
+  strcpy((char *)input, tag);
+  for (int i = 0; i < pad; i++)
+    input[len + i] = pad;
+  cipher.encrypt(output, input, paddedlen);
+  encode_base64(iv, sizeof(iv), iv_b64);
+  encode_base64(output, paddedlen, output_b64);
+  snprintf(cloaked, sizeof(cloaked), "%s.%s", iv_b64, output_b64);
+}
+
+static void cloak_chachapoly() {
+  ChaChaPoly cipher;
+  size_t len = strlen(tag);
+  uint8_t buff[12 + len + 16];
+  memset(buff, 0, 4); // The beat.
+  memcpy(buff + 4, &++iv_counter, 8);
+  cipher.setKey(session, 32);
+  cipher.setIV(buff, 12);
+  cipher.addAuthData(context, strlen(context));
+  cipher.encrypt(buff + 12, (const uint8_t *)tag, len);
+  cipher.computeTag(buff + 12 + len, 16);
+  strcpy(cloaked, "ccp.");
+  encode_base64(buff, sizeof(buff), (unsigned char *)cloaked + 4);
+}
+
+static void cloak_gcm() {
+  GCM<AES256> cipher;
+  size_t len = strlen(tag);
+  uint8_t buff[12 + len + 16];
+  memset(buff, 0, 4); // The beat.
+  memcpy(buff + 4, &++iv_counter, 8);
+  cipher.setKey(session, cipher.keySize());
+  cipher.setIV(buff, 12);
+  cipher.addAuthData(context, strlen(context));
+  cipher.encrypt(buff + 12, (const uint8_t *)tag, len);
+  cipher.computeTag(buff + 12 + len, 16);
+  strcpy(cloaked, "gcm.");
+  encode_base64(buff, sizeof(buff), (unsigned char *)cloaked + 4);
+}
+
+struct bench_t {
+  const char * name;
+  std::function<void()> fn;
+  unsigned int ops; // Signatures/messages per call; the times are per one.
+};
+
+// A burst from one signer (the master after a reconnect); and from several.
+#define BATCH (8)
+static char batch_text[BATCH][sizeof(msg)];
+static uint8_t batch_sigs[2 * BATCH][64], batch_pubs[BATCH][32];
+static const uint8_t * batch_sig_ptrs[2 * BATCH];
+static const uint8_t * batch_one_key[BATCH];
+static const uint8_t * batch_keys[BATCH];
+static const void * batch_msgs[BATCH];
+static size_t batch_lens[BATCH];
+
+static void batch_setup() {
+  for (int i = 0; i < BATCH; i++) {
+    uint8_t priv[32];
+    strcpy(batch_text[i], msg);
+    batch_text[i][9] = '0' + i; // Different beat.
+    batch_msgs[i] = batch_text[i];
+    batch_lens[i] = strlen(batch_text[i]);
+
+    Ed25519::sign(batch_sigs[i], privsign, pubsign, batch_text[i], batch_lens[i]);
+    batch_one_key[i] = pubsign;
+
+    Ed25519::generatePrivateKey(priv);
+    Ed25519::derivePublicKey(batch_pubs[i], priv);
+    Ed25519::sign(batch_sigs[BATCH + i], priv, batch_pubs[i], batch_text[i], batch_lens[i]);
+    batch_keys[i] = batch_pubs[i];
+  };
+  for (int i = 0; i < 2 * BATCH; i++)
+    batch_sig_ptrs[i] = batch_sigs[i];
+}
+
+// The helo nonce of SIG2::populate_nonce(); as it was (SHA-256 over the
+// runtime seed, both public keys and a fresh RNG draw) and as it is
+// (keyed BLAKE2s of a counter). Both base64 encoded.
+//
+static uint8_t nonce_key[32];
+static uint64_t nonce_counter = 0;
+static char nonce[48];
+
+static void nonce_sha256() {
+  uint8_t raw[32];
+  SHA256 sha256;
+  sha256.reset();
+  sha256.update(nonce_key, sizeof(nonce_key));
+  sha256.update(pubsign, sizeof(pubsign));
+  sha256.update(session, sizeof(session));
+  RNG.rand(raw, sizeof(raw));
+  sha256.update(raw, sizeof(raw));
+  sha256.finalize(raw, sizeof(raw));
+  encode_base64(raw, sizeof(raw), (unsigned char *)nonce);
+}
+
+static void nonce_blake2s() {
+  uint8_t raw[32];
+  BLAKE2s blake2s;
+  blake2s.reset(nonce_key, sizeof(nonce_key), sizeof(raw));
+  nonce_counter++;
+  blake2s.update("c", 1);
+  blake2s.update(&nonce_counter, sizeof(nonce_counter));
+  blake2s.finalize(raw, sizeof(raw));
+  encode_base64(raw, sizeof(raw), (unsigned char *)nonce);
+}
+
+// Topics; per message to and from the master. As it was: send() did an
+// snprintf() of prefix/master/moi and a strdup() for the publish queue;
+// SIG2::verify() found the sender with rindex() and strcmp()s against
+// the master and each trusted node. As it is: a real ACNode, with the
+// topics of two trusted nodes interned as SIG2 does; lookup_topic() on
+// the inbound topic, and send() of a raw message on the interned topic
+// and on a copy of it. Those two run through loop() until the publish
+// queue is empty; so queueing, the ACRequest and the publish into the
+// in-process broker. Raw, so not signed; that is the crypto above.
+//
+// Filled in at run time; as the node its are. So nothing gets folded.
+static char prefix[16], master[32], moi[32], trusted_nodes[2][32], inbound_topic[128], outbound_topic[128];
+static ACNode * node;
+extern int items_in_publish_queue;
+
+static void topics_setup() {
+  strcpy(prefix, "ac");
+  strcpy(master, "master");
+  strcpy(moi, "front-door");
+  strcpy(trusted_nodes[0], "door-reader");
+  strcpy(trusted_nodes[1], "door-display");
+  snprintf(inbound_topic, sizeof(inbound_topic), "%s/%s/%s", prefix, moi, master);
+  snprintf(outbound_topic, sizeof(outbound_topic), "%s/%s/%s", prefix, master, moi);
+
+  setenv("ACNODE_STATE", "./acnode-bench", 0);
+  Serial.enabled = false;
+  node = new ACNode(moi);
+  node->set_mqtt_host("memory");
+  node->set_mqtt_prefix(prefix);
+  node->set_master(master);
+  node->set_moi(moi);
+  for (auto & n : trusted_nodes) {
+    char t[128];
+    snprintf(t, sizeof(t), "%s/%s/%s", prefix, moi, n);
+    node->intern_topic(t);
+  };
+  node->begin();
+  for (unsigned long start = millis(); !node->isUp() && millis() - start < 5000;)
+    node->loop();
+  while (items_in_publish_queue && node->isUp())
+    node->loop();
+}
+
+static void topic_send_snprintf() {
+  char t[128];
+  snprintf(t, sizeof(t), "%s/%s/%s", prefix, master, moi);
+  char * q = strdup(t);
+  sink = q[0];
+  free(q);
+}
+
+static void topic_match_rindex() {
+  const char * sender = rindex(inbound_topic, '/') + 1;
+  bool isMaster = !strcmp(master, sender);
+  if (!isMaster)
+    for (auto & n : trusted_nodes)
+      if (!strcmp(sender, n))
+        break;
+  sink = isMaster;
+}
+
+static void node_send(const char * topic) {
+  node->send(topic, msg, true);
+  while (items_in_publish_queue)
+    node->loop();
+}
+
+// ACRequest; one buffer with views into it (ACBase.h). Parsed as SIG2
+// does an inbound reply; version, beat and cmd, with rest the tail of
+// the payload. And against it the fixed layout that handlers of old get
+// (ACLegacyRequest); expanded and stored back.
+static char inbound_payload[MAX_MSG];
+static ACRequest parsed;
+
+static void request_parse(ACRequest * req) {
+  req->set_topic(inbound_topic);
+  req->set_payload(inbound_payload);
+  const char * p = req->payload();
+  const char * q = strchr(p, ' ');
+  req->set_version(p, q - p);
+  p = strchr(q + 1, ' ') + 1; // Past the signature.
+  q = strchr(p, ' ');
+  req->set_beat(p, q - p);
+  p = q + 1;
+  q = strchr(p, ' ');
+  req->set_cmd(p, q - p);
+  req->set_rest(q + 1);
+}
+
+static void request_setup() {
+  snprintf(inbound_payload, sizeof(inbound_payload), "SIG/2.0 %.88s %s",
+    "Zm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFyZm9vYmFy", msg);
+  request_parse(&parsed);
+}
+
+// The periodic report through ACReport; the fields send_report() writes,
+// as JSON (the log) and as MessagePack (telemetry). In full; and as a
+// delta on the one before, in which just the beat, loop rate and free
+// heap moved. The handlers their fields are left out.
+static char report_buff[MAX_MSG];
+static ACReport::History report_history;
+static unsigned long report_seq = 0;
+
+static size_t report(ACReport::encoding_t encoding, bool delta) {
+  ACReport r(report_buff, sizeof(report_buff), encoding);
+  r["node"] = moi;
+  if (delta) {
+    r["seq"] = report_seq;
+    r["full"] = false;
+    r.track(&report_history, report_history.empty());
+  };
+  report_seq++;
+  r["machine"] = "door";
+  r["maxMqtt"] = MAX_MSG;
+  r["id"] = "a4cf12f3e2b1";
+  r["ip"] = "10.11.0.42";
+  r["net"] = "UTP";
+  r["mac"] = "A4:CF:12:F3:E2:B1";
+  r["beat"] = 1697635201UL + report_seq;
+  r["alive-uptime"] = 86400UL + report_seq;
+  r["approve"] = 1234;
+  r["deny"] = 56;
+  r["requests"] = 1290;
+  r["retransmits"] = 3;
+  r["duplicates"] = 0;
+  r["cache_hit"] = 17;
+  r["cache_miss"] = 2;
+  r["outbox_depth"] = 0;
+  r["outbox_queued"] = 4;
+  r["outbox_replayed"] = 4;
+  r["outbox_dropped"] = 0;
+  r["mqtt_reconnects"] = 1;
+  r["sessions_resumed"] = 1;
+  r["loop_rate"] = 1000.0 + (report_seq % 7);
+  r["coreTemp"] = 41.5;
+  r["heap_free"] = 180000UL - (report_seq % 64) * 16;
+  r["slowest"] = "mqtt";
+  r["slowest_avg_us"] = 412UL;
+  r["slowest_max_us"] = 9120UL;
+  r["sched_late_avg_ms"] = 1UL;
+  r["sched_late_max_ms"] = 12UL;
+  r.finish();
+  return r.length();
+}
+
+static const bench_t benches[] = {
+  { "ed25519-sign", []() { Ed25519::sign(signature, privsign, pubsign, msg, strlen(msg)); }, 1 },
+  { "ed25519-verify", []() { sink = Ed25519::verify(signature, pubsign, msg, strlen(msg)); }, 1 },
+  { "ed25519-verify-prepared", []() { sink = Ed25519::verify(signature, verifykey, msg, strlen(msg)); }, 1 },
+  { "ed25519-prepare", []() { sink = Ed25519::prepareVerifyKey(verifykey, pubsign); }, 1 },
+  { "ed25519-batch-one-key", []() {
+    sink = Ed25519::verifyBatch(batch_sig_ptrs, batch_one_key, batch_msgs, batch_lens, BATCH);
+  }, BATCH },
+  { "ed25519-batch-8-keys", []() {
+    sink = Ed25519::verifyBatch(batch_sig_ptrs + BATCH, batch_keys, batch_msgs, batch_lens, BATCH);
+  }, BATCH },
+  { "rng-rand-16", []() { uint8_t b[16]; RNG.rand(b, sizeof(b)); sink = b[0]; }, 1 },
+  { "nonce-sha256-rng", nonce_sha256, 1 },
+  { "nonce-blake2s-ctr", nonce_blake2s, 1 },
+  { "topic-send-snprintf", topic_send_snprintf, 1 },
+  { "topic-match-rindex", topic_match_rindex, 1 },
+  { "topic-lookup", []() { sink = node->lookup_topic(inbound_topic) == ACNode::TOPIC_FROM_MASTER; }, 1 },
+  { "node-send-interned", []() { node_send(node->topic(ACNode::TOPIC_TO_MASTER)); }, 1 },
+  { "node-send-copied", []() { node_send(outbound_topic); }, 1 },
+  { "request-parse", []() { ACRequest * r = new ACRequest(); request_parse(r); sink = r->used(); delete r; }, 1 },
+  { "request-legacy", []() { ACLegacyRequest * l = new ACLegacyRequest(&parsed); sink = l->store(&parsed); delete l; }, 1 },
+  { "report-json-full", []() { sink = report(ACReport::JSON, false); }, 1 },
+  { "report-json-delta", []() { sink = report(ACReport::JSON, true); }, 1 },
+  { "report-msgpack-full", []() { sink = report(ACReport::MSGPACK, false); }, 1 },
+  { "report-msgpack-delta", []() { sink = report(ACReport::MSGPACK, true); }, 1 },
+  { "cloak-cbc", cloak_cbc, 1 },
+  { "cloak-chachapoly", cloak_chachapoly, 1 },
+  { "cloak-gcm", cloak_gcm, 1 },
+  { "hmac-sha256-mac", []() { hmac(session, msg, mac); }, 1 },
+  { "hmac-sha256-verify", []() {
+    uint8_t m[32];
+    hmac(session, msg, m);
+    sink = secure_compare(m, mac, sizeof(m));
+  }, 1 },
+};
+
+static void run(const bench_t & b) {
+  // One untimed round; so lazy setup does not count.
+  b.fn();
+  unsigned long a0 = allocs;
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; i++)
+    b.fn();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+  double ops = (double) iterations * b.ops;
+  printf("%-24s %10lu %12.0f ns/op %10.0f op/s %8.2f allocs/op\n", b.name, iterations, ns / ops, ops * 1e9 / ns,
+    (allocs - a0) / ops);
+}
+
+static void usage(const char * prog) {
+  fprintf(stderr, "Usage: %s [-n iterations] [case ..]\n\tcases:", prog);
+  for (auto & b : benches)
+    fprintf(stderr, " %s", b.name);
+  fprintf(stderr, "\n");
+  exit(1);
+}
+
+int main(int argc, char ** argv) {
+  int c;
+  while ((c = getopt(argc, argv, "n:")) != -1) {
+    switch (c) {
+    case 'n': iterations = strtoul(optarg, NULL, 10); break;
+    default: usage(argv[0]);
+    };
+  };
+  if (iterations == 0)
+    usage(argv[0]);
+
+  // RFC 8032 section 7.1, test 1; sign() and derivePublicKey() have to
+  // match it exactly, whichever way they multiply by the base point.
+  {
+    static const uint8_t priv[32] = {
+      0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60, 0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+      0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19, 0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60 };
+    static const uint8_t pub[32] = {
+      0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7, 0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+      0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25, 0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a };
+    static const uint8_t sig[64] = {
+      0xe5, 0x56, 0x43, 0x00, 0xc3, 0x60, 0xac, 0x72, 0x90, 0x86, 0xe2, 0xcc, 0x80, 0x6e, 0x82, 0x8a,
+      0x84, 0x87, 0x7f, 0x1e, 0xb8, 0xe5, 0xd9, 0x74, 0xd8, 0x73, 0xe0, 0x65, 0x22, 0x49, 0x01, 0x55,
+      0x5f, 0xb8, 0x82, 0x15, 0x90, 0xa3, 0x3b, 0xac, 0xc6, 0x1e, 0x39, 0x70, 0x1c, 0xf9, 0xb4, 0x6b,
+      0xd2, 0x5b, 0xf5, 0xf0, 0x59, 0x5b, 0xbe, 0x24, 0x65, 0x51, 0x41, 0x43, 0x8e, 0x7a, 0x10, 0x0b };
+    uint8_t p[32], s[64];
+    Ed25519::derivePublicKey(p, priv);
+    Ed25519::sign(s, priv, p, "", 0);
+    if (memcmp(p, pub, sizeof(p)) || memcmp(s, sig, sizeof(s)) || !Ed25519::verify(s, p, "", 0)) {
+      fprintf(stderr, "Ed25519 does not match the RFC 8032 test vector\n");
+      return 2;
+    };
+  }
+
+  Ed25519::generatePrivateKey(privsign);
+  Ed25519::derivePublicKey(pubsign, privsign);
+  Ed25519::sign(signature, privsign, pubsign, msg, strlen(msg));
+  Ed25519::prepareVerifyKey(verifykey, pubsign);
+
+  // Both verify paths have to agree; on fresh keys and signatures, and
+  // with a bit flipped in the signature or the message.
+  for (int i = 0; i < 64; i++) {
+    uint8_t priv[32], pub[32], sig[64];
+    char m[sizeof(msg)];
+    Ed25519::generatePrivateKey(priv);
+    Ed25519::derivePublicKey(pub, priv);
+    Ed25519::sign(sig, priv, pub, msg, strlen(msg));
+    strcpy(m, msg);
+    if (i % 3 == 1)
+      sig[i % 64] ^= 1 << (i % 8);
+    if (i % 3 == 2)
+      m[i % strlen(m)] ^= 1;
+
+    Ed25519::VerifyKey k;
+    Ed25519::prepareVerifyKey(k, pub);
+    bool plain = Ed25519::verify(sig, pub, m, strlen(m));
+    if (Ed25519::verify(sig, k, m, strlen(m)) != plain || plain != (i % 3 == 0)) {
+      fprintf(stderr, "prepared and plain Ed25519 verify disagree (round %d)\n", i);
+      return 2;
+    };
+  };
+
+  // And a batch has to pass exactly when every signature in it does.
+  batch_setup();
+  for (int i = -1; i < 2 * BATCH; i++) {
+    uint8_t saved = 0;
+    if (i >= 0) {
+      saved = batch_sigs[i][i % 64];
+      batch_sigs[i][i % 64] ^= 0x10;
+    };
+    bool one = Ed25519::verifyBatch(batch_sig_ptrs, batch_one_key, batch_msgs, batch_lens, BATCH);
+    bool many = Ed25519::verifyBatch(batch_sig_ptrs + BATCH, batch_keys, batch_msgs, batch_lens, BATCH);
+    if (one != (i < 0 || i >= BATCH) || many != (i < BATCH)) {
+      fprintf(stderr, "batch verify gets a batch wrong (signature %d damaged)\n", i);
+      return 2;
+    };
+    if (i >= 0)
+      batch_sigs[i][i % 64] = saved;
+  };
+
+  for (size_t i = 0; i < sizeof(session); i++)
+    session[i] = esp_random();
+  RNG.rand(nonce_key, sizeof(nonce_key));
+  hmac(session, msg, mac);
+  topics_setup();
+  if (!node->isUp()) {
+    fprintf(stderr, "ACNode did not connect to the in-process broker\n");
+    return 2;
+  };
+  for (auto & n : trusted_nodes) {
+    char t[128];
+    snprintf(t, sizeof(t), "%s/%s/%s", prefix, moi, n);
+    if (node->lookup_topic(t) < ACNode::TOPIC_FIRST_FREE || node->lookup_topic(inbound_topic) != ACNode::TOPIC_FROM_MASTER) {
+      fprintf(stderr, "ACNode::lookup_topic() does not find the interned topics\n");
+      return 2;
+    };
+  };
+  request_setup();
+
+  // A view on the tail of another (rest on the payload) has to survive
+  // that one being rewritten in place, or prefixed in place.
+  {
+    ACRequest a, b;
+    a.set_payload("approved energize door 1234");
+    a.set_rest(a.payload() + 9);
+    a.set_payload("denied energize lathe 99");
+    b.set_payload("approved energize door 1234");
+    b.set_rest(b.payload() + 9);
+    b.prepend_payload("SIG/2.0 ");
+    if (strcmp(a.rest(), "energize door 1234") || strcmp(b.rest(), "energize door 1234") ||
+        strcmp(b.payload(), "SIG/2.0 approved energize door 1234")) {
+      fprintf(stderr, "ACRequest views get overwritten: <%s> <%s>\n", a.rest(), b.rest());
+      return 2;
+    };
+  }
+
+  printf("ACRequest: %zu bytes (on the heap per request), a reply uses %zu of its buffer; ACLegacyRequest: %zu bytes\n",
+    sizeof(ACRequest), parsed.used(), sizeof(ACLegacyRequest));
+
+  {
+    size_t json = report(ACReport::JSON, false), msgpack = report(ACReport::MSGPACK, false);
+    report(ACReport::JSON, true);
+    size_t json_delta = report(ACReport::JSON, true);
+    report_history.reset();
+    report(ACReport::MSGPACK, true);
+    size_t msgpack_delta = report(ACReport::MSGPACK, true);
+    report_history.reset();
+    printf("report: JSON %zu bytes, delta %zu; MessagePack %zu bytes, delta %zu\n", json, json_delta, msgpack, msgpack_delta);
+  }
+
+  printf("%-24s %10s %15s %13s %17s\n", "case", "iterations", "time", "rate", "heap");
+  for (auto & b : benches) {
+    bool selected = optind >= argc;
+    for (int i = optind; i < argc; i++)
+      selected |= !strcmp(argv[i], b.name);
+    if (selected)
+      run(b);
+  };
+  return 0;
+}
@@ -0,0 +1,78 @@
+// A bare ACNode on the host; wired, SIG2, with the MQTT log stream. Runs
+// for a while and then prints the loop profile. Mostly a smoke test of
+// the shim; and the place to start when poking at the message path.
+//
+//   acnode-host [-m machine] [-b broker[:port]] [-t seconds] [-q]
+//
+// The broker defaults to "memory"; the in-process one. Set $ACNODE_MAC
+// and $ACNODE_STATE to run several of these side by side.
+//
+#include <ACNode.h>
+#include <Profile.h>
+#include <unistd.h>
+
+static const char * machine = NULL; // node-<chipid>; see $ACNODE_MAC.
+static const char * broker = "memory";
+static unsigned long runtime = 30;
+
+ACNode node = ACNode();
+MqttLogStream mqttlogStream = MqttLogStream();
+
+static void usage(const char * prog) {
+  fprintf(stderr, "Usage: %s [-m machine] [-b broker[:port]] [-t seconds] [-q]\n", prog);
+  exit(1);
+}
+
+int main(int argc, char ** argv) {
+  int c;
+  while ((c = getopt(argc, argv, "m:b:t:q")) != -1) {
+    switch (c) {
+    case 'm': machine = optarg; break;
+    case 'b': broker = optarg; break;
+    case 't': runtime = strtoul(optarg, NULL, 10); break;
+    case 'q': Serial.enabled = false; break;
+    default: usage(argv[0]);
+    };
+  };
+
+  char host[MAX_HOST];
+  strncpy(host, broker, sizeof(host) - 1);
+  host[sizeof(host) - 1] = 0;
+  char * port = strrchr(host, ':');
+  if (port) {
+    *port++ = 0;
+    node.set_mqtt_port(atoi(port));
+  };
+  node.set_mqtt_host(host);
+  node.set_mqtt_prefix("ac");
+  node.set_master("master");
+  if (machine)
+    node.set_machine(machine);
+
+  node.onConnect([]() {
+    Log.println("Connected");
+  });
+  node.onDisconnect([]() {
+    Log.println("Disconnected");
+  });
+  node.onApproval([](const char * m) {
+    Log.printf("Approved: %s\n", m);
+  });
+  node.onDenied([](const char * m) {
+    Log.printf("Denied: %s\n", m);
+  });
+
+  Log.addPrintStream(std::make_shared<MqttLogStream>(mqttlogStream));
+
+  node.begin();
+
+  unsigned long start = millis();
+  while (runtime == 0 || millis() - start < runtime * 1000) {
+    node.loop();
+    delay(1);
+  };
+
+  Serial.enabled = true;
+  profileLog(Serial);
+  return 0;
+}
@@ -0,0 +1,357 @@
+// Load generator; a fleet of simulated nodes against one broker and a
+// stub master. Each node is the real ACNode code (helo, approvals with
+// retransmits, periodic reports, the MQTT log stream); swiping a random
+// tag every interval. Reports approval latency percentiles and the
+// message rates seen on the broker.
+//
+//   acnode-load [-n nodes] [-t seconds] [-i interval-ms] [-r report-s]
+//               [-d deny-%] [-b broker[:port]] [-B] [-s statedir] [-V] [-3] [-1] [-T] [-D] [-M] [-S]
+//
+// -B runs a minimal broker in this process (on the -b port) for when
+// there is no mosquitto around. -V skips verifying the signatures at
+// the master. -3 has the nodes offer SIG/3; the session MAC. -1 has the
+// master verify each message on its own rather than in batches. -T pairs
+// the nodes up (0 and 1, 2 and 3, ..); each trusts its peer and sends it
+// a signed message with every swipe. -D has the master send everything
+// twice; the nodes should drop the copies before verifying them. -M gives
+// every node two devices, asked for in one request (set_multi_target());
+// -S has the master answer those one device at a time, last one first.
+//
+// ACNode is a singleton (_acnode, Log, the cache/outbox/SIG2 state);
+// so every node is a forked worker process and reports back over a
+// pipe. The stub master and the bookkeeping run in the parent.
+//
+#include <ACNode.h>
+#include <Profile.h>
+#include "MiniBroker.h"
+#include "StubMaster.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <vector>
+
+static unsigned int nodes = 10;
+static unsigned long runtime = 30;
+static unsigned long interval = 2000;
+static unsigned long report_period = 60;
+static unsigned int deny = 0;
+static char host[MAX_HOST] = "localhost";
+static uint16_t port = 1883;
+static const char * statedir = "./acnode-load";
+static bool embedded_broker = false;
+static bool verify = true;
+static bool batch = true;
+static acnode_proto_t proto = PROTO_SIG2;
+static bool peers = false;
+static bool duplicate = false;
+static bool multi = false;
+static bool split = false;
+
+#define REPLY_TIMEOUT (5000) // mSeconds; then count it as lost and swipe again.
+
+// What a worker tells the parent; one record per event.
+typedef struct {
+  enum { READY, LATENCY, DENIED_LATENCY, REQUEST, TIMEOUT, PEER, TRUST_HIT, TRUST_MISS, TRUST_REQUESTS, REPLAY_DUPLICATES,
+    DEVICE, EXTRA_DEVICE, EXITED } what;
+  uint32_t value;
+} record_t;
+
+static int report_fd = -1;
+
+static void emit(int what, uint32_t value) {
+  record_t r = { (decltype(r.what)) what, value };
+  if (write(report_fd, &r, sizeof(r)) != sizeof(r))
+    _exit(2);
+}
+
+static void worker(unsigned int i, unsigned long deadline) {
+  char buff[128];
+  snprintf(buff, sizeof(buff), "02:ac:%02x:00:%02x:%02x", (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+  setenv("ACNODE_MAC", buff, 1);
+  snprintf(buff, sizeof(buff), "%s/%03u", statedir, i);
+  setenv("ACNODE_STATE", buff, 1);
+  Serial.enabled = false;
+
+  static unsigned long start = millis(), t0 = 0, next_swipe = 0;
+  static bool ready = false, pending = false, denied = false;
+  // Devices answered for the request pending; one callback each.
+  static unsigned int answered = 0, expected = 1;
+  static bool answered_dev[2];
+
+  static char peer[MAX_NAME] = "", peer_topic[MAX_TOPIC];
+  if (peers && (i ^ 1) < nodes)
+    snprintf(peer, sizeof(peer), "load-%03u", i ^ 1);
+
+  snprintf(buff, sizeof(buff), "load-%03u", i);
+  snprintf(peer_topic, sizeof(peer_topic), "ac/%s/%s", peer, buff);
+  ACNode * node = new ACNode(buff, true, multi ? "dev1" : NULL, multi ? "dev2" : NULL, proto);
+  node->set_multi_target(multi);
+  expected = multi ? 2 : 1;
+  node->set_mqtt_host(host);
+  node->set_mqtt_port(port);
+  node->set_mqtt_prefix("ac");
+  node->set_master("master");
+  node->set_report_period(report_period * 1000);
+  node->set_report_delta(true);
+
+  if (*peer)
+    node->add_trusted_node(peer);
+
+  node->onValidatedCmd([](const char * cmd, const char * rest) {
+    if (!strcmp(cmd, "peer")) {
+      emit(record_t::PEER, 0);
+      return ACNode::CMD_CLAIMED;
+    };
+    if (strcmp(cmd, "loadgen"))
+      return ACNode::CMD_DECLINE;
+    if (!ready)
+      emit(record_t::READY, millis() - start);
+    ready = true;
+    next_swipe = millis() + random() % interval;
+    return ACNode::CMD_CLAIMED;
+  });
+  // The reply is complete once each device had its callback; a second
+  // one for the same device, or one with nothing pending, is extra.
+  static auto answer = [](const char * machine, bool approved) {
+    int d = (multi && !strcmp(machine, "dev2")) ? 1 : 0;
+    if (!pending || answered_dev[d]) {
+      emit(record_t::EXTRA_DEVICE, 0);
+      return;
+    };
+    emit(record_t::DEVICE, 0);
+    answered_dev[d] = true;
+    denied |= !approved;
+    if (++answered < expected)
+      return;
+    emit(denied ? record_t::DENIED_LATENCY : record_t::LATENCY, micros() - t0);
+    pending = false;
+  };
+  node->onApproval([](const char * machine) { answer(machine, true); });
+  node->onDenied([](const char * machine) { answer(machine, false); });
+
+  Log.addPrintStream(std::make_shared<MqttLogStream>());
+  node->begin();
+
+  while (millis() < deadline) {
+    node->loop();
+
+    if (pending && micros() - t0 > REPLY_TIMEOUT * 1000UL) {
+      emit(record_t::TIMEOUT, 0);
+      pending = false;
+    };
+    if (ready && !pending && millis() >= next_swipe) {
+      char tag[32];
+      snprintf(tag, sizeof(tag), "%u-%u-%u-%u", (unsigned)(random() & 0xFF),
+        (unsigned)(random() & 0xFF), (unsigned)(random() & 0xFF), (unsigned)(random() & 0xFF));
+      emit(record_t::REQUEST, 0);
+      pending = true;
+      denied = false;
+      answered = 0;
+      answered_dev[0] = answered_dev[1] = false;
+      t0 = micros();
+      node->request_approval_devices(tag, "energize", NULL, false);
+      if (*peer)
+        node->send(peer_topic, "peer");
+      // Uniform around the interval; so the nodes do not swipe in lock step.
+      next_swipe = millis() + interval / 2 + random() % (interval + 1);
+    };
+    delay(1);
+  };
+  extern unsigned long trustHit, trustMiss, trustRequests;
+  emit(record_t::TRUST_HIT, trustHit);
+  emit(record_t::TRUST_MISS, trustMiss);
+  emit(record_t::TRUST_REQUESTS, trustRequests);
+  extern unsigned long replayDuplicates;
+  emit(record_t::REPLAY_DUPLICATES, replayDuplicates);
+  emit(record_t::EXITED, 0);
+  _exit(0);
+}
+
+static double percentile(std::vector<uint32_t> & v, double p) {
+  if (v.empty())
+    return 0;
+  size_t i = std::min(v.size() - 1, (size_t)(p / 100.0 * v.size()));
+  return v[i] / 1000.0;
+}
+
+static void usage(const char * prog) {
+  fprintf(stderr, "Usage: %s [-n nodes] [-t seconds] [-i interval-ms] [-r report-s] "
+    "[-d deny-%%] [-b broker[:port]] [-B] [-s statedir] [-V] [-3] [-1] [-T] [-D] [-M] [-S]\n", prog);
+  exit(1);
+}
+
+int main(int argc, char ** argv) {
+  int c;
+  while ((c = getopt(argc, argv, "n:t:i:r:d:b:Bs:V31TDMS")) != -1) {
+    switch (c) {
+    case 'n': nodes = strtoul(optarg, NULL, 10); break;
+    case 't': runtime = strtoul(optarg, NULL, 10); break;
+    case 'i': interval = strtoul(optarg, NULL, 10); break;
+    case 'r': report_period = strtoul(optarg, NULL, 10); break;
+    case 'd': deny = strtoul(optarg, NULL, 10); break;
+    case 'b': {
+      strncpy(host, optarg, sizeof(host) - 1);
+      char * p = strrchr(host, ':');
+      if (p) {
+        *p++ = 0;
+        port = atoi(p);
+      };
+      break;
+    };
+    case 'B': embedded_broker = true; break;
+    case 's': statedir = optarg; break;
+    case 'V': verify = false; break;
+    case '3': proto = PROTO_SIG3; break;
+    case '1': batch = false; break;
+    case 'T': peers = true; break;
+    case 'D': duplicate = true; break;
+    case 'M': multi = true; break;
+    case 'S': split = true; break;
+    default: usage(argv[0]);
+    };
+  };
+  if (nodes == 0 || interval == 0)
+    usage(argv[0]);
+
+  MiniBroker broker;
+  if (embedded_broker && !broker.begin(port)) {
+    fprintf(stderr, "Cannot listen on port %u: %s\n", port, strerror(errno));
+    exit(1);
+  };
+
+  PubSubClient client;
+  StubMaster master;
+  client.setServer(host, port);
+  if (!client.connect("master")) {
+    fprintf(stderr, "Cannot connect to the broker at %s:%u (state %d)\n", host, port, client.state());
+    exit(1);
+  };
+  master.set_deny(deny);
+  master.set_verify(verify);
+  master.set_batch(batch);
+  master.set_duplicate(duplicate);
+  master.set_split(split);
+  master.begin(client, "acnode-load");
+
+  // Workers swipe until the deadline; the first few seconds go on boot.
+  unsigned long start = millis();
+  unsigned long deadline = start + runtime * 1000;
+  std::vector<int> fds;
+  std::vector<pid_t> pids;
+  for (unsigned int i = 0; i < nodes; i++) {
+    int p[2];
+    if (pipe(p) < 0) {
+      perror("pipe");
+      exit(1);
+    };
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      exit(1);
+    };
+    if (pid == 0) {
+      close(p[0]);
+      if (broker.listen_fd() >= 0)
+        close(broker.listen_fd());
+      for (int fd : fds)
+        close(fd);
+      report_fd = p[1];
+      srandom(getpid());
+      worker(i, deadline);
+    };
+    close(p[1]);
+    fds.push_back(p[0]);
+    pids.push_back(pid);
+  };
+
+  std::vector<uint32_t> latency, ready;
+  unsigned long requests = 0, denied = 0, timeouts = 0, exited = 0, crashed = 0;
+  unsigned long peer_msgs = 0, trust_hit = 0, trust_miss = 0, trust_requests = 0;
+  unsigned long replay_duplicates = 0, device_callbacks = 0, extra_callbacks = 0;
+  size_t open = fds.size();
+  std::vector<struct pollfd> pfds;
+  for (int fd : fds)
+    pfds.push_back({ fd, POLLIN, 0 });
+
+  while (open > 0) {
+    master.loop();
+    if (poll(pfds.data(), pfds.size(), 1) <= 0)
+      continue;
+    for (auto & pfd : pfds) {
+      if (pfd.fd < 0 || !(pfd.revents & (POLLIN | POLLHUP)))
+        continue;
+      record_t r;
+      ssize_t n = read(pfd.fd, &r, sizeof(r));
+      if (n != sizeof(r)) {
+        close(pfd.fd);
+        pfd.fd = -1;
+        open--;
+        continue;
+      };
+      switch (r.what) {
+      case record_t::READY: ready.push_back(r.value); break;
+      case record_t::DENIED_LATENCY: denied++; // fall through
+      case record_t::LATENCY: latency.push_back(r.value); break;
+      case record_t::REQUEST: requests++; break;
+      case record_t::TIMEOUT: timeouts++; break;
+      case record_t::PEER: peer_msgs++; break;
+      case record_t::TRUST_HIT: trust_hit += r.value; break;
+      case record_t::TRUST_MISS: trust_miss += r.value; break;
+      case record_t::TRUST_REQUESTS: trust_requests += r.value; break;
+      case record_t::REPLAY_DUPLICATES: replay_duplicates += r.value; break;
+      case record_t::DEVICE: device_callbacks++; break;
+      case record_t::EXTRA_DEVICE: extra_callbacks++; break;
+      case record_t::EXITED: exited++; break;
+      };
+    };
+  };
+  for (pid_t pid : pids) {
+    int status;
+    if (waitpid(pid, &status, 0) == pid && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+      crashed++;
+  };
+  double secs = (millis() - start) / 1000.0;
+
+  std::sort(latency.begin(), latency.end());
+  std::sort(ready.begin(), ready.end());
+
+  printf("%u nodes, %.1f s; %lu ready, %lu exited cleanly, %lu failed\n", nodes, secs,
+    (unsigned long) ready.size(), exited, crashed);
+  if (!ready.empty())
+    printf("ready after (ms): p50 %.0f p90 %.0f max %.0f\n",
+      percentile(ready, 50) * 1000, percentile(ready, 90) * 1000, ready.back() * 1.0);
+  printf("requests %lu, replies %lu (%lu denied), timeouts %lu, at master %lu (retransmits %ld)\n",
+    requests, (unsigned long) latency.size(), denied, timeouts, master.requests, (long) master.requests - (long) requests);
+  printf("approval latency (ms): p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f max %.2f\n",
+    percentile(latency, 50), percentile(latency, 90), percentile(latency, 99), percentile(latency, 99.9),
+    latency.empty() ? 0.0 : latency.back() / 1000.0);
+  printf("broker (msg/s): to master %.1f, from master %.1f, log %.1f, other %.1f; %.1f replies/s\n",
+    master.to_master / secs, master.from_master / secs, master.logs / secs, master.other / secs,
+    latency.size() / secs);
+  if (master.batches || master.batches_failed)
+    printf("master verified %lu message(s) in %lu batch(es); %lu batch(es) failed\n",
+      master.batched, master.batches, master.batches_failed);
+  if (peers)
+    printf("peer messages accepted %lu; trust store hit %lu, miss %lu; %lu pubkey request(s), master vouched %lu time(s)\n",
+      peer_msgs, trust_hit, trust_miss, trust_requests, master.trusts);
+  if (multi)
+    printf("device callbacks %lu, extra %lu\n", device_callbacks, extra_callbacks);
+  if (master.audit_keys || master.events)
+    printf("master got %lu audit key(s); %lu audit event(s), %lu resolved to their tag\n",
+      master.audit_keys, master.events, master.events_resolved);
+  if (replay_duplicates)
+    printf("nodes dropped %lu duplicate(s) before verifying\n", replay_duplicates);
+  if (master.bad_cloaks)
+    printf("master could not open %lu cloaked tag(s)\n", master.bad_cloaks);
+  if (master.bad)
+    printf("master rejected %lu malformed or badly signed message(s)\n", master.bad);
+
+  client.disconnect();
+  broker.end();
+  return crashed ? 1 : 0;
+}
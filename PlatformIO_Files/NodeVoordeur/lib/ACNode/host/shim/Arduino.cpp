@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+#include <random>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const auto boot = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+uint32_t esp_random() {
+  static std::random_device rd;
+  return rd();
+}
+
+// Pins just remember what was written; inputs read as pulled up.
+//
+static uint8_t pins[64];
+static bool pinsInit = false;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (!pinsInit) {
+    memset(pins, HIGH, sizeof(pins));
+    pinsInit = true;
+  };
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < sizeof(pins))
+    pins[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  if (!pinsInit)
+    pinMode(pin, INPUT);
+  return pin < sizeof(pins) ? pins[pin] : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode) {}
+void detachInterrupt(uint8_t pin) {}
+
+// Exit code 3 tells a supervisor (or the load generator) that the node
+// asked for a reboot rather than crashed.
+//
+void EspClass::restart() {
+  fflush(stdout);
+  exit(3);
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return 200 * 1024;
+}
+
+extern "C" uint8_t temprature_sens_read() {
+  // Fahrenheit; as the ROM function.
+  return 128;
+}
@@ -0,0 +1,168 @@
+#pragma once
+// Host (Linux) shim of the parts of the Arduino/ESP32 core that ACNode
+// uses; see host/README.md. Timing, flash and networking are mimicked as
+// far as ACNode can tell the difference; hardware (GPIO, SPI) is not.
+//
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <math.h>
+#include <string>
+#include <functional>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define ARDUINO 10800
+class __FlashStringHelper;
+#define F(s) ((const __FlashStringHelper *)(s))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define MSBFIRST 1
+#define LSBFIRST 0
+#define HEX 16
+#define DEC 10
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#ifndef _min
+#define _min(a,b) ((a)<(b)?(a):(b))
+#endif
+#ifndef _max
+#define _max(a,b) ((a)>(b)?(a):(b))
+#endif
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+uint32_t esp_random();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+class String {
+public:
+  String() {}
+  String(const char *s) : s_(s ? s : "") {}
+  String(const std::string &s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v, int base = 10) { char b[40]; snprintf(b, sizeof(b), base == 16 ? "%x" : "%d", v); s_ = b; }
+  String(unsigned int v, int base = 10) { char b[40]; snprintf(b, sizeof(b), base == 16 ? "%x" : "%u", v); s_ = b; }
+  String(long v, int base = 10) { char b[40]; snprintf(b, sizeof(b), base == 16 ? "%lx" : "%ld", v); s_ = b; }
+  String(unsigned long v, int base = 10) { char b[40]; snprintf(b, sizeof(b), base == 16 ? "%lx" : "%lu", v); s_ = b; }
+  String(double v, unsigned int d = 2) { char b[40]; snprintf(b, sizeof(b), "%.*f", d, v); s_ = b; }
+  const char *c_str() const { return s_.c_str(); }
+  unsigned int length() const { return s_.length(); }
+  String substring(unsigned int a) const { return String(s_.substr(std::min<size_t>(a, s_.size()))); }
+  String substring(unsigned int a, unsigned int b) const { return String(s_.substr(std::min<size_t>(a, s_.size()), b - a)); }
+  int indexOf(char c) const { size_t i = s_.find(c); return i == std::string::npos ? -1 : (int)i; }
+  bool startsWith(const String &o) const { return s_.compare(0, o.s_.size(), o.s_) == 0; }
+  bool equals(const String &o) const { return s_ == o.s_; }
+  char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+  String operator+(const String &o) const { return String(s_ + o.s_); }
+  String &operator+=(const String &o) { s_ += o.s_; return *this; }
+  String &operator+=(const char *o) { s_ += o; return *this; }
+  String &operator+=(char c) { s_ += c; return *this; }
+  bool operator==(const String &o) const { return s_ == o.s_; }
+  bool operator!=(const String &o) const { return s_ != o.s_; }
+  friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.s_); }
+private:
+  std::string s_;
+};
+
+class Print;
+class Printable { public: virtual size_t printTo(Print &p) const = 0; virtual ~Printable() {} };
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *b, size_t n) { size_t r = 0; while (n--) r += write(*b++); return r; }
+  size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+  size_t write(const char *s, size_t n) { return write((const uint8_t *)s, n); }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char b[1024]; va_list ap; va_start(ap, fmt); int n = vsnprintf(b, sizeof(b), fmt, ap); va_end(ap);
+    if (n < 0)
+      return 0;
+    if ((size_t)n >= sizeof(b))
+      n = sizeof(b) - 1;
+    return write((const uint8_t *)b, n);
+  }
+  size_t print(const char *s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned int v, int base = DEC) { return print(String(v, base)); }
+  size_t print(long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(unsigned long v, int base = DEC) { return print(String(v, base)); }
+  size_t print(double v, int d = 2) { char b[40]; snprintf(b, sizeof(b), "%.*f", d, v); return write(b); }
+  size_t print(const Printable &p) { return p.printTo(*this); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(const T &v, int f) { size_t n = print(v, f); return n + println(); }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  void setTimeout(unsigned long) {}
+  virtual size_t readBytes(char *buf, size_t len) {
+    size_t n = 0;
+    for (int c; n < len && (c = read()) >= 0; n++)
+      buf[n] = c;
+    return n;
+  }
+};
+
+// Goes to stdout; unless disabled (e.g. when running many nodes).
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) { return enabled ? fwrite(&c, 1, 1, stdout) : 1; }
+  using Print::write;
+  bool enabled = true;
+};
+extern HardwareSerial Serial;
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : a_{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : a_{a, b, c, d} {}
+  uint8_t operator[](int i) const { return a_[i]; }
+  uint8_t &operator[](int i) { return a_[i]; }
+  bool operator==(const IPAddress &o) const { return !memcmp(a_, o.a_, 4); }
+  String toString() const { char b[16]; snprintf(b, sizeof(b), "%u.%u.%u.%u", a_[0], a_[1], a_[2], a_[3]); return String(b); }
+  size_t printTo(Print &p) const { return p.print(toString()); }
+private:
+  uint8_t a_[4];
+};
+
+// Restart ends the process (exit code 3); a wrapper script or the
+// load generator can restart it.
+class EspClass {
+public:
+  void restart();
+  uint32_t getFreeHeap();
+  uint64_t getEfuseMac();
+  uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
+
+extern "C" uint8_t temprature_sens_read();
@@ -0,0 +1,47 @@
+#include <EEPROM.h>
+#include <FS.h>
+#include <sys/stat.h>
+
+EEPROMClass EEPROM;
+
+static std::string eepromPath() {
+  return std::string(hostStatePath()) + "/eeprom.bin";
+}
+
+// Erased flash reads as 0xFF; as on the ESP32.
+//
+bool EEPROMClass::begin(size_t size) {
+  if (_data && _size == size)
+    return true;
+  free(_data);
+  _data = (uint8_t *)malloc(size);
+  _size = size;
+  memset(_data, 0xFF, size);
+
+  FILE *f = fopen(eepromPath().c_str(), "rb");
+  if (f) {
+    fread(_data, 1, size, f);
+    fclose(f);
+  };
+  return true;
+}
+
+uint8_t EEPROMClass::read(int address) {
+  return (_data && address >= 0 && (size_t)address < _size) ? _data[address] : 0;
+}
+
+void EEPROMClass::write(int address, uint8_t val) {
+  if (_data && address >= 0 && (size_t)address < _size)
+    _data[address] = val;
+}
+
+bool EEPROMClass::commit() {
+  if (!_data)
+    return false;
+  ::mkdir(hostStatePath(), 0755);
+  FILE *f = fopen(eepromPath().c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(_data, 1, _size, f) == _size;
+  return (fclose(f) == 0) && ok;
+}
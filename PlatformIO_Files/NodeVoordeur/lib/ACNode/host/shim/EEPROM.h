@@ -0,0 +1,17 @@
+#pragma once
+#include <Arduino.h>
+
+// Kept in RAM; and written to <state>/eeprom.bin on commit().
+//
+class EEPROMClass {
+public:
+  bool begin(size_t size);
+  uint8_t read(int address);
+  void write(int address, uint8_t val);
+  bool commit();
+  size_t length() { return _size; }
+private:
+  uint8_t *_data = nullptr;
+  size_t _size = 0;
+};
+extern EEPROMClass EEPROM;
@@ -0,0 +1,22 @@
+#pragma once
+#include <WiFi.h>
+
+#define ETH_PHY_ADDR 0
+#define ETH_PHY_MDC 23
+#define ETH_PHY_MDIO 18
+#define ETH_PHY_LAN8720 0
+#define ETH_CLOCK_GPIO17_OUT 3
+#define ETH_CLK_MODE 0
+
+// begin() brings the link straight up; see hostNetworkEvent().
+//
+class ETHClass {
+public:
+  bool begin(int = 0, int = 0, int = 0, int = 0, int = 0, int = 0);
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  String macAddress() { return WiFi.macAddress(); }
+  bool setHostname(const char *) { return true; }
+  bool fullDuplex() { return true; }
+  uint8_t linkSpeed() { return 100; }
+};
+extern ETHClass ETH;
@@ -0,0 +1,187 @@
+#include <FS.h>
+#include <SPIFFS.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+SPIFFSFS SPIFFS;
+
+const char *hostStatePath() {
+  static std::string path;
+  if (path.empty()) {
+    const char *e = getenv("ACNODE_STATE");
+    path = (e && *e) ? e : "./acnode-state";
+  };
+  return path.c_str();
+}
+
+namespace fs {
+
+class FileImpl {
+public:
+  std::string path; // as seen by the node; e.g. /cache/abcdef
+  std::string host; // where it really is
+  FILE *fp = nullptr;
+  DIR *dir = nullptr;
+  ~FileImpl() { close(); }
+  void close() {
+    if (fp)
+      fclose(fp);
+    if (dir)
+      closedir(dir);
+    fp = nullptr;
+    dir = nullptr;
+  }
+};
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+size_t File::write(const uint8_t *buf, size_t size) { return (_p && _p->fp) ? fwrite(buf, 1, size, _p->fp) : 0; }
+
+int File::available() {
+  if (!_p || !_p->fp)
+    return 0;
+  long at = ftell(_p->fp);
+  return size() - at;
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek() {
+  if (!_p || !_p->fp)
+    return -1;
+  int c = fgetc(_p->fp);
+  if (c != EOF)
+    ungetc(c, _p->fp);
+  return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t *buf, size_t size) { return (_p && _p->fp) ? fread(buf, 1, size, _p->fp) : 0; }
+
+size_t File::size() {
+  struct stat st;
+  if (!_p || !_p->fp)
+    return 0;
+  fflush(_p->fp);
+  return fstat(fileno(_p->fp), &st) == 0 ? st.st_size : 0;
+}
+
+bool File::seek(uint32_t pos) { return _p && _p->fp && fseek(_p->fp, pos, SEEK_SET) == 0; }
+size_t File::position() { return (_p && _p->fp) ? ftell(_p->fp) : 0; }
+
+void File::flush() {
+  if (_p && _p->fp)
+    fflush(_p->fp);
+}
+
+void File::close() {
+  if (_p)
+    _p->close();
+  _p = nullptr;
+}
+
+File::operator bool() const { return _p && (_p->fp || _p->dir); }
+
+const char *File::name() const {
+  if (!_p)
+    return NULL;
+  size_t i = _p->path.rfind('/');
+  return _p->path.c_str() + (i == std::string::npos ? 0 : i + 1);
+}
+
+const char *File::path() const { return _p ? _p->path.c_str() : NULL; }
+
+bool File::isDirectory() { return _p && _p->dir; }
+
+File File::openNextFile(const char *mode) {
+  if (!_p || !_p->dir)
+    return File();
+  struct dirent *e;
+  while ((e = readdir(_p->dir)) != NULL) {
+    if (e->d_name[0] == '.')
+      continue;
+    std::string p = _p->path == "/" ? "/" : _p->path + "/";
+    File f = SPIFFS.open((p + e->d_name).c_str(), mode);
+    if (f)
+      return f;
+  };
+  return File();
+}
+
+std::string FS::_root() {
+  return std::string(hostStatePath()) + "/spiffs";
+}
+
+static void mkdirs(const std::string &path) {
+  for (size_t i = 1; i < path.size(); i++)
+    if (path[i] == '/')
+      ::mkdir(path.substr(0, i).c_str(), 0755);
+  ::mkdir(path.c_str(), 0755);
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  auto f = std::make_shared<FileImpl>();
+  f->path = path;
+  f->host = _root() + path;
+
+  struct stat st;
+  if (mode[0] == 'r' && stat(f->host.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    f->dir = opendir(f->host.c_str());
+    return f->dir ? File(f) : File();
+  };
+  // Like SPIFFS; which has no real directories.
+  if (mode[0] != 'r') {
+    size_t i = f->host.rfind('/');
+    mkdirs(f->host.substr(0, i));
+  };
+  std::string m = mode;
+  if (m.find('b') == std::string::npos)
+    m += "b";
+  f->fp = fopen(f->host.c_str(), m.c_str());
+  return f->fp ? File(f) : File();
+}
+
+bool FS::exists(const char *path) {
+  struct stat st;
+  return stat((_root() + path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char *path) { return unlink((_root() + path).c_str()) == 0; }
+bool FS::rename(const char *from, const char *to) { return ::rename((_root() + from).c_str(), (_root() + to).c_str()) == 0; }
+
+bool FS::mkdir(const char *path) {
+  mkdirs(_root() + path);
+  return exists(path);
+}
+
+bool FS::rmdir(const char *path) { return ::rmdir((_root() + path).c_str()) == 0; }
+
+} // namespace fs
+
+bool SPIFFSFS::begin(bool formatOnFail) {
+  return mkdir("/");
+}
+
+bool SPIFFSFS::format() {
+  std::string cmd = "rm -rf '" + _root() + "'";
+  return system(cmd.c_str()) == 0 && begin();
+}
+
+size_t SPIFFSFS::totalBytes() { return 1408 * 1024; }
+
+size_t SPIFFSFS::usedBytes() {
+  size_t used = 0;
+  std::function<void(File &)> walk = [&](File &d) {
+    for (File f = d.openNextFile(); f; f = d.openNextFile()) {
+      if (f.isDirectory())
+        walk(f);
+      else
+        used += f.size();
+    };
+  };
+  File root = open("/");
+  walk(root);
+  return used;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include <memory>
+
+// Files live in a plain directory on the host; see hostStatePath().
+//
+namespace fs {
+class FileImpl;
+class File : public Stream {
+public:
+  File() {}
+  File(std::shared_ptr<FileImpl> p) : _p(p) {}
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buf, size_t size);
+  using Print::write;
+  int available();
+  int read();
+  int peek();
+  size_t read(uint8_t *buf, size_t size);
+  size_t readBytes(char *buf, size_t size) { return read((uint8_t *)buf, size); }
+  size_t size();
+  bool seek(uint32_t pos);
+  size_t position();
+  void flush();
+  void close();
+  operator bool() const;
+  // As on core 2.x: name() is the last component, path() the full path.
+  const char *name() const;
+  const char *path() const;
+  bool isDirectory();
+  File openNextFile(const char *mode = "r");
+private:
+  std::shared_ptr<FileImpl> _p;
+};
+
+class FS {
+public:
+  File open(const char *path, const char *mode = "r", bool create = false);
+  File open(const String &path, const char *mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+  bool exists(const char *path);
+  bool exists(const String &path) { return exists(path.c_str()); }
+  bool remove(const char *path);
+  bool remove(const String &path) { return remove(path.c_str()); }
+  bool rename(const char *from, const char *to);
+  bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char *path);
+  bool mkdir(const String &path) { return mkdir(path.c_str()); }
+  bool rmdir(const char *path);
+  bool rmdir(const String &path) { return rmdir(path.c_str()); }
+protected:
+  std::string _root();
+};
+}
+using fs::File;
+using fs::FS;
+
+// Directory that holds the emulated flash (spiffs/ and eeprom.bin);
+// $ACNODE_STATE or ./acnode-state by default.
+//
+const char *hostStatePath();
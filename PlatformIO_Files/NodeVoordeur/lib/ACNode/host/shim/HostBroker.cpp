@@ -0,0 +1,96 @@
+#include <HostBroker.h>
+#include <string.h>
+#include <algorithm>
+
+// Never destroyed; clients may still detach during static destruction.
+//
+HostBroker &HostBroker::instance() {
+  static HostBroker *broker = new HostBroker();
+  return *broker;
+}
+
+// MQTT topic filter; '+' is one level, a trailing '#' any number of them
+// (including none).
+//
+bool HostBroker::matches(const char *filter, const char *topic) {
+  while (*filter) {
+    if (filter[0] == '#' && filter[1] == 0)
+      return true;
+    if (*filter == '+') {
+      while (*topic && *topic != '/')
+        topic++;
+      filter++;
+      continue;
+    };
+    if (*filter == '/' && filter[1] == '#' && filter[2] == 0 && *topic == 0)
+      return true;
+    if (*filter != *topic)
+      return false;
+    filter++;
+    topic++;
+  };
+  return *topic == 0;
+}
+
+HostBroker::client_t *HostBroker::attach(const char *id) {
+  // Same client id kicks out the old session; as mosquitto does.
+  for (auto c : _clients)
+    if (c->id == id)
+      c->dropped = true;
+  _clients.erase(std::remove_if(_clients.begin(), _clients.end(),
+                                [](client_t *c) { return c->dropped; }),
+                 _clients.end());
+
+  client_t *c = new client_t();
+  c->id = id;
+  _clients.push_back(c);
+  return c;
+}
+
+void HostBroker::detach(client_t *client) {
+  _clients.erase(std::remove(_clients.begin(), _clients.end(), client), _clients.end());
+  delete client;
+}
+
+void HostBroker::subscribe(client_t *client, const char *filter) {
+  if (std::find(client->subscriptions.begin(), client->subscriptions.end(), filter) == client->subscriptions.end())
+    client->subscriptions.push_back(filter);
+
+  for (auto &m : _retained)
+    if (matches(filter, m.topic.c_str())) {
+      client->inbox.push_back(m);
+      delivered++;
+    };
+}
+
+void HostBroker::unsubscribe(client_t *client, const char *filter) {
+  auto &s = client->subscriptions;
+  s.erase(std::remove(s.begin(), s.end(), filter), s.end());
+}
+
+void HostBroker::publish(const char *topic, const uint8_t *payload, size_t len, bool retained) {
+  message_t m = {topic, std::vector<uint8_t>(payload, payload + len)};
+  published++;
+
+  if (retained) {
+    _retained.erase(std::remove_if(_retained.begin(), _retained.end(),
+                                   [&](const message_t &r) { return r.topic == m.topic; }),
+                    _retained.end());
+    if (len)
+      _retained.push_back(m);
+  };
+
+  for (auto c : _clients)
+    for (auto &f : c->subscriptions)
+      if (matches(f.c_str(), topic)) {
+        c->inbox.push_back(m);
+        delivered++;
+        break;
+      };
+}
+
+void HostBroker::drop_all() {
+  for (auto c : _clients)
+    c->dropped = true;
+  _clients.clear();
+}
@@ -0,0 +1,43 @@
+#pragma once
+// In-process MQTT broker behind the "memory" PubSubClient back end. QoS 0,
+// '+' and '#' wildcards and retained messages; messages are queued per
+// client and handed to its callback from PubSubClient::loop(), as they
+// would arrive from the network.
+//
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include <functional>
+
+class HostBroker {
+public:
+  struct message_t {
+    std::string topic;
+    std::vector<uint8_t> payload;
+  };
+  struct client_t {
+    std::string id;
+    std::vector<std::string> subscriptions;
+    std::deque<message_t> inbox;
+    bool dropped = false;
+  };
+
+  static HostBroker &instance();
+  static bool matches(const char *filter, const char *topic);
+
+  client_t *attach(const char *id);
+  void detach(client_t *client);
+  void subscribe(client_t *client, const char *filter);
+  void unsubscribe(client_t *client, const char *filter);
+  void publish(const char *topic, const uint8_t *payload, size_t len, bool retained);
+
+  // Drops every client; as a broker restart would.
+  void drop_all();
+
+  unsigned long published = 0, delivered = 0;
+
+private:
+  std::vector<client_t *> _clients;
+  std::vector<message_t> _retained;
+};
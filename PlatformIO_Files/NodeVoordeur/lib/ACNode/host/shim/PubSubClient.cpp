@@ -0,0 +1,345 @@
+#include <PubSubClient.h>
+#include <HostBroker.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+
+#include <string>
+#include <vector>
+
+struct PubSubClient::Impl {
+  std::string server = "memory";
+  uint16_t port = 1883;
+  std::function<void(char *, uint8_t *, unsigned int)> callback;
+  int state = MQTT_DISCONNECTED;
+
+  // "memory" back end.
+  HostBroker::client_t *mem = nullptr;
+
+  // TCP back end.
+  int fd = -1;
+  std::vector<uint8_t> rx;
+  uint16_t msgid = 0;
+  unsigned long lastOut = 0, lastIn = 0;
+  bool pingOutstanding = false;
+
+  ~Impl() { close(); }
+  bool memory() const { return server == "memory"; }
+  void close();
+  bool send(const std::vector<uint8_t> &pkt);
+  bool wait_for(uint8_t type, unsigned long timeout_ms, std::vector<uint8_t> *out);
+  bool read_packet(std::vector<uint8_t> *out);
+  void deliver(char *topic, uint8_t *payload, unsigned int len);
+};
+
+static void put16(std::vector<uint8_t> &b, uint16_t v) {
+  b.push_back(v >> 8);
+  b.push_back(v & 0xFF);
+}
+
+static void putString(std::vector<uint8_t> &b, const char *s, size_t len) {
+  put16(b, len);
+  b.insert(b.end(), s, s + len);
+}
+
+static std::vector<uint8_t> packet(uint8_t header, const std::vector<uint8_t> &body) {
+  std::vector<uint8_t> pkt;
+  pkt.push_back(header);
+  size_t len = body.size();
+  do {
+    uint8_t d = len % 128;
+    len /= 128;
+    pkt.push_back(len ? d | 0x80 : d);
+  } while (len);
+  pkt.insert(pkt.end(), body.begin(), body.end());
+  return pkt;
+}
+
+void PubSubClient::Impl::close() {
+  if (mem) {
+    HostBroker::instance().detach(mem);
+    mem = nullptr;
+  };
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  };
+  rx.clear();
+}
+
+bool PubSubClient::Impl::send(const std::vector<uint8_t> &pkt) {
+  size_t at = 0;
+  while (at < pkt.size()) {
+    ssize_t n = ::send(fd, pkt.data() + at, pkt.size() - at, MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      struct pollfd p = {fd, POLLOUT, 0};
+      poll(&p, 1, 100);
+      continue;
+    };
+    if (n <= 0) {
+      close();
+      state = MQTT_CONNECTION_LOST;
+      return false;
+    };
+    at += n;
+  };
+  lastOut = millis();
+  return true;
+}
+
+// One complete packet from the receive buffer (header byte first); or
+// false if it has not fully arrived yet.
+//
+bool PubSubClient::Impl::read_packet(std::vector<uint8_t> *out) {
+  uint8_t buf[2048];
+  for (;;) {
+    ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      rx.insert(rx.end(), buf, buf + n);
+      continue;
+    };
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      close();
+      state = MQTT_CONNECTION_LOST;
+      return false;
+    };
+    break;
+  };
+
+  size_t len = 0, mult = 1, at = 1;
+  for (;; at++) {
+    if (at >= rx.size() || at > 4)
+      return false;
+    len += (rx[at] & 0x7F) * mult;
+    mult *= 128;
+    if (!(rx[at] & 0x80))
+      break;
+  };
+  at++;
+  if (rx.size() < at + len)
+    return false;
+
+  out->assign(rx.begin(), rx.begin() + at + len);
+  out->erase(out->begin() + 1, out->begin() + at);
+  rx.erase(rx.begin(), rx.begin() + at + len);
+  lastIn = millis();
+  return true;
+}
+
+bool PubSubClient::Impl::wait_for(uint8_t type, unsigned long timeout_ms, std::vector<uint8_t> *out) {
+  unsigned long start = millis();
+  while (fd >= 0 && millis() - start < timeout_ms) {
+    if (read_packet(out)) {
+      if ((out->at(0) >> 4) == type)
+        return true;
+      continue;
+    };
+    struct pollfd p = {fd, POLLIN, 0};
+    poll(&p, 1, 10);
+  };
+  return false;
+}
+
+void PubSubClient::Impl::deliver(char *topic, uint8_t *payload, unsigned int len) {
+  // As the real one; which drops what does not fit its buffer.
+  if (5 + 2 + strlen(topic) + len > MQTT_MAX_PACKET_SIZE)
+    return;
+  if (callback)
+    callback(topic, payload, len);
+}
+
+PubSubClient::PubSubClient() : _impl(std::make_shared<Impl>()) {}
+PubSubClient::PubSubClient(Client &) : _impl(std::make_shared<Impl>()) {}
+
+PubSubClient &PubSubClient::setServer(const char *domain, uint16_t port) {
+  _impl->server = domain ? domain : "memory";
+  _impl->port = port;
+  return *this;
+}
+
+PubSubClient &PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+  _impl->callback = callback;
+  return *this;
+}
+
+bool PubSubClient::connect(const char *id) {
+  if (connected())
+    return true;
+  _impl->close();
+
+  if (_impl->memory()) {
+    _impl->mem = HostBroker::instance().attach(id);
+    _impl->state = MQTT_CONNECTED;
+    return true;
+  };
+
+  struct addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(_impl->server.c_str(), std::to_string(_impl->port).c_str(), &hints, &res) != 0) {
+    _impl->state = MQTT_CONNECT_FAILED;
+    return false;
+  };
+  for (struct addrinfo *a = res; a && _impl->fd < 0; a = a->ai_next) {
+    int fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0)
+      continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      _impl->fd = fd;
+    } else
+      ::close(fd);
+  };
+  freeaddrinfo(res);
+  if (_impl->fd < 0) {
+    _impl->state = MQTT_CONNECT_FAILED;
+    return false;
+  };
+
+  std::vector<uint8_t> body;
+  putString(body, "MQTT", 4);
+  body.push_back(4);    // 3.1.1
+  body.push_back(0x02); // clean session
+  put16(body, MQTT_KEEPALIVE);
+  putString(body, id, strlen(id));
+
+  std::vector<uint8_t> ack;
+  if (!_impl->send(packet(0x10, body)) || !_impl->wait_for(2, 5000, &ack) || ack.size() < 3) {
+    _impl->close();
+    _impl->state = MQTT_CONNECTION_TIMEOUT;
+    return false;
+  };
+  if (ack[2] != 0) {
+    _impl->close();
+    _impl->state = ack[2];
+    return false;
+  };
+  _impl->pingOutstanding = false;
+  _impl->lastIn = millis();
+  _impl->state = MQTT_CONNECTED;
+  return true;
+}
+
+void PubSubClient::disconnect() {
+  if (_impl->fd >= 0)
+    _impl->send(packet(0xE0, {}));
+  _impl->close();
+  _impl->state = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected() {
+  if (_impl->mem && _impl->mem->dropped) {
+    _impl->close();
+    _impl->state = MQTT_CONNECTION_LOST;
+  };
+  return _impl->mem != nullptr || _impl->fd >= 0;
+}
+
+int PubSubClient::state() {
+  connected();
+  return _impl->state;
+}
+
+bool PubSubClient::subscribe(const char *topic, uint8_t qos) {
+  if (!connected())
+    return false;
+  if (_impl->mem) {
+    HostBroker::instance().subscribe(_impl->mem, topic);
+    return true;
+  };
+  std::vector<uint8_t> body;
+  put16(body, ++_impl->msgid ? _impl->msgid : ++_impl->msgid);
+  putString(body, topic, strlen(topic));
+  body.push_back(qos > 1 ? 1 : qos);
+  return _impl->send(packet(0x82, body));
+}
+
+bool PubSubClient::unsubscribe(const char *topic) {
+  if (!connected())
+    return false;
+  if (_impl->mem) {
+    HostBroker::instance().unsubscribe(_impl->mem, topic);
+    return true;
+  };
+  std::vector<uint8_t> body;
+  put16(body, ++_impl->msgid ? _impl->msgid : ++_impl->msgid);
+  putString(body, topic, strlen(topic));
+  return _impl->send(packet(0xA2, body));
+}
+
+bool PubSubClient::publish(const char *topic, const char *payload, bool retained) {
+  return publish(topic, (const uint8_t *)payload, payload ? strlen(payload) : 0, retained);
+}
+
+bool PubSubClient::publish(const char *topic, const uint8_t *payload, unsigned int len, bool retained) {
+  if (!connected())
+    return false;
+  // Same limit as the real one: fixed header, topic and payload.
+  if (5 + 2 + strlen(topic) + len > MQTT_MAX_PACKET_SIZE)
+    return false;
+
+  if (_impl->mem) {
+    HostBroker::instance().publish(topic, payload, len, retained);
+    return true;
+  };
+  std::vector<uint8_t> body;
+  putString(body, topic, strlen(topic));
+  body.insert(body.end(), payload, payload + len);
+  return _impl->send(packet(retained ? 0x31 : 0x30, body));
+}
+
+bool PubSubClient::loop() {
+  if (!connected())
+    return false;
+
+  if (_impl->mem) {
+    // Only what is queued now; anything the callbacks publish to us
+    // waits for the next loop(); as it would on the wire.
+    size_t n = _impl->mem->inbox.size();
+    while (n-- && _impl->mem) {
+      HostBroker::message_t m = std::move(_impl->mem->inbox.front());
+      _impl->mem->inbox.pop_front();
+      m.payload.push_back(0);
+      _impl->deliver((char *)m.topic.c_str(), m.payload.data(), m.payload.size() - 1);
+    };
+    return connected();
+  };
+
+  std::vector<uint8_t> pkt;
+  while (_impl->fd >= 0 && _impl->read_packet(&pkt)) {
+    uint8_t type = pkt[0] >> 4;
+    if (type == 13)
+      _impl->pingOutstanding = false;
+    if (type != 3 || pkt.size() < 3)
+      continue;
+
+    size_t tlen = (pkt[1] << 8) | pkt[2];
+    size_t at = 3 + tlen + (((pkt[0] >> 1) & 3) ? 2 : 0);
+    if (at > pkt.size())
+      continue;
+    std::string topic((char *)pkt.data() + 3, tlen);
+    pkt.push_back(0);
+    _impl->deliver((char *)topic.c_str(), pkt.data() + at, pkt.size() - 1 - at);
+  };
+
+  // Keep alive; drop the connection when the broker stops answering.
+  unsigned long now = millis();
+  if (_impl->fd >= 0 && (now - _impl->lastOut > MQTT_KEEPALIVE * 1000UL || now - _impl->lastIn > MQTT_KEEPALIVE * 1000UL)) {
+    if (_impl->pingOutstanding) {
+      _impl->close();
+      _impl->state = MQTT_CONNECTION_TIMEOUT;
+    } else {
+      _impl->send(packet(0xC0, {}));
+      _impl->pingOutstanding = true;
+      _impl->lastIn = now;
+    };
+  };
+  return connected();
+}
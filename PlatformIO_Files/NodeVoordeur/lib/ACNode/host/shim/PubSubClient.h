@@ -0,0 +1,64 @@
+#pragma once
+// Same interface as knolleary's PubSubClient (QoS 0 publish; payloads
+// capped at MQTT_MAX_PACKET_SIZE). Two back ends:
+//
+//   server "memory" (the default): the in-process broker of HostBroker.h;
+//   any other server: MQTT 3.1.1 over TCP; e.g. a local mosquitto.
+//
+// Copies share one connection; ACNode assigns the client by value.
+//
+#include <Arduino.h>
+#include <WiFi.h>
+#include <memory>
+
+#ifndef MQTT_MAX_PACKET_SIZE
+#define MQTT_MAX_PACKET_SIZE 256
+#endif
+#ifndef MQTT_KEEPALIVE
+#define MQTT_KEEPALIVE 15
+#endif
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECT_BAD_PROTOCOL 1
+#define MQTT_CONNECT_BAD_CLIENT_ID 2
+#define MQTT_CONNECT_UNAVAILABLE 3
+#define MQTT_CONNECT_BAD_CREDENTIALS 4
+#define MQTT_CONNECT_UNAUTHORIZED 5
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char *, uint8_t *, unsigned int)> callback
+
+class PubSubClient {
+public:
+  struct Impl;
+
+  PubSubClient();
+  PubSubClient(Client &client);
+
+  PubSubClient &setServer(const char *domain, uint16_t port);
+  PubSubClient &setServer(IPAddress ip, uint16_t port) { return setServer(ip.toString().c_str(), port); }
+  PubSubClient &setCallback(MQTT_CALLBACK_SIGNATURE);
+
+  bool connect(const char *id);
+  bool connect(const char *id, const char *user, const char *pass) { return connect(id); }
+  void disconnect();
+  bool connected();
+  int state();
+
+  bool subscribe(const char *topic) { return subscribe(topic, 0); }
+  bool subscribe(const char *topic, uint8_t qos);
+  bool unsubscribe(const char *topic);
+
+  bool publish(const char *topic, const char *payload) { return publish(topic, payload, false); }
+  bool publish(const char *topic, const char *payload, bool retained);
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len) { return publish(topic, payload, len, false); }
+  bool publish(const char *topic, const uint8_t *payload, unsigned int len, bool retained);
+
+  bool loop();
+
+private:
+  std::shared_ptr<Impl> _impl;
+};
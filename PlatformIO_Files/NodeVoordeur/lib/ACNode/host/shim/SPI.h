@@ -0,0 +1,13 @@
+#pragma once
+#include <Arduino.h>
+#define SPI_CLOCK_DIV4 4
+#define SPI_MODE0 0
+class SPISettings { public: SPISettings(uint32_t = 0, uint8_t = 0, uint8_t = 0) {} };
+class SPIClass {
+public:
+  void begin(int = -1, int = -1, int = -1, int = -1) {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t) { return 0; }
+};
+extern SPIClass SPI;
@@ -0,0 +1,13 @@
+#pragma once
+#include <FS.h>
+
+// Rooted at <state>/spiffs; see hostStatePath().
+//
+class SPIFFSFS : public fs::FS {
+public:
+  bool begin(bool formatOnFail = false);
+  bool format();
+  size_t totalBytes();
+  size_t usedBytes();
+};
+extern SPIFFSFS SPIFFS;
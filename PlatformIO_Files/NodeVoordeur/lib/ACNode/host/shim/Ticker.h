@@ -0,0 +1,7 @@
+#pragma once
+#include <Arduino.h>
+class Ticker {
+public:
+  template <typename T> void attach_ms(uint32_t, void (*)(T), T) {}
+  void detach() {}
+};
@@ -0,0 +1,86 @@
+#include <WiFi.h>
+#include <ETH.h>
+#include <WiFiUdp.h>
+#include <ESPmDNS.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <ArduinoOTA.h>
+
+WiFiClass WiFi;
+ETHClass ETH;
+SPIClass SPI;
+TwoWire Wire;
+ArduinoOTAClass ArduinoOTA;
+
+static bool up = false;
+
+// Node MAC from $ACNODE_MAC (aa:bb:cc:dd:ee:ff); so that several host
+// nodes each get their own name and SIG2 identity.
+//
+uint8_t *WiFiClass::macAddress(uint8_t *mac) {
+  static uint8_t m[6] = {0x02, 0xAC, 0x00, 0x00, 0x00, 0x01};
+  static bool init = false;
+  if (!init) {
+    const char *e = getenv("ACNODE_MAC");
+    unsigned int b[6];
+    if (e && sscanf(e, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) == 6)
+      for (int i = 0; i < 6; i++)
+        m[i] = b[i];
+    init = true;
+  };
+  memcpy(mac, m, 6);
+  return mac;
+}
+
+String WiFiClass::macAddress() {
+  uint8_t m[6];
+  char buf[18];
+  macAddress(m);
+  snprintf(buf, sizeof(buf), "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+  return String(buf);
+}
+
+uint64_t EspClass::getEfuseMac() {
+  uint8_t m[6];
+  uint64_t r = 0;
+  WiFi.macAddress(m);
+  for (int i = 5; i >= 0; i--)
+    r = (r << 8) | m[i];
+  return r;
+}
+
+wl_status_t WiFiClass::status() {
+  return up ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+void hostNetworkEvent(WiFiEvent_t event) {
+  switch (event) {
+  case SYSTEM_EVENT_STA_GOT_IP:
+  case SYSTEM_EVENT_ETH_GOT_IP:
+    up = true;
+    break;
+  case SYSTEM_EVENT_STA_DISCONNECTED:
+  case SYSTEM_EVENT_STA_LOST_IP:
+  case SYSTEM_EVENT_ETH_DISCONNECTED:
+  case SYSTEM_EVENT_ETH_STOP:
+    up = false;
+    break;
+  default:
+    break;
+  };
+  if (WiFi._cb)
+    WiFi._cb(event);
+}
+
+void WiFiClass::begin(const char *ssid, const char *passwd) {
+  hostNetworkEvent(SYSTEM_EVENT_STA_START);
+  hostNetworkEvent(SYSTEM_EVENT_STA_CONNECTED);
+  hostNetworkEvent(SYSTEM_EVENT_STA_GOT_IP);
+}
+
+bool ETHClass::begin(int, int, int, int, int, int) {
+  hostNetworkEvent(SYSTEM_EVENT_ETH_START);
+  hostNetworkEvent(SYSTEM_EVENT_ETH_CONNECTED);
+  hostNetworkEvent(SYSTEM_EVENT_ETH_GOT_IP);
+  return true;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+typedef enum {
+  SYSTEM_EVENT_WIFI_READY = 0, SYSTEM_EVENT_STA_START, SYSTEM_EVENT_STA_GOT_IP,
+  SYSTEM_EVENT_ETH_START, SYSTEM_EVENT_ETH_STOP, SYSTEM_EVENT_ETH_CONNECTED,
+  SYSTEM_EVENT_ETH_DISCONNECTED, SYSTEM_EVENT_ETH_GOT_IP, SYSTEM_EVENT_AP_STADISCONNECTED,
+  SYSTEM_EVENT_AP_PROBEREQRECVED, SYSTEM_EVENT_ACTION_TX_STATUS, SYSTEM_EVENT_ROC_DONE,
+  SYSTEM_EVENT_STA_DISCONNECTED, SYSTEM_EVENT_STA_LOST_IP, SYSTEM_EVENT_STA_CONNECTED
+} WiFiEvent_t;
+typedef void (*WiFiEventCb)(WiFiEvent_t);
+
+class Client : public Stream {
+public:
+  virtual int connect(const char *, uint16_t) { return 0; }
+  virtual uint8_t connected() { return 0; }
+  virtual void stop() {}
+  virtual operator bool() { return false; }
+};
+
+// Never connected; the MQTT traffic goes through PubSubClient directly.
+//
+class WiFiClient : public Client {
+public:
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+  IPAddress remoteIP() { return IPAddress(); }
+};
+
+class WiFiServer {
+public:
+  WiFiServer(uint16_t) {}
+  void begin() {}
+  void stop() {}
+  void setNoDelay(bool) {}
+  bool hasClient() { return false; }
+  WiFiClient available() { return WiFiClient(); }
+};
+
+class WiFiClass {
+public:
+  wl_status_t status();
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  IPAddress gatewayIP() { return IPAddress(127, 0, 0, 1); }
+  String macAddress();
+  uint8_t *macAddress(uint8_t *mac);
+  String SSID() { return String("host"); }
+  bool mode(wifi_mode_t) { return true; }
+  void begin(const char *ssid, const char *passwd);
+  void onEvent(WiFiEventCb cb) { _cb = cb; }
+  WiFiEventCb _cb = nullptr;
+};
+extern WiFiClass WiFi;
+
+// Deliver a network event as the ESP32 event task would; e.g. to bounce
+// the link (SYSTEM_EVENT_ETH_DISCONNECTED, then ..._GOT_IP).
+//
+void hostNetworkEvent(WiFiEvent_t event);
@@ -0,0 +1,3 @@
+#pragma once
+#include <Arduino.h>
+class WiFiManager { public: bool autoConnect() { return true; } };
@@ -0,0 +1,15 @@
+#pragma once
+#include <Arduino.h>
+class TwoWire : public Stream {
+public:
+  bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+  void beginTransmission(uint8_t) {}
+  uint8_t endTransmission(bool = true) { return 0; }
+  uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+  size_t write(uint8_t) { return 1; }
+  using Print::write;
+  void setClock(uint32_t) {}
+  size_t send(uint8_t c) { return write(c); }
+  int receive() { return read(); }
+};
+extern TwoWire Wire;
@@ -0,0 +1,14 @@
+#pragma once
+// Same context layout as the ESP-IDF hardware AES driver; which is all
+// that AESEsp32.cpp relies on. Done in software here.
+//
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  uint8_t key_bytes;
+  uint8_t key[32];
+} esp_aes_context;
+
+int esp_aes_encrypt(esp_aes_context *ctx, const unsigned char input[16], unsigned char output[16]);
+int esp_aes_decrypt(esp_aes_context *ctx, const unsigned char input[16], unsigned char output[16]);
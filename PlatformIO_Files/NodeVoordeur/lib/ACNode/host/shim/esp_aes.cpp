@@ -0,0 +1,147 @@
+// Plain software AES (FIPS-197); stands in for the ESP32 AES peripheral.
+// Byte oriented and not constant time; which is fine for a host build.
+//
+#include "aes/esp_aes.h"
+#include <string.h>
+
+static uint8_t sbox[256], inv[256];
+
+static uint8_t xtime(uint8_t x) { return (x << 1) ^ ((x & 0x80) ? 0x1b : 0); }
+
+static uint8_t mul(uint8_t a, uint8_t b) {
+  uint8_t r = 0;
+  while (b) {
+    if (b & 1)
+      r ^= a;
+    a = xtime(a);
+    b >>= 1;
+  };
+  return r;
+}
+
+static bool build_tables() {
+  // Affine transform of the multiplicative inverse in GF(2^8).
+  for (int i = 0; i < 256; i++) {
+    uint8_t x = 0;
+    for (int j = 1; j < 256 && i; j++)
+      if (mul(i, j) == 1) {
+        x = j;
+        break;
+      };
+    uint8_t s = x ^ 0x63;
+    for (int k = 1; k < 5; k++)
+      s ^= (uint8_t)((x << k) | (x >> (8 - k)));
+    sbox[i] = s;
+    inv[s] = i;
+  };
+  return true;
+}
+
+static void init_tables() {
+  static const bool done = build_tables();
+  (void)done;
+}
+
+// Expanded key schedule; cached per thread as the same key is used for
+// many blocks in a row.
+//
+struct schedule_t {
+  uint8_t key[32];
+  uint8_t key_bytes;
+  int rounds;
+  uint8_t rk[240];
+};
+
+static const schedule_t *expand(const esp_aes_context *ctx) {
+  static thread_local schedule_t s = {};
+  if (s.key_bytes == ctx->key_bytes && memcmp(s.key, ctx->key, ctx->key_bytes) == 0)
+    return &s;
+
+  init_tables();
+  int nk = ctx->key_bytes / 4;
+  s.rounds = nk + 6;
+  memcpy(s.rk, ctx->key, ctx->key_bytes);
+  uint8_t rcon = 1;
+  for (int i = nk; i < 4 * (s.rounds + 1); i++) {
+    uint8_t t[4];
+    memcpy(t, s.rk + 4 * (i - 1), 4);
+    if (i % nk == 0) {
+      uint8_t u = t[0];
+      t[0] = sbox[t[1]] ^ rcon;
+      t[1] = sbox[t[2]];
+      t[2] = sbox[t[3]];
+      t[3] = sbox[u];
+      rcon = xtime(rcon);
+    } else if (nk > 6 && i % nk == 4) {
+      for (int j = 0; j < 4; j++)
+        t[j] = sbox[t[j]];
+    };
+    for (int j = 0; j < 4; j++)
+      s.rk[4 * i + j] = s.rk[4 * (i - nk) + j] ^ t[j];
+  };
+  memcpy(s.key, ctx->key, ctx->key_bytes);
+  s.key_bytes = ctx->key_bytes;
+  return &s;
+}
+
+static bool valid(const esp_aes_context *ctx) {
+  return ctx->key_bytes == 16 || ctx->key_bytes == 24 || ctx->key_bytes == 32;
+}
+
+int esp_aes_encrypt(esp_aes_context *ctx, const unsigned char input[16], unsigned char output[16]) {
+  if (!valid(ctx))
+    return -1;
+  const schedule_t *s = expand(ctx);
+  uint8_t st[16], t[16];
+  for (int i = 0; i < 16; i++)
+    st[i] = input[i] ^ s->rk[i];
+
+  for (int r = 1; r <= s->rounds; r++) {
+    // SubBytes and ShiftRows.
+    for (int c = 0; c < 4; c++)
+      for (int row = 0; row < 4; row++)
+        t[4 * c + row] = sbox[st[4 * ((c + row) % 4) + row]];
+    // MixColumns; except in the last round.
+    if (r != s->rounds)
+      for (int c = 0; c < 4; c++) {
+        uint8_t *a = t + 4 * c, x = a[0] ^ a[1] ^ a[2] ^ a[3], a0 = a[0];
+        a[0] ^= x ^ xtime(a[0] ^ a[1]);
+        a[1] ^= x ^ xtime(a[1] ^ a[2]);
+        a[2] ^= x ^ xtime(a[2] ^ a[3]);
+        a[3] ^= x ^ xtime(a[3] ^ a0);
+      };
+    for (int i = 0; i < 16; i++)
+      st[i] = t[i] ^ s->rk[16 * r + i];
+  };
+  memcpy(output, st, 16);
+  return 0;
+}
+
+int esp_aes_decrypt(esp_aes_context *ctx, const unsigned char input[16], unsigned char output[16]) {
+  if (!valid(ctx))
+    return -1;
+  const schedule_t *s = expand(ctx);
+  uint8_t st[16], t[16];
+  for (int i = 0; i < 16; i++)
+    st[i] = input[i] ^ s->rk[16 * s->rounds + i];
+
+  for (int r = s->rounds - 1; r >= 0; r--) {
+    // InvShiftRows and InvSubBytes.
+    for (int c = 0; c < 4; c++)
+      for (int row = 0; row < 4; row++)
+        t[4 * ((c + row) % 4) + row] = inv[st[4 * c + row]];
+    for (int i = 0; i < 16; i++)
+      t[i] ^= s->rk[16 * r + i];
+    // InvMixColumns; except after the last round.
+    if (r != 0)
+      for (int c = 0; c < 4; c++) {
+        uint8_t *a = t + 4 * c, b[4];
+        for (int j = 0; j < 4; j++)
+          b[j] = mul(a[j], 14) ^ mul(a[(j + 1) % 4], 11) ^ mul(a[(j + 2) % 4], 13) ^ mul(a[(j + 3) % 4], 9);
+        memcpy(a, b, 4);
+      };
+    memcpy(st, t, 16);
+  };
+  memcpy(output, st, 16);
+  return 0;
+}
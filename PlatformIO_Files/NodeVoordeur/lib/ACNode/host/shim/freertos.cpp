@@ -0,0 +1,74 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct host_task {
+  std::thread thread;
+};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char * name, uint32_t stack,
+  void * arg, UBaseType_t priority, TaskHandle_t * handle, BaseType_t core)
+{
+  host_task * t = new host_task;
+  t->thread = std::thread(fn, arg);
+  t->thread.detach();
+  if (handle)
+    *handle = t;
+  return pdPASS;
+}
+
+struct host_queue {
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length, size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  host_queue * q = new host_queue;
+  q->length = length;
+  q->size = itemSize;
+  return q;
+}
+
+// Wait until ready() or the ticks (milliseconds here) run out.
+template<typename F> static bool wait_for(host_queue * q, std::unique_lock<std::mutex> & l, TickType_t wait, F ready) {
+  if (wait == portMAX_DELAY) {
+    q->changed.wait(l, ready);
+    return true;
+  };
+  return q->changed.wait_for(l, std::chrono::milliseconds(wait), ready);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void * item, TickType_t wait) {
+  std::unique_lock<std::mutex> l(q->lock);
+  if (!wait_for(q, l, wait, [q]() { return q->items.size() < q->length; }))
+    return pdFALSE;
+  q->items.emplace_back((const uint8_t *)item, (const uint8_t *)item + q->size);
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void * item, TickType_t wait) {
+  std::unique_lock<std::mutex> l(q->lock);
+  if (!wait_for(q, l, wait, [q]() { return !q->items.empty(); }))
+    return pdFALSE;
+  memcpy(item, q->items.front().data(), q->size);
+  q->items.pop_front();
+  q->changed.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> l(q->lock);
+  return q->items.size();
+}
@@ -0,0 +1,19 @@
+#pragma once
+// FreeRTOS; just the tasks and queues ACNode uses (see CryptoWorker.cpp).
+// Tasks are threads, queues a mutex and a condition variable. Core
+// affinity and priorities are ignored.
+//
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE (0)
+#define pdTRUE (1)
+#define pdPASS (pdTRUE)
+#define portMAX_DELAY ((TickType_t) 0xFFFFFFFF)
+#define portTICK_PERIOD_MS (1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY (0x7FFFFFFF)
@@ -0,0 +1,9 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef struct host_queue * QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void * item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void * item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
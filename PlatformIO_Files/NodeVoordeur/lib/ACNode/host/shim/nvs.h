@@ -0,0 +1,17 @@
+#pragma once
+// Non volatile storage; not emulated. Every call fails, which RNG.cpp
+// treats as "no saved seed".
+//
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t nvs_handle;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode;
+typedef int esp_err_t;
+
+esp_err_t nvs_open(const char *name, nvs_open_mode mode, nvs_handle *handle);
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out, size_t *len);
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t len);
+esp_err_t nvs_erase_all(nvs_handle handle);
+esp_err_t nvs_commit(nvs_handle handle);
+void nvs_close(nvs_handle handle);
@@ -3,3 +3,177 @@
 
 void ACBase::set_debug(bool debug) { _debug = debug; }
 
+// Handlers that only know about the JsonObject style report.
+void ACBase::report(ACReport& out) {
+    out.merge([this](JsonObject & o) { this->report(o); });
+}
+
+// Offset 0 is kept as a shared empty string; so an unset view
+// (all zero) reads as "".
+//
+void ACRequest::clear() {
+    _topic = _payload = _version = _beat = _cmd = _tag = _rest = { 0, 0, 0 };
+    _buff[0] = 0;
+    _used = 1;
+    beatExtracted = 0;
+    sigVerified = false;
+    securing = secureFailed = false;
+    topicId = -1;
+}
+
+bool ACRequest::_set(view_t & v, const char * s, size_t len) {
+    if (s == NULL)
+        s = "";
+    if (len == NPOS)
+        len = strlen(s);
+
+    if (len == 0 && v.cap == 0) {
+        v = { 0, 0, 0 };
+        return true;
+    };
+
+    // Tail of something already in the buffer - just refer to it.
+    if (s >= _buff && s < _buff + _used && s[len] == 0) {
+        v.off = s - _buff;
+        v.len = len;
+        v.cap = 0;
+        return true;
+    };
+
+    // About to be overwritten in place; so whatever refers into it
+    // has to be moved out first.
+    if ((len < v.cap || (v.cap && v.off + v.cap == _used)) && !_detach(v))
+        return false;
+
+    // Fits in the space we had before.
+    if (len < v.cap) {
+        memmove(_buff + v.off, s, len);
+        _buff[v.off + len] = 0;
+        v.len = len;
+        return true;
+    };
+
+    // Last one in the buffer; so we can grow in place.
+    if (v.cap && v.off + v.cap == _used && v.off + len + 1 <= sizeof(_buff)) {
+        memmove(_buff + v.off, s, len);
+        _buff[v.off + len] = 0;
+        v.len = len;
+        v.cap = len + 1;
+        _used = v.off + v.cap;
+        return true;
+    };
+
+    if (_used + len + 1 > sizeof(_buff))
+        return false;
+
+    memmove(_buff + _used, s, len);
+    _buff[_used + len] = 0;
+    v.off = _used;
+    v.len = len;
+    v.cap = len + 1;
+    _used += v.cap;
+
+    return true;
+}
+
+bool ACRequest::_prepend(view_t & v, const char * prefix) {
+    size_t plen = strlen(prefix);
+    size_t len = v.len + plen;
+
+    if ((len < v.cap || (v.cap && v.off + v.cap == _used)) && !_detach(v))
+        return false;
+
+    if (len < v.cap || (v.cap && v.off + v.cap == _used && v.off + len + 1 <= sizeof(_buff))) {
+        memmove(_buff + v.off + plen, _buff + v.off, v.len + 1);
+        memcpy(_buff + v.off, prefix, plen);
+        if (v.off + v.cap == _used && len >= v.cap) {
+            v.cap = len + 1;
+            _used = v.off + v.cap;
+        };
+        v.len = len;
+        return true;
+    };
+
+    if (_used + len + 1 > sizeof(_buff))
+        return false;
+
+    memcpy(_buff + _used, prefix, plen);
+    memcpy(_buff + _used + plen, _buff + v.off, v.len + 1);
+    v.off = _used;
+    v.len = len;
+    v.cap = len + 1;
+    _used += v.cap;
+
+    return true;
+}
+
+// A view set to the tail of another (e.g. rest to the remainder of the
+// payload) shares its space; copy it out before that is overwritten.
+// Which is rare; a reply is usually parsed once and not modified.
+//
+bool ACRequest::_detach(view_t & v) {
+    view_t * views[] = { &_topic, &_payload, &_version, &_beat, &_cmd, &_tag, &_rest };
+
+    for (view_t * w : views) {
+        if (w == &v || w->cap || w->off < v.off || w->off >= v.off + v.cap)
+            continue;
+        if (_used + w->len + 1 > sizeof(_buff))
+            return false;
+        memcpy(_buff + _used, _buff + w->off, w->len + 1);
+        w->off = _used;
+        w->cap = w->len + 1;
+        _used += w->cap;
+    };
+    return true;
+}
+
+#define LCOPY(dst, src) { strncpy(dst, src, sizeof(dst) - 1); dst[sizeof(dst) - 1] = 0; }
+
+ACLegacyRequest::ACLegacyRequest(ACRequest * req) {
+    LCOPY(topic, req->topic());
+    LCOPY(payload, req->payload());
+    LCOPY(version, req->version());
+    LCOPY(beat, req->beat());
+    LCOPY(cmd, req->cmd());
+    LCOPY(tag, req->tag());
+    LCOPY(rest, req->rest());
+    tmp[0] = 0;
+    beatExtracted = req->beatExtracted;
+}
+
+// Only write back what changed; so that unchanged fields keep
+// sharing space with the payload.
+//
+#define LSTORE(field) { if (strcmp(field, req->field()) && !req->set_ ## field(field)) return false; }
+
+bool ACLegacyRequest::store(ACRequest * req) {
+    LSTORE(topic);
+    LSTORE(payload);
+    LSTORE(version);
+    LSTORE(beat);
+    LSTORE(cmd);
+    LSTORE(tag);
+    LSTORE(rest);
+    req->beatExtracted = beatExtracted;
+    return true;
+}
+
+// A request that no longer fits after the legacy handler is done with
+// it is treated as a failure; rather than passed on half updated.
+//
+#define LCALL(type, method, fail) \
+type ACLegacySecurityHandler::method(ACRequest * req) { \
+    ACLegacyRequest * lreq = new ACLegacyRequest(req); \
+    type r = method(lreq); \
+    if (!lreq->store(req)) \
+        r = fail; \
+    delete lreq; \
+    return r; \
+}
+
+LCALL(ACSecurityHandler::acauth_results, helo, FAIL);
+LCALL(ACSecurityHandler::acauth_results, verify, FAIL);
+LCALL(ACSecurityHandler::acauth_results, secure, FAIL);
+LCALL(ACSecurityHandler::acauth_results, cloak, FAIL);
+LCALL(ACSecurityHandler::acauth_results, tag_mac, FAIL);
+LCALL(ACBase::cmd_result_t, handle_cmd, CMD_DECLINE);
@@ -6,6 +6,7 @@
 #include <ArduinoJson.h>
 
 #include "MakerSpaceMQTT.h"
+#include "ACReport.h"
 
 typedef unsigned long beat_t;
 extern beat_t beatCounter;      // My own timestamp - manually kept due to SPI timing issues.
@@ -13,19 +14,85 @@ extern beat_t beat_absdelta(beat_t a, beat_t b);
 
 #define MAX_TOKEN_LEN (128)
 
+// Topic, payload and everything extracted from the payload share one
+// buffer; room for a full topic and payload plus a bit for the tokens
+// (version, beat, cmd) and for the signature prefix on the way out.
+//
+#ifndef ACREQUEST_BUFFSIZE
+#define ACREQUEST_BUFFSIZE (MAX_TOKEN_LEN + MAX_MSG + MAX_TOKEN_LEN)
+#endif
+
 class ACRequest {
 public:
-    ACRequest() { topic[0] = payload[0] = rest[0] = 0; };
+    ACRequest() { clear(); };
     ACRequest(const char * _topic, const char * _payload) {
-        strncpy(topic, _topic, sizeof(topic));
-        strncpy(payload, _payload, sizeof(payload));
-        strncpy(rest, _payload, sizeof(payload));
+        clear();
+        set_topic(_topic, _min(strlen(_topic), (size_t)MAX_TOKEN_LEN - 1));
+        set_payload(_payload, _min(strlen(_payload), (size_t)MAX_MSG - 1));
+        set_rest(payload());
     };
+    static const size_t NPOS = (size_t) -1;
+
+    void clear();
+
     // raw data as/when received:
+    int topicId;            // As interned by ACNode (-1 if not known).
+    const char * topic()    { return _get(_topic); }
+    const char * payload()  { return _get(_payload); }
+
+    // data as extracted from any payload.
+    beat_t beatExtracted;
+    bool sigVerified;       // Signature already checked; see verify_batch().
+    bool securing;          // With the crypto worker; see secure() and PENDING.
+    bool secureFailed;      // .. and it could not be secured.
+    const char * version()  { return _get(_version); }
+    const char * beat()     { return _get(_beat); }
+    const char * cmd()      { return _get(_cmd); }
+    const char * tag()      { return _get(_tag); }
+    const char * rest()     { return _get(_rest); }
+
+    // Setters copy into the shared buffer; except when passed the tail
+    // of a string already in the buffer (e.g. rest as the remainder of
+    // the payload) - that is referenced, not copied; until the string
+    // it refers into is changed. All return false if the buffer is
+    // exhausted.
+    //
+    bool set_topic(const char * s, size_t len = NPOS)    { return _set(_topic, s, len); }
+    bool set_payload(const char * s, size_t len = NPOS)  { return _set(_payload, s, len); }
+    bool set_version(const char * s, size_t len = NPOS)  { return _set(_version, s, len); }
+    bool set_beat(const char * s, size_t len = NPOS)     { return _set(_beat, s, len); }
+    bool set_cmd(const char * s, size_t len = NPOS)      { return _set(_cmd, s, len); }
+    bool set_tag(const char * s, size_t len = NPOS)      { return _set(_tag, s, len); }
+    bool set_rest(const char * s, size_t len = NPOS)     { return _set(_rest, s, len); }
+
+    // Used when wrapping outbound messages (beat, signature).
+    bool prepend_payload(const char * prefix)            { return _prepend(_payload, prefix); }
+
+    size_t used() { return _used; }
+private:
+    typedef struct { uint16_t off, len, cap; } view_t;
+    view_t _topic, _payload, _version, _beat, _cmd, _tag, _rest;
+    uint16_t _used;
+    char _buff[ACREQUEST_BUFFSIZE];
+
+    const char * _get(view_t & v) { return _buff + v.off; }
+    bool _set(view_t & v, const char * s, size_t len);
+    bool _prepend(view_t & v, const char * prefix);
+    bool _detach(view_t & v);
+};
+
+// The fixed size layout of ACRequest from before it became a set of views
+// on a single buffer; about 2k7 per request. Only used by the adapter
+// below - so that handlers written against the old layout keep working.
+//
+class ACLegacyRequest {
+public:
+    ACLegacyRequest(ACRequest * req);
+    bool store(ACRequest * req);
+
     char topic[MAX_TOKEN_LEN];
     char payload[MAX_MSG];
 
-    // data as extracted from any payload.
     beat_t beatExtracted;
     char version[MAX_TOKEN_LEN];
     char beat[MAX_TOKEN_LEN];
@@ -44,9 +111,19 @@ public:
     virtual void begin() { return; };
     virtual void loop() { return; };
     virtual void stop() { return; };
-    virtual void report(JsonObject& report) { return; }
+    // Network link came up (with an IP) or went down; called from loop().
+    virtual void link_changed(bool up) { return; };
+    virtual void report(ACReport& report);
+    virtual void report(JsonObject& report) { return; } // Legacy; see ACReport::merge().
 
     virtual cmd_result_t handle_cmd(ACRequest * req) { return CMD_DECLINE; };
+
+    // NULL terminated list of the command verbs handled by handle_cmd(); which
+    // are then dispatched directly. The default, NULL, means `unknown'; and
+    // gets the handler offered every command no one else claimed.
+    //
+    virtual const char * const * commands() { return NULL; };
+    static const char * const * no_commands() { static const char * const none[] = { NULL }; return none; };
     
     virtual void set_debug(bool debug);
 protected:
@@ -59,11 +136,49 @@ class ACSecurityHandler : public ACBase {
 public:
     virtual const char * name() { return "ACSecurityHandler"; }
     
-    typedef enum acauth_results { DECLINE, FAIL, PASS, OK } acauth_result_t;
+    // PENDING; secure() handed the request to the crypto worker. It sets
+    // ACRequest::securing until done; the outcome is in secureFailed.
+    //
+    typedef enum acauth_results { DECLINE, FAIL, PASS, OK, PENDING } acauth_result_t;
     
     virtual acauth_results helo(ACRequest * req) { return ACSecurityHandler::DECLINE; }
     virtual acauth_results verify(ACRequest * req) { return FAIL; }
+    // Optional; sees the requests that arrived back to back before each
+    // goes through verify(). E.g. to check their signatures in one go.
+    virtual void verify_batch(ACRequest ** reqs, size_t n) { return; }
+    // True while the last verify_batch() is still being worked on (e.g.
+    // by the crypto worker); the requests are held back until then.
+    virtual bool verifying() { return false; }
     virtual acauth_results secure(ACRequest * req) { return FAIL; }
     virtual acauth_results cloak(ACRequest * req) { return FAIL; }
+    // Optional; replaces the tag by a keyed digest of it. For the audit
+    // events; which only need to tell the master which tag it was.
+    virtual acauth_results tag_mac(ACRequest * req) { return DECLINE; }
+};
+
+// Adapter for security handlers written against the old ACRequest
+// layout; derive from this rather than from ACSecurityHandler and
+// take an ACLegacyRequest. The request is expanded into the old
+// layout for the duration of the call only.
+//
+class ACLegacySecurityHandler : public ACSecurityHandler {
+public:
+    virtual const char * name() { return "ACLegacySecurityHandler"; }
+
+    virtual acauth_results helo(ACLegacyRequest * req) { return DECLINE; }
+    virtual acauth_results verify(ACLegacyRequest * req) { return FAIL; }
+    virtual acauth_results secure(ACLegacyRequest * req) { return FAIL; }
+    virtual acauth_results cloak(ACLegacyRequest * req) { return FAIL; }
+    // Handlers of old had no audit tags; by default theirs is the cloaked
+    // tag, which their master can undo. Used when it fits the event.
+    virtual acauth_results tag_mac(ACLegacyRequest * req) { return cloak(req); }
+    virtual cmd_result_t handle_cmd(ACLegacyRequest * req) { return CMD_DECLINE; }
+
+    acauth_results helo(ACRequest * req);
+    acauth_results verify(ACRequest * req);
+    acauth_results secure(ACRequest * req);
+    acauth_results cloak(ACRequest * req);
+    acauth_results tag_mac(ACRequest * req);
+    cmd_result_t handle_cmd(ACRequest * req);
 };
 #endif
@@ -27,6 +27,7 @@
 
 #include <common-utils.h>
 #include <ACBase.h>
+#include <Scheduler.h>
 #include <LED.h>
 
 #include <ArduinoJson.h>
@@ -37,6 +38,43 @@ extern char * strsepspace(char **p);
 
 #define REPORT_PERIOD (5*60*1000) 	// Every 5 minutes - also triggers alarm in monitoring when awol
 
+#ifndef REPORT_FULL_EVERY
+#define REPORT_FULL_EVERY (12)		// In delta mode; a full snapshot every so many reports.
+#endif
+
+#ifndef MAX_HANDLERS
+#define MAX_HANDLERS (16)
+#endif
+
+#ifndef MAX_SECURITY_HANDLERS
+#define MAX_SECURITY_HANDLERS (4)
+#endif
+
+// Size of the (open addressed) command verb table; power of two.
+#ifndef CMD_TABLE_SIZE
+#define CMD_TABLE_SIZE (32)
+#endif
+
+// Inbound messages that arrive back to back are verified together;
+// at most this many. 1 verifies each as it comes in.
+#ifndef VERIFY_BATCH_MAX
+#define VERIFY_BATCH_MAX (8)
+#endif
+
+// Approval requests are kept in flight until the master replies; and
+// retransmitted if it does not do so quickly enough.
+#ifndef MAX_APPROVALS_IN_FLIGHT
+#define MAX_APPROVALS_IN_FLIGHT (4)
+#endif
+
+#ifndef APPROVAL_RETRANSMIT
+#define APPROVAL_RETRANSMIT (800)	// mSeconds
+#endif
+
+#ifndef APPROVAL_MAX_TRIES
+#define APPROVAL_MAX_TRIES (4)
+#endif
+
 // typedef unsigned long beat_t;
 // extern beat_t beatCounter;      // My own timestamp - manually kept due to SPI timing issues.
 
@@ -60,7 +98,7 @@ typedef enum {
 
 #define HAS_SIG2
 
-typedef enum { PROTO_SIG2, PROTO_NONE } acnode_proto_t;
+typedef enum { PROTO_SIG2, PROTO_NONE, PROTO_SIG3 } acnode_proto_t;
 
 // We should prolly split this in an aACLogger and a logging class
 class ACLog : public ACBase, public Print 
@@ -86,6 +124,11 @@ public:
             (*it)->stop();
         }
     };
+    virtual void link_changed(bool up) {
+        for (auto it = handlers.begin(); it != handlers.end(); ++it) {
+            (*it)->link_changed(up);
+        }
+    };
     size_t write(byte a) {
         for (auto it = handlers.begin(); it != handlers.end(); ++it) {
             (*it)->write(a);
@@ -103,7 +146,14 @@ public:
 
     const char * name() { return "ACNode"; }
 
-    void set_report_period(const unsigned long period) { _report_period = period; };
+    void set_report_period(const unsigned long period) { _report_period = period; _scheduler.set_period(_report_task, period); };
+    // Only send what changed since the previous report; with a full
+    // snapshot on connect, on a 'report' command and every REPORT_FULL_EVERY.
+    void set_report_delta(bool delta) { _report_delta = delta; report_resync(); };
+    void report_resync() { _report_resync = true; _scheduler.reschedule(_report_task, 0); };
+    // Send the report as MessagePack on the telemetry topic; rather than
+    // as a JSON line through Log.
+    void set_report_binary(bool binary) { _report_encoding = binary ? ACReport::MSGPACK : ACReport::JSON; };
     void set_mqtt_host(const char *p);
     void set_mqtt_port(uint16_t p);
     void set_mqtt_prefix(const char *p);
@@ -117,6 +167,9 @@ public:
     void set_machine(const char *p);
     void set_device1(const char *p);
     void set_device2(const char *p);
+    // Ask for device1 and device2 in one request ('device1,device2' as the
+    // target); needs a master that understands target lists.
+    void set_multi_target(bool multi) { _multi_target = multi; };
     void set_master(const char *p);
 
     uint16_t mqtt_port;
@@ -128,6 +181,25 @@ public:
     char master[MAX_NAME];
     char logpath[MAX_NAME];
     char mqtt_topic_prefix[MAX_NAME];
+
+    // Topics are formatted once; whenever the configuration changes, and
+    // interned. Inbound topics are matched against this table rather
+    // than taken apart on every message.
+    //
+    typedef enum {
+        TOPIC_UNKNOWN = -1,
+        TOPIC_TO_MASTER,        // prefix/master/moi  - what we send on.
+        TOPIC_FROM_MASTER,      // prefix/moi/master  - replies for us.
+        TOPIC_MASTER_BCAST,     // prefix/master/master
+        TOPIC_LOG,              // prefix/logpath/moi
+        TOPIC_TELEMETRY,        // prefix/telemetry/moi - binary reports.
+        TOPIC_FIRST_FREE        // and any others that get interned.
+    } topic_id_t;
+
+    void update_topics();
+    int intern_topic(const char * topic);
+    int lookup_topic(const char * topic);
+    const char * topic(int id) { return (id >= 0 && id < _nTopics) ? _topics[id].topic : NULL; };
     
     IPAddress localIP() { 
 #ifdef ESP32
@@ -183,13 +255,32 @@ public:
     ACNode& onDenied(THandlerFunction_SimpleCallback fn)
 	    { _denied_callback = fn; return *this; };
     
-    typedef std::function<void(JsonObject &report)> THandlerFunction_Report;
+    typedef std::function<void(ACReport &report)> THandlerFunction_Report;
     void onReport(THandlerFunction_Report fn)
             { _report_callback = fn; return; };
 
+    typedef std::function<void(JsonObject &report)> THandlerFunction_JsonReport;
+    void onReport(THandlerFunction_JsonReport fn)
+            { _json_report_callback = fn; return; };
+
     void loop();
     void begin(eth_board_t board = BOARD_AART);
+    void link_changed(bool up);
+
+    // Periodic and one-shot tasks for handlers; run from loop(). See Scheduler.h.
+    int every(const char * name, unsigned long period, ACScheduler::THandlerFunction_Task fn)
+            { return _scheduler.every(name, period, fn); };
+    int after(const char * name, unsigned long delay, ACScheduler::THandlerFunction_Task fn)
+            { return _scheduler.after(name, delay, fn); };
+    void cancel(int task) { _scheduler.cancel(task); };
+    void reschedule(int task, unsigned long in) { _scheduler.reschedule(task, in); };
+    // Sleep up to this many mSeconds at the end of loop() when no task is due; 0 is off.
+    void set_idle_sleep(unsigned long max) { _idle_sleep = max; };
     cmd_result_t handle_cmd(ACRequest * req);
+    const char * const * commands() { 
+        static const char * const cmds[] = { "ping", "report", "profile", "approved", "open", "denied", NULL };
+        return cmds;
+    };
    
     void addHandler(ACBase *handler);
     void addSecurityHandler(ACSecurityHandler *handler);
@@ -198,7 +289,12 @@ public:
     
     void request_approval(const char * tag, const char * operation = NULL, const char * target = NULL, bool useCacheOk= true);
 
-    char * cloak(char *tag);
+    // Context is what the cloaked tag gets bound to (e.g. "energize node
+    // machine"); AEAD cloaks authenticate it. NULL for none.
+    char * cloak(char *tag, const char * context = NULL);
+    // Keyed digest of the tag for the audit events; '-' if no security
+    // handler can make one (e.g. no session yet).
+    const char * tag_mac(const char * tag, char * out, size_t len);
     
     void set_debugAlive(bool debug);
     bool isConnected(); // ethernet/wifi is up with valid IP.
@@ -213,6 +309,9 @@ public:
     void send(const char * payload) { send(NULL, payload, false); };
     void send(const char * topic, const char * payload, bool raw = false);
 
+    // Like send(); but persisted in flash when the broker is not reachable.
+    void audit(const char * event);
+
     // This function should be private - but we're calling
     // it from a C callback in the mqtt subsystem.
     //
@@ -228,15 +327,43 @@ private:
     THandlerFunction_SimpleCallback _approved_callback, _denied_callback;
     THandlerFunction_Command _command_callback;
     THandlerFunction_Report _report_callback;
+    THandlerFunction_JsonReport _json_report_callback;
 
     beat_t _lastSwipe;    
     WiFiClient _espClient;
     
     void configureMQTT();
-    void reconnectMQTT();
+    bool reconnectMQTT();
     void mqttLoop();
+    void approvalLoop();
+
+    // Received but not yet verified/handled; see VERIFY_BATCH_MAX. And
+    // the batch the security handlers are still verifying.
+    ACRequest * _inbound[VERIFY_BATCH_MAX];
+    unsigned int _nInbound = 0;
+    ACRequest * _verifying[VERIFY_BATCH_MAX];
+    unsigned int _nVerifying = 0;
+    bool verifying();
+    void process_inbound();
+    void process(ACRequest * req);
     void pop();
 
+    typedef struct {
+        char * payload;         // NULL when the slot is free.
+        char target[2 * MAX_NAME];      // Or a device1,device2 list.
+        beat_t first, last;     // beat of first and last transmit; see approval_stamped().
+        unsigned long sent;
+        uint8_t tries;          // Past APPROVAL_MAX_TRIES once we gave up.
+        uint8_t pending;        // Devices not yet answered; bit i for the i-th in target.
+    } approval_t;
+    approval_t _inflight[MAX_APPROVALS_IN_FLIGHT];
+
+    void track_approval(const char * target, const char * payload);
+    approval_t * find_approval(const char * target);
+    approval_t * find_approval_device(const char * device, uint8_t * bit);
+    void free_approval(approval_t * a);
+    void approval_stamped(const char * payload, beat_t beat);
+
     const char * state2str(int state);
     
     // We register a bunch of handlers - rather than calling them
@@ -244,17 +371,53 @@ private:
     // to not link in unused functionality. Thus making the firmware
     // small enough for the ESP and ENC+Arduino versions.
     //
-    std::list<ACBase *> _handlers;
-    std::list<ACSecurityHandler*> _security_handlers;
+    ACBase * _handlers[MAX_HANDLERS];
+    int _nHandlers;
+    int _handler_prof[MAX_HANDLERS];
+    ACSecurityHandler * _security_handlers[MAX_SECURITY_HANDLERS];
+    int _nSecurityHandlers;
+
+    // Commands are dispatched on their verb; through a table built at
+    // startup as handlers are added. Handlers that do not tell us their
+    // verbs get offered whatever is left; in the order they were added.
+    //
+    typedef struct { const char * verb; ACBase * handler; } cmd_entry_t;
+    cmd_entry_t _cmds[CMD_TABLE_SIZE];
+    int _nCmds;
+    ACBase * _catchall[MAX_HANDLERS];
+    int _nCatchall;
+
+    void add_commands(ACBase * handler);
+    ACBase * find_command(const char * verb);
+    bool is_security_handler(ACBase * h);
+
+    typedef struct { char topic[MAX_TOPIC]; uint16_t len; uint32_t hash; } interned_topic_t;
+    interned_topic_t _topics[MAX_INTERNED_TOPICS];
+    int _nTopics;
+    // Open addressed on the hash, linear probing; index + 1, 0 is empty.
+    uint8_t _topic_bucket[2 * MAX_INTERNED_TOPICS];
+    void rehash_topics();
 protected:
     const char * _ssid;
     const char * _ssid_passwd;
     unsigned long _report_period;
+    bool _report_delta, _report_resync;
+    bool _multi_target;
+    int _report_task;
+    void send_report();
+    void send_crypto_report();
+    void publish_report(ACReport & report, const char * buff);
+    void loop_rate();
+    unsigned long _idle_sleep;
+    ACScheduler _scheduler;
+    ACReport::encoding_t _report_encoding;
+    unsigned long _report_seq;
+    ACReport::History _report_history;
     bool _wired;
     acnode_proto_t _proto;
     char _lasttag[MAX_TAG_LEN * 4];      // Up to a 3 digit byte and a dash or terminating \0. */
 // stat counters
-   unsigned long _approve, _deny, _reqs, _mqtt_reconnects, _start_beat;
+   unsigned long _approve, _deny, _reqs, _mqtt_reconnects, _start_beat, _retransmits, _dups;
 };
 
 
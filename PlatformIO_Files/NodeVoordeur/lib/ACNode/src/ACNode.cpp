@@ -1,6 +1,12 @@
 #include <ACNode.h>
 #include "ConfigPortal.h"
 #include <Cache.h>
+#include <Outbox.h>
+#include <CryptoWorker.h>
+#include <Profile.h>
+
+// Profile slots for the fixed phases of loop(); handlers get theirs in addHandler().
+static int profLog, profCache, profOutbox, profApprovals, profMqtt;
 
 // Sort of a fake singleton to overcome callback
 // limits in MQTT callback and elsewhere.
@@ -35,18 +41,24 @@ beat_t beatCounter = 0;      // My own timestamp - manually kept due to SPI timi
 
 void ACNode::set_mqtt_host(const char *p) { strncpy(mqtt_server,p, sizeof(mqtt_server)); };
 void ACNode::set_mqtt_port(uint16_t p)  { mqtt_port = p; };
-void ACNode::set_mqtt_prefix(const char *p)  { strncpy(mqtt_topic_prefix,p, sizeof(mqtt_topic_prefix)); };
-void ACNode::set_mqtt_log(const char *p)  { strncpy(logpath,p, sizeof(logpath)); };
-void ACNode::set_moi(const char *p)  { strncpy(moi,p, sizeof(moi)); };
+void ACNode::set_mqtt_prefix(const char *p)  { strncpy(mqtt_topic_prefix,p, sizeof(mqtt_topic_prefix)); update_topics(); };
+void ACNode::set_mqtt_log(const char *p)  { strncpy(logpath,p, sizeof(logpath)); update_topics(); };
+void ACNode::set_moi(const char *p)  { strncpy(moi,p, sizeof(moi)); update_topics(); };
 void ACNode::set_machine(const char *p)  { strncpy(machine,p, sizeof(machine)); };
 void ACNode::set_device1(const char *p)  { strncpy(device1,p, sizeof(device1)); };
 void ACNode::set_device2(const char *p)  { strncpy(device2,p, sizeof(device2)); };
-void ACNode::set_master(const char *p)  { strncpy(master,p, sizeof(master)); };
+void ACNode::set_master(const char *p)  { strncpy(master,p, sizeof(master)); update_topics(); };
 
 void ACNode::pop() {
     strncpy(mqtt_server, MQTT_SERVER, sizeof(mqtt_server));
     mqtt_port = MQTT_DEFAULT_PORT;
     _report_period = REPORT_PERIOD;
+    _report_delta = false;
+    _multi_target = false;
+    _report_encoding = ACReport::JSON;
+    _report_resync = true;
+    _report_seq = 0;
+    _idle_sleep = 0;
 
     moi[0] = 0;
     if (machine == NULL || machine[0] == 0)
@@ -55,6 +67,23 @@ void ACNode::pop() {
     strncpy(mqtt_topic_prefix, MQTT_TOPIC_PREFIX, sizeof(mqtt_topic_prefix));
     strncpy(master, MQTT_TOPIC_MASTER, sizeof(master));
     strncpy(logpath, MQTT_TOPIC_LOG, sizeof(logpath));
+
+    _nTopics = 0;
+    update_topics();
+
+    _nHandlers = _nSecurityHandlers = _nCmds = _nCatchall = 0;
+    bzero(_cmds, sizeof(_cmds));
+    add_commands(this);
+
+    profLog = profileSlot("log");
+    profCache = profileSlot("cache");
+    profOutbox = profileSlot("outbox");
+    profApprovals = profileSlot("approvals");
+    profMqtt = profileSlot("mqtt");
+
+    _report_task = _scheduler.every("report", _report_period, [this]() { send_report(); });
+    _scheduler.reschedule(_report_task, 0);
+    _scheduler.every("looprate", 30 * 1000, [this]() { loop_rate(); });
 };
 
 ACNode::ACNode(const char * m, bool wired, const char * dev1, const char * dev2, acnode_proto_t proto) : 
@@ -95,6 +124,64 @@ ACNode::ACNode(const char *m, const char * ssid , const char * ssid_passwd, cons
 }
 
 
+// Case insensitive djb2 - as some verbs (approved, denied) have
+// historically been matched case insensitive.
+//
+static uint32_t cmd_hash(const char * verb) {
+    uint32_t hash = 5381;
+    for(; *verb; verb++)
+        hash = ((hash << 5) + hash) + tolower(*verb);
+    return hash;
+}
+
+void ACNode::add_commands(ACBase * handler) {
+    const char * const * verbs = handler->commands();
+
+    if (verbs == NULL) {
+        // Does not tell us; so offer it everything.
+        if (_nCatchall < MAX_HANDLERS)
+            _catchall[ _nCatchall++ ] = handler;
+        return;
+    };
+
+    for(; *verbs; verbs++) {
+        // Keep the table at most half full; so probes stay short.
+        if (_nCmds >= CMD_TABLE_SIZE / 2) {
+            Log.printf("Command table full - %s not added.\n", *verbs);
+            continue;
+        };
+        uint32_t i = cmd_hash(*verbs) & (CMD_TABLE_SIZE - 1);
+        while (_cmds[i].verb && strcasecmp(_cmds[i].verb, *verbs))
+            i = (i + 1) & (CMD_TABLE_SIZE - 1);
+
+        if (_cmds[i].verb) {
+            Log.printf("Command %s already claimed by %s; ignored for %s.\n", 
+                *verbs, _cmds[i].handler->name(), handler->name());
+            continue;
+        };
+        _cmds[i].verb = *verbs;
+        _cmds[i].handler = handler;
+        _nCmds++;
+    };
+}
+
+bool ACNode::is_security_handler(ACBase * h) {
+    for (ACSecurityHandler ** it = _security_handlers; it < _security_handlers + _nSecurityHandlers; ++it)
+        if ((ACBase *) *it == h)
+            return true;
+    return false;
+}
+
+ACBase * ACNode::find_command(const char * verb) {
+    uint32_t i = cmd_hash(verb) & (CMD_TABLE_SIZE - 1);
+    while (_cmds[i].verb) {
+        if (!strcasecmp(_cmds[i].verb, verb))
+            return _cmds[i].handler;
+        i = (i + 1) & (CMD_TABLE_SIZE - 1);
+    };
+    return NULL;
+}
+
 void send(const char * topic, const char * payload) {
     _acnode->send(topic,payload);
 }
@@ -103,18 +190,29 @@ void ACNode::set_debugAlive(bool debug) { _debug_alive = debug; }
 
 bool ACNode::isConnected() {
 #ifdef ESP32
-    if (_wired)
-        return eth_connected();
-#endif
+    // Both wired and wifi; kept up to date by WiFiEvent().
+    return eth_connected();
+#else
     return (WiFi.status() == WL_CONNECTED);
+#endif
 };
 
 void ACNode::addHandler(ACBase * handler) {
-    _handlers.insert (_handlers.end(), handler);
+    if (_nHandlers >= MAX_HANDLERS) {
+        Log.printf("Too many handlers - %s not added.\n", handler->name());
+        return;
+    };
+    _handler_prof[ _nHandlers ] = profileSlot(handler->name());
+    _handlers[ _nHandlers++ ] = handler;
+    add_commands(handler);
 }
 
 void ACNode::addSecurityHandler(ACSecurityHandler * handler) {
-    _security_handlers.insert(_security_handlers.end(), handler);
+    if (_nSecurityHandlers >= MAX_SECURITY_HANDLERS) {
+        Log.printf("Too many security handlers - %s not added.\n", handler->name());
+        return;
+    };
+    _security_handlers[ _nSecurityHandlers++ ] = handler;
     
     // Some handlers need a begin or loop maintenance cycle - so we
     // also add these to the normal loop.
@@ -134,9 +232,10 @@ void ACNode::begin(eth_board_t board /* default is BOARD_AART */)
         debugFlash();
 #endif
 #ifdef ESP32 
-    if (_wired)  {
-       WiFi.onEvent(WiFiEvent);
+    // Also for wifi; this is what keeps isConnected() current.
+    WiFi.onEvent(WiFiEvent);
 
+    if (_wired)  {
        switch(board) {
        case BOARD_OLIMEX:
          ETH.begin(ETH_PHY_ADDR, 12 /* power */, ETH_PHY_MDC, ETH_PHY_MDIO, ETH_PHY_LAN8720, ETH_CLOCK_GPIO17_OUT);
@@ -221,6 +320,11 @@ void ACNode::begin(eth_board_t board /* default is BOARD_AART */)
     configureMQTT();
  
     switch(_proto) {
+   case PROTO_SIG3:
+#ifdef HAS_SIG2
+	sig2.set_session_mac(true);
+#endif
+	// fall through - SIG/3 is SIG/2 with a faster steady state.
    case PROTO_SIG2:
 #ifdef HAS_SIG2
        	addSecurityHandler(&sig2);
@@ -230,15 +334,14 @@ void ACNode::begin(eth_board_t board /* default is BOARD_AART */)
         // Lets hope they are added `higher up'.
         break;
   };
-  if (_security_handlers.size() == 0) 
+  if (_nSecurityHandlers == 0) 
 	Log.println("*** WARNING -- no protocols defined AT ALL. This is prolly not what you want.");
 
     // Note that this will also run the security and ohter handlers; see
     // addSecurityHandler().
     //
     {
-        std::list<ACBase *>::iterator it;
-        for (it =_handlers.begin(); it!=_handlers.end(); ++it) {
+        for (ACBase ** it = _handlers; it < _handlers + _nHandlers; ++it) {
    	    Debug.printf("%s.begin()\n", (*it)->name());
             (*it)->begin();
         }
@@ -253,13 +356,16 @@ void ACNode::begin(eth_board_t board /* default is BOARD_AART */)
   };
 #endif
   prepareCache(false);
+  prepareOutbox(false);
+  prepareCryptoWorker();
 }
 
-char * ACNode::cloak(char * tag) {
+char * ACNode::cloak(char * tag, const char * context) {
     ACRequest q = ACRequest();
-    strncpy(q.tag, tag, sizeof(q.tag));
-    std::list<ACSecurityHandler *>::iterator it;
-    for (it =_security_handlers.begin(); it!=_security_handlers.end(); ++it) {
+    q.set_tag(tag);
+    if (context)
+        q.set_payload(context);
+    for (ACSecurityHandler ** it = _security_handlers; it < _security_handlers + _nSecurityHandlers; ++it) {
 
         int r = (*it)->cloak(&q);
         
@@ -269,7 +375,7 @@ char * ACNode::cloak(char * tag) {
             case ACSecurityHandler::PASS:
                 break;
             case ACSecurityHandler::OK:
-    		    strncpy(tag, q.tag, MAX_MSG);
+    		    strncpy(tag, q.tag(), MAX_MSG);
 		        return tag;
                 break;
             case ACSecurityHandler::FAIL:
@@ -282,7 +388,29 @@ char * ACNode::cloak(char * tag) {
     return NULL;
 }
 
+const char * ACNode::tag_mac(const char * tag, char * out, size_t len) {
+    ACRequest q = ACRequest();
+    q.set_tag(tag);
+    strncpy(out, "-", len);
+    for (ACSecurityHandler ** it = _security_handlers; it < _security_handlers + _nSecurityHandlers; ++it) {
+        // One that does not fit (e.g. a legacy cloak) is no use truncated.
+        if ((*it)->tag_mac(&q) == ACSecurityHandler::OK && strlen(q.tag()) < len) {
+            strncpy(out, q.tag(), len);
+            break;
+        };
+    };
+    out[len - 1] = 0;
+    return out;
+}
+
 void ACNode::request_approval_devices(const char * tag, const char * operation, const char * target, bool useCacheOk) {
+    // One cloak, one signature and one message for both; see protocol.txt.
+    if (_multi_target && *device1 && *device2) {
+        char targets[2 * MAX_NAME];
+        snprintf(targets, sizeof(targets), "%s,%s", device1, device2);
+        request_approval(tag, operation, targets, useCacheOk);
+        return;
+    };
     if (device1 && *device1) {
         request_approval(tag, operation, device1, useCacheOk);
     }
@@ -311,6 +439,15 @@ void ACNode::request_approval(const char * tag, const char * operation, const ch
         if (_approved_callback && useCacheOk && checkCache(_lasttag)) {
             _approved_callback(machine);
             setCache(_lasttag, true, (unsigned long) beatCounter);
+
+            // The master never saw this one; so tell it after the fact. Tag
+            // is sent as a keyed digest; see tag_mac().
+            char event[MAX_OUTBOX_EVENT];
+            size_t n = snprintf(event, sizeof(event), "event cacheapproved %s %lu ", 
+                machine, (unsigned long) beatCounter);
+            if (n < sizeof(event) - 1)
+                tag_mac(_lasttag, event + n, sizeof(event) - n);
+            audit(event);
             return;
         };
     }
@@ -326,7 +463,8 @@ void ACNode::request_approval(const char * tag, const char * operation, const ch
     // We need to copy this - as cloak will overwrite this in place.
     // todo - redesing to be more embedded friendly.
 	strncpy(tmp, tag, MAX_MSG);
-	if (!(cloak(tmp))) {
+	snprintf(buff, MAX_MSG, "%s %s %s", operation, moi, target);
+	if (!(cloak(tmp, buff))) {
 		Log.println("Coud not cloak the tag, approval request not sent");
         goto _return_request_approval;
 //		return;
@@ -340,6 +478,7 @@ void ACNode::request_approval(const char * tag, const char * operation, const ch
         _lastSwipe = beatCounter;
         _reqs++;
 	send(NULL,buff);
+	track_approval(target, buff);
 
 _return_request_approval:
 	if (tmp) free(tmp);
@@ -347,126 +486,376 @@ _return_request_approval:
  	return;
 };
 
-float loopRate = 0;
+// Audit relevant events go out directly when we can; otherwise into
+// the flash backed outbox - which is then replayed in order once
+// we are back up. We never overtake anything already in the outbox.
+//
+void ACNode::audit(const char * event) {
+    if (isUp() && outboxDepth() == 0) {
+        send(event);
+        return;
+    };
+    if (!outboxAdd(event))
+        Log.printf("Audit event lost: %s\n", event);
+}
 
-void ACNode::loop() {
-    {
-	static unsigned long last = 0, lastCntr = 0, Cntr = 0;
-	Cntr++;
-	if (millis() - last > (unsigned long)(30 * 1000)) {
-		float rate =  1000. * (Cntr - lastCntr)/(millis() - last) + 0.05;
-		loopRate = rate;
-		if (rate > 10)
-			Debug.printf("Loop rate: %.1f #/second\n", rate);
-		else
-			Log.printf("Warning: LOW Loop rate: %.1f #/second\n", rate);
-		last = millis();
-		lastCntr = Cntr;
-	}
-    }
+// PubSubClient can only publish at QoS 0; so rather than rely on a PUBACK
+// we treat the reply of the master (approved/denied) as the ack; and
+// retransmit if it does not come back within APPROVAL_RETRANSMIT. Which
+// is well within the time-out of the user facing state machine.
+//
+void ACNode::track_approval(const char * target, const char * payload) {
+    approval_t * a = find_approval(target);
+
+    // A new swipe for the same target supersedes whatever is in flight.
+    if (!a) 
+        for(int i = 0; i < MAX_APPROVALS_IN_FLIGHT && !a; i++)
+            if (!_inflight[i].payload || !_inflight[i].pending || _inflight[i].tries > APPROVAL_MAX_TRIES)
+                a = &_inflight[i];
+    if (!a) {
+        // Window full; sacrifice the oldest.
+        a = &_inflight[0];
+        for(int i = 1; i < MAX_APPROVALS_IN_FLIGHT; i++)
+            if (_inflight[i].sent < a->sent)
+                a = &_inflight[i];
+    };
+    free_approval(a);
 
-#if 0
-    if (_debug) {
-    	static unsigned long last = millis();
-	static unsigned long sw1, sw2, tock;
-	sw1  += digitalRead(SW1_BUTTON);
-	sw2  += digitalRead(SW1_BUTTON);
-	tock ++;
-	if (millis() - last > 1000) {
-	      Debug.printf("SW1: %d %d SW2: %d %d Relay %d Triac %d\n",
-	                digitalRead(SW1_BUTTON),
-	                abs(tock - sw1),
-	                digitalRead(SW2_BUTTON),
-	                abs(tock - sw2),
-      	 	        digitalRead(RELAY_GPIO),
-      	 	        digitalRead(TRIAC_GPIO)
-      	      );
-    	      last = millis(); sw1 = sw2 = tock = 0;
-   	 }
-    }
-#endif
+    if (!(a->payload = strdup(payload))) {
+        Log.println("Out of memory - approval not tracked.");
+        return;
+    };
+    strncpy(a->target, target, sizeof(a->target) - 1);
+    a->target[sizeof(a->target) - 1] = 0;
+    // Lower bound; the beat goes in when it leaves the publish queue.
+    a->first = a->last = beatCounter;
+    a->sent = millis();
+    a->tries = 1;
+
+    // The master may answer the devices of a list one outcome at a time.
+    int n = 1;
+    for (const char * p = target; *p; p++)
+        if (*p == ',') n++;
+    a->pending = (n >= 8) ? 0xFF : (1 << n) - 1;
+}
+
+ACNode::approval_t * ACNode::find_approval(const char * target) {
+    for(int i = 0; i < MAX_APPROVALS_IN_FLIGHT; i++)
+        if (_inflight[i].payload && !strcmp(_inflight[i].target, target))
+            return &_inflight[i];
+    return NULL;
+}
+
+// The slot whose target (list) has this device; and its bit in pending.
+ACNode::approval_t * ACNode::find_approval_device(const char * device, uint8_t * bit) {
+    size_t len = strlen(device);
+    for(int i = 0; i < MAX_APPROVALS_IN_FLIGHT; i++) {
+        if (!_inflight[i].payload)
+            continue;
+        const char * p = _inflight[i].target;
+        for (int j = 0; j < 8 && p; j++) {
+            const char * e = strchr(p, ',');
+            size_t l = e ? (size_t)(e - p) : strlen(p);
+            if (l == len && !strncmp(p, device, len)) {
+                *bit = 1 << j;
+                return &_inflight[i];
+            };
+            p = e ? e + 1 : NULL;
+        };
+    };
+    return NULL;
+}
+
+// The beat is only stamped on when the request is secured in mqttLoop();
+// which may be a while after it was queued. So record the one it really
+// went out with; that is what the master its reply carries.
+//
+void ACNode::approval_stamped(const char * payload, beat_t beat) {
+    for(int i = 0; i < MAX_APPROVALS_IN_FLIGHT; i++)
+        if (_inflight[i].payload && !strcmp(_inflight[i].payload, payload)) {
+            if (_inflight[i].tries == 1)
+                _inflight[i].first = beat;
+            _inflight[i].last = beat;
+        };
+}
+
+void ACNode::free_approval(approval_t * a) {
+    if (a->payload) 
+        free(a->payload);
+    a->payload = NULL;
+    a->pending = 0;
+}
 
-    {	static unsigned long last = 0;
-	if (millis() - last > _report_period) {
-		last = millis();
+void ACNode::approvalLoop() {
+    if (!isUp())
+        return;
 
-		// DynamicJsonBuffer  jsonBuffer(JSON_OBJECT_SIZE(30) + 500);
-		// JsonObject& out = jsonBuffer.createObject();
+    for(int i = 0; i < MAX_APPROVALS_IN_FLIGHT; i++) {
+        approval_t * a = &_inflight[i];
 
-        DynamicJsonDocument jsonDoc(JSON_OBJECT_SIZE(30) + 500);
+        if (!a->payload || millis() - a->sent < APPROVAL_RETRANSMIT)
+            continue;
 
-		jsonDoc[ "node" ] = moi;
-		jsonDoc[ "machine" ] = machine;
+        // Acked ones are kept around a bit to catch duplicate replies; and
+        // ones we gave up on, as the reply to any of the tries may still come.
+        if (!a->pending || a->tries > APPROVAL_MAX_TRIES) {
+            if (beat_absdelta(beatCounter, a->last) > 60)
+                free_approval(a);
+            continue;
+        };
 
-		jsonDoc[ "maxMqtt" ] = MAX_MSG;
+        if (a->tries == APPROVAL_MAX_TRIES) {
+            Log.printf("No reply on approval request for %s - giving up.\n", a->target);
+            a->tries++;
+            continue;
+        };
 
-		char chipstr[30]; strncpy(chipstr,chipId().c_str(),sizeof(chipstr));
-		jsonDoc[ "id" ] = chipstr;
-		char ipstr[30]; strncpy(ipstr, String(localIP().toString()).c_str(),sizeof(ipstr));
+        Debug.printf("No reply on approval request for %s yet - retransmitting.\n", a->target);
+        send(NULL, a->payload);
+        a->sent = millis();
+        a->tries++;
+        _retransmits++;
+    };
+}
+
+float loopRate = 0;
+static unsigned long loopCntr = 0;
+
+// Runs from the scheduler; every _report_period or straight away on a resync.
+//
+void ACNode::send_report() {
+	bool full = !_report_delta || _report_resync || _report_history.empty() || 
+		(_report_seq % REPORT_FULL_EVERY) == 0;
+	_report_resync = false;
+	if (full)
+		_report_history.reset();
+
+	// Written straight into a static buffer; no document or
+	// String on the heap every report period.
+	//
+	static char buff[MAX_MSG];
+	ACReport jsonDoc(buff, sizeof(buff), _report_encoding);
+
+	jsonDoc[ "node" ] = moi;
+	if (_report_delta) {
+		jsonDoc[ "seq" ] = _report_seq;
+		jsonDoc[ "full" ] = full;
+		jsonDoc.track(&_report_history, full);
+	};
+	_report_seq++;
+	jsonDoc[ "machine" ] = machine;
+
+	jsonDoc[ "maxMqtt" ] = MAX_MSG;
+
+	// Constant for the life of the node; so only stringified once.
+	static char chipstr[20] = "", macstr[20] = "";
+	if (!*chipstr) {
+		strncpy(chipstr, chipId().c_str(), sizeof(chipstr) - 1);
+		strncpy(macstr, macAddressString().c_str(), sizeof(macstr) - 1);
+	};
+	jsonDoc[ "id" ] = chipstr;
+
+	IPAddress ip = localIP();
+	char ipstr[16]; snprintf(ipstr, sizeof(ipstr), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
                 jsonDoc[ "ip" ] = ipstr;
                 jsonDoc[ "net" ] = _wired ? "UTP" : "WiFi";
- 		char macstr[30]; strncpy(macstr, macAddressString().c_str(),sizeof(macstr));
-  		jsonDoc[ "mac" ] = macstr;
+   		jsonDoc[ "mac" ] = macstr;
 
-		jsonDoc[ "beat" ] = beatCounter;
+	jsonDoc[ "beat" ] = beatCounter;
 
-		if (beatCounter > 1542275849 && _start_beat == 0)
-			_start_beat  = beatCounter;
-		else 
-		if (_start_beat)
-			jsonDoc[ "alive-uptime" ] = beatCounter - _start_beat;
+	if (beatCounter > 1542275849 && _start_beat == 0)
+		_start_beat  = beatCounter;
+	else 
+	if (_start_beat)
+		jsonDoc[ "alive-uptime" ] = beatCounter - _start_beat;
 
-		jsonDoc[ "approve" ] = _approve;
-		jsonDoc[ "deny" ] = _deny;
-		jsonDoc[ "requests" ] = _reqs;
+	jsonDoc[ "approve" ] = _approve;
+	jsonDoc[ "deny" ] = _deny;
+	jsonDoc[ "requests" ] = _reqs;
+	jsonDoc[ "retransmits" ] = _retransmits;
+	jsonDoc[ "duplicates" ] = _dups;
 #ifdef ESP32
-		jsonDoc[ "cache_hit" ] =  cacheHit;
-		jsonDoc[ "cache_miss" ] =  cacheMiss;
+	jsonDoc[ "cache_hit" ] =  cacheHit;
+	jsonDoc[ "cache_miss" ] =  cacheMiss;
+	jsonDoc[ "outbox_depth" ] =  outboxDepth();
+	jsonDoc[ "outbox_queued" ] =  outboxQueued;
+	jsonDoc[ "outbox_replayed" ] =  outboxReplayed;
+	jsonDoc[ "outbox_dropped" ] =  outboxDropped;
 #endif
 
-		jsonDoc[ "mqtt_reconnects" ] = _mqtt_reconnects;
+	jsonDoc[ "mqtt_reconnects" ] = _mqtt_reconnects;
+#ifdef HAS_SIG2
+	extern unsigned long sessionsResumed;
+	jsonDoc[ "sessions_resumed" ] = sessionsResumed;
+#endif
 
-		jsonDoc["loop_rate"] = loopRate;
+	jsonDoc["loop_rate"] = loopRate;
 #ifdef ESP32
            	jsonDoc["coreTemp"]  = coreTemp(); 
 #endif
-		jsonDoc["heap_free"] = ESP.getFreeHeap();	
+	jsonDoc["heap_free"] = ESP.getFreeHeap();	
+
+	const profile_slot_t * slow = profileSlowest();
+	if (slow) {
+		jsonDoc["slowest"] = slow->name;
+		jsonDoc["slowest_avg_us"] = (unsigned long)(slow->total / slow->n);
+		jsonDoc["slowest_max_us"] = slow->max;
+	};
+	if (_scheduler.runs) {
+		jsonDoc["sched_late_avg_ms"] = _scheduler.late_total / _scheduler.runs;
+		jsonDoc["sched_late_max_ms"] = _scheduler.late_max;
+	};
 
-        JsonObject out = jsonDoc.to<JsonObject>();
+       		for (ACBase ** it = _handlers; it < _handlers + _nHandlers; ++it) 
+        		(*it)->report(jsonDoc);
 
-		std::list<ACBase *>::iterator it;
-       		for (it =_handlers.begin(); it!=_handlers.end(); ++it) 
-        		(*it)->report(out);
+	if (_json_report_callback) 
+		jsonDoc.merge(_json_report_callback);
+	if (_report_callback) 
+		_report_callback(jsonDoc);	
 
-		if (_report_callback) 
-			_report_callback(out);	
+	publish_report(jsonDoc, buff);
 
-        String buff;
-        serializeJson(jsonDoc, buff);
-        if (buff.length() > MAX_MSG) {
-            buff = buff.substring(0, MAX_MSG);
-        }
+	// Nobody saw these; so the next one needs to be in full.
+	if (_report_delta && !isUp())
+		_report_history.reset();
+}
+
+void ACNode::publish_report(ACReport & jsonDoc, const char * buff) {
+	jsonDoc.finish();
+	if (jsonDoc.truncated())
+		Debug.println("Report truncated; fields dropped.");
+
+	if (_report_encoding == ACReport::MSGPACK) {
+		// Straight out; unsigned and not queued. The next one will do if lost.
+		if (isUp())
+			_client.publish(topic(TOPIC_TELEMETRY), (const uint8_t *) buff, jsonDoc.length());
+		Debug.printf("Telemetry report #%lu: %u fields, %u bytes\n", 
+			_report_seq - 1, jsonDoc.fields(), (unsigned) jsonDoc.length());
+	} else
 		Log.println(buff);
-        }
+}
+
+// The counters of the crypto on the message path; on a 'report crypto'
+// only. Kept out of the periodic report; which has to fit in MAX_MSG.
+//
+void ACNode::send_crypto_report() {
+	static char buff[MAX_MSG];
+	ACReport jsonDoc(buff, sizeof(buff), _report_encoding);
+
+	jsonDoc[ "node" ] = moi;
+	jsonDoc[ "report" ] = "crypto";
+#ifdef HAS_SIG2
+	extern unsigned long sigBatches, sigBatched, sigBatchesFailed;
+	jsonDoc[ "sig_batches" ] = sigBatches;
+	jsonDoc[ "sig_batched" ] = sigBatched;
+	jsonDoc[ "sig_batches_failed" ] = sigBatchesFailed;
+	extern unsigned long trustHit, trustMiss, trustRequests;
+	jsonDoc[ "trust_hit" ] = trustHit;
+	jsonDoc[ "trust_miss" ] = trustMiss;
+	jsonDoc[ "trust_requests" ] = trustRequests;
+	extern unsigned long replayDuplicates, replayStale;
+	jsonDoc[ "replay_duplicates" ] = replayDuplicates;
+	jsonDoc[ "replay_stale" ] = replayStale;
+	extern unsigned long bootEntropyMs, bootKeysMs, bootReadyMs, bootWelcomeMs;
+	jsonDoc[ "boot_entropy_ms" ] = bootEntropyMs;
+	jsonDoc[ "boot_keys_ms" ] = bootKeysMs;
+	jsonDoc[ "boot_announce_ms" ] = bootReadyMs;
+	jsonDoc[ "boot_welcome_ms" ] = bootWelcomeMs;
+#endif
+	if (cryptoJobs) {
+		jsonDoc[ "crypto_jobs" ] = cryptoJobs;
+		jsonDoc[ "crypto_wait_avg_us" ] = cryptoWaitUs / cryptoJobs;
+		jsonDoc[ "crypto_wait_max_us" ] = cryptoWaitMaxUs;
+		jsonDoc[ "crypto_work_avg_us" ] = cryptoWorkUs / cryptoJobs;
+	};
+	jsonDoc[ "crypto_inline" ] = cryptoInline;
+	publish_report(jsonDoc, buff);
+}
+
+void ACNode::loop_rate() {
+	static unsigned long last = 0, lastCntr = 0;
+	float rate =  1000. * (loopCntr - lastCntr)/(millis() - last) + 0.05;
+	loopRate = rate;
+	if (rate > 10)
+		Debug.printf("Loop rate: %.1f #/second\n", rate);
+	else
+		Log.printf("Warning: LOW Loop rate: %.1f #/second\n", rate);
+	last = millis();
+	lastCntr = loopCntr;
+}
+
+void ACNode::link_changed(bool up) {
+    Debug.printf("Network link %s.\n", up ? "up" : "down");
+
+    Log.link_changed(up);
+    Debug.link_changed(up);
+    for (ACBase ** it = _handlers; it < _handlers + _nHandlers; ++it)
+        (*it)->link_changed(up);
+
+    if (up) {
+        if (_connect_callback)
+            _connect_callback();
+    } else {
+        if (_disconnect_callback)
+            _disconnect_callback();
+    };
+}
+
+void ACNode::loop() {
+    loopCntr++;
+
+#if 0
+    if (_debug) {
+    	static unsigned long last = millis();
+	static unsigned long sw1, sw2, tock;
+	sw1  += digitalRead(SW1_BUTTON);
+	sw2  += digitalRead(SW1_BUTTON);
+	tock ++;
+	if (millis() - last > 1000) {
+	      Debug.printf("SW1: %d %d SW2: %d %d Relay %d Triac %d\n",
+	                digitalRead(SW1_BUTTON),
+	                abs(tock - sw1),
+	                digitalRead(SW2_BUTTON),
+	                abs(tock - sw2),
+      	 	        digitalRead(RELAY_GPIO),
+      	 	        digitalRead(TRIAC_GPIO)
+      	      );
+    	      last = millis(); sw1 = sw2 = tock = 0;
+   	 }
     }
-    // XX to hook into a callback of the ethernet/wifi
-    // once we figure out how we can get this from the wifi.
+#endif
+
+    // WiFiEvent() bumps the generation on every link change; fan those
+    // out here, in loop() context, to the handlers and the callbacks.
     //
     static bool lastconnectedstate = false;
-    bool connectedstate = isConnected();
-    if (lastconnectedstate != connectedstate) {
-        if (connectedstate) {
-            _connect_callback();
-	    } else {
-            _disconnect_callback();
-	    };
-        lastconnectedstate = connectedstate;
+#ifdef ESP32
+    static unsigned int lastgeneration = 0;
+    unsigned int generation = link_generation.load(std::memory_order_relaxed);
+    if (lastgeneration != generation) {
+        lastgeneration = generation;
+        bool up = isConnected();
+        // Bounced in between two loops; let the handlers see both edges.
+        if (up == lastconnectedstate)
+            link_changed(!up);
+        link_changed(up);
+        lastconnectedstate = up;
+    };
+#else
+    if (lastconnectedstate != isConnected()) {
+        lastconnectedstate = !lastconnectedstate;
+        link_changed(lastconnectedstate);
     };
+#endif
   
-    Log.loop();
-    Debug.loop();
+    _scheduler.loop();
+
+    { ProfileScope p(profLog); Log.loop(); Debug.loop(); }
 
-    cacheToSPIFFSLoop(beatCounter);
+    { ProfileScope p(profCache); cacheToSPIFFSLoop(beatCounter); }
+    { ProfileScope p(profOutbox); outboxLoop(); }
+    { ProfileScope p(profApprovals); approvalLoop(); }
  
  /* for test
     static bool firstTime = true;
@@ -481,22 +870,34 @@ void ACNode::loop() {
     }
 */
     
-    if(isConnected())
+    // Signatures made or checked by the worker; on to publish/process.
+    cryptoLoop();
+
+    if(isConnected()) {
+        ProfileScope p(profMqtt);
         mqttLoop();
+    };
     
     // Note that this will also run the security and other handlers; see
     // addSecurityHandler().
     //
-    std::list<ACBase *>::iterator it;
- 
-       for (it =_handlers.begin(); it!=_handlers.end(); ++it) {
+       for (ACBase ** it = _handlers; it < _handlers + _nHandlers; ++it) {
+        ProfileScope p(_handler_prof[it - _handlers]);
         (*it)->loop();
     }
+
+    // Give the CPU back (idle task, light sleep) until the next deadline;
+    // for nodes without handlers that need to poll continuously.
+    if (_idle_sleep) {
+        unsigned long d = _scheduler.next_due();
+        if (d)
+            delay(d < _idle_sleep ? d : _idle_sleep);
+    };
 }
 
 ACBase::cmd_result_t ACNode::handle_cmd(ACRequest * req)
 {
-    if (!strncmp("ping", req->cmd, 4)) {
+    if (!strncmp("ping", req->cmd(), 4)) {
         char buff[MAX_TOKEN_LEN*2];
         IPAddress myIp = localIP();
         
@@ -505,16 +906,39 @@ ACBase::cmd_result_t ACNode::handle_cmd(ACRequest * req)
 	Debug.println("replied on the pick with an ack.");
         return ACNode::CMD_CLAIMED;
     }
-    bool app = ((strcasecmp("approved",req->cmd)==0) || (strcasecmp("open",req->cmd)==0));
-    bool den = (strcasecmp("denied", req->cmd) == 0);
+    if (!strcasecmp("profile", req->cmd())) {
+        // 'profile reset' starts a new measurement; otherwise dump the table.
+        if (!strcasecmp("reset", req->rest()))
+            profileReset();
+        else
+            profileLog(Log);
+        return ACNode::CMD_CLAIMED;
+    }
+    // A plain 'report' is for the sketch (see protocol.txt); we only
+    // take the ones with an argument of ours.
+    if (!strcasecmp("report", req->cmd())) {
+        if (!strcasecmp("crypto", req->rest())) {
+            send_crypto_report();
+            return ACNode::CMD_CLAIMED;
+        };
+        if (!strcasecmp("resync", req->rest())) {
+            // Full snapshot on the next loop; for a master that lost track of the deltas.
+            report_resync();
+            return ACNode::CMD_CLAIMED;
+        };
+        if (!strcasecmp("delta", req->rest()) || !strcasecmp("full", req->rest())) {
+            set_report_delta(!strcasecmp("delta", req->rest()));
+            return ACNode::CMD_CLAIMED;
+        };
+        return ACNode::CMD_DECLINE;
+    }
+    bool app = ((strcasecmp("approved",req->cmd())==0) || (strcasecmp("open",req->cmd())==0));
+    bool den = (strcasecmp("denied", req->cmd()) == 0);
     // if (den) { den = false; app = true; };
 
-    if (app) _approve++;
-    if (den) _deny++;
-
     if (app || den) {
       char tmp[MAX_MSG], *p = tmp;
-      strncpy(tmp, req->rest, sizeof(tmp));
+      strncpy(tmp, req->rest(), sizeof(tmp));
 
       SEP(action, "No action in approval command", ACNode::CMD_CLAIMED)
       SEP(machine, "No machine-name in approval command", ACNode::CMD_CLAIMED);
@@ -526,36 +950,83 @@ ACBase::cmd_result_t ACNode::handle_cmd(ACRequest * req)
           return ACNode::CMD_CLAIMED;
       };
 
-      if (bc != _lastSwipe) {
-          if ((device1 != NULL) && (device2 != NULL)) {
-              if ((bc - _lastSwipe) > 1) {
-                  Log.printf("Out of order energize/denied command received - ignored.\n");
-                  return ACNode::CMD_CLAIMED;
-              }
-          } else {
-              Log.printf("Out of order energize/denied command received - ignored.\n");
-              return ACNode::CMD_CLAIMED;
-          }
+      bool inorder = (bc == _lastSwipe) || 
+          (*device1 && *device2 && (bc - _lastSwipe) <= 1);
+
+      // A reply lists the devices it applies to; all those of the request
+      // or a subset (one reply per outcome). Each device is acked on its
+      // own; and only the first reply for it gets through. Retransmits went
+      // out with a later beat; so accept anything from the first to the last
+      // one we sent (plus one; as with two devices).
+      char * devs[8];
+      int ndevs = 0, ndups = 0;
+      for (char * dev = machine, * nxt; dev && *dev && ndevs < 8; dev = nxt) {
+         if ((nxt = strchr(dev, ',')) != NULL)
+             *nxt++ = 0;
+
+         uint8_t bit = 0;
+         approval_t * a = find_approval_device(dev, &bit);
+         if (a) {
+             if (!(a->pending & bit)) {
+                 ndups++;
+                 continue;
+             };
+             if (bc < a->first || bc > a->last + 1) {
+                 Log.printf("Out of order energize/denied command for %s received - ignored.\n", dev);
+                 continue;
+             };
+             a->pending &= ~bit;
+         } else
+         if (!inorder) {
+             Log.printf("Out of order energize/denied command for %s received - ignored.\n", dev);
+             continue;
+         };
+         devs[ndevs++] = dev;
+      };
+      if (ndevs == 0) {
+         if (ndups) {
+             Debug.printf("Duplicate energize/denied command received - ignored.\n");
+             _dups++;
+         };
+         return ACNode::CMD_CLAIMED;
       };
 
+      // Only replies that answered something count; not their duplicates.
+      if (app) _approve++;
+      if (den) _deny++;
+
       setCache(_lasttag, app, (unsigned long) beatCounter);
 
-            if (app) {
-         Log.printf("Received OK to power on %s\n", machine);
-         if (_approved_callback) {
-		_approved_callback(machine);
-        	return ACNode::CMD_CLAIMED;
-         };
-     } else {
-         Log.printf("Received a DENIED to power on %s\n", machine);
-         if (_denied_callback) {
-		_denied_callback(machine);
-        	return ACNode::CMD_CLAIMED;
+      // Each device newly answered gets its own callback.
+      bool claimed = false;
+      for (int i = 0; i < ndevs; i++) {
+         const char * dev = devs[i];
+         if (app) {
+             Log.printf("Received OK to power on %s\n", dev);
+             if (_approved_callback) {
+		_approved_callback(dev);
+		claimed = true;
+             };
+         } else {
+             Log.printf("Received a DENIED to power on %s\n", dev);
+
+             char event[MAX_OUTBOX_EVENT];
+             size_t n = snprintf(event, sizeof(event), "event denied %s %lu ", 
+                 dev, (unsigned long) beatCounter);
+             if (n < sizeof(event) - 1)
+                 tag_mac(_lasttag, event + n, sizeof(event) - n);
+             audit(event);
+             if (_denied_callback) {
+		_denied_callback(dev);
+		claimed = true;
+             };
          };
-     }
+      };
+      if (claimed)
+          return ACNode::CMD_CLAIMED;
     }
 #if 0
-    if (!strcmp("outoforder", req->cmd)) {
+    if (!strcmp("outoforder", req->cmd())) {
         machinestate = OUTOFORDER;
         send(NULL, "event outoforder");
         return ACNode::CMD_CLAIMED;
@@ -567,22 +1038,79 @@ ACBase::cmd_result_t ACNode::handle_cmd(ACRequest * req)
 void ACNode::process(const char * topic, const char * payload)
 {
     size_t length = strlen(payload);
-    char * p;
    
     Debug.print("["); Debug.print(topic); Debug.print("] <<: ");
     Debug.print((char *)payload);
     Debug.println();
     
-    if (length < 6 + 2 * HASH_LENGTH + 1 + 12 + 1) {
+    // Shortest is SIG/3; version, base64 HMAC, beat and a verb.
+    if (length < 8 + B64L(HASH_LENGTH) + 4) {
         Log.println("Too short - ignoring.");
         return;
     };
     
     ACRequest * req = new ACRequest(topic, payload);
-    
+    req->topicId = lookup_topic(topic);
+
+    // Held until mqttLoop() has drained what came in back to back. Full
+    // while the previous batch is still with the crypto worker is rare;
+    // then wait for it.
+    if (_nInbound >= VERIFY_BATCH_MAX) {
+        process_inbound();
+        if (_nInbound >= VERIFY_BATCH_MAX) {
+            cryptoDrain();
+            process_inbound();
+        };
+    };
+    _inbound[_nInbound++] = req;
+}
+
+bool ACNode::verifying()
+{
+    for (ACSecurityHandler ** it = _security_handlers; it < _security_handlers + _nSecurityHandlers; ++it)
+        if ((*it)->verifying())
+            return true;
+    return false;
+}
+
+void ACNode::process_inbound()
+{
+    // Handled in order; so nothing new until the batch before is done.
+    if (_nVerifying) {
+        if (verifying())
+            return;
+        for (unsigned int i = 0; i < _nVerifying; i++)
+            process(_verifying[i]);
+        _nVerifying = 0;
+    };
+    if (_nInbound == 0)
+        return;
+
+    memcpy(_verifying, _inbound, _nInbound * sizeof(_verifying[0]));
+    _nVerifying = _nInbound;
+    _nInbound = 0;
+
+    for (ACSecurityHandler ** it = _security_handlers; it < _security_handlers + _nSecurityHandlers; ++it)
+        (*it)->verify_batch(_verifying, _nVerifying);
+
+    // Done inline (no worker, or nothing worth handing over); or else
+    // picked up on a later loop.
+    if (verifying())
+        return;
+    for (unsigned int i = 0; i < _nVerifying; i++)
+        process(_verifying[i]);
+    _nVerifying = 0;
+}
+
+void ACNode::process(ACRequest * req)
+{
+    const char * p;
+    const char * payload = req->payload();
+    ACBase * h = NULL;
+
     ACSecurityHandler::acauth_results r = ACSecurityHandler::FAIL;
-    for (std::list<ACSecurityHandler *>::iterator it =_security_handlers.begin();
-         it!=_security_handlers.end() && r != ACSecurityHandler::OK;
+    for (ACSecurityHandler ** it = _security_handlers;
+         it < _security_handlers + _nSecurityHandlers && r != ACSecurityHandler::OK;
          ++it)
     {
         r = (*it)->verify(req);
@@ -604,7 +1132,7 @@ void ACNode::process(const char * topic, const char * payload)
                 break;
         };
     	Trace.printf("Post %s verify\n\tV=%s\n\tB=%s\n\tC=<%s>\n\tP=<%s>\n\tR=<%s>\n\t=<%s>\n",  
-		(*it)->name(), req->version, req->beat, req->cmd, req->payload, req->rest, payload);
+		(*it)->name(), req->version(), req->beat(), req->cmd(), req->payload(), req->rest(), payload);
     }
     if (r != ACSecurityHandler::OK) {
 #if defined (HAS_SIG2)
@@ -615,42 +1143,44 @@ void ACNode::process(const char * topic, const char * payload)
 
     // We have a validatd command; so make rest purely the arguments.
     // not sure if we should do this here - or within each handler.
-    p = index(req->rest,' ');
+    p = index(req->rest(),' ');
     if (p) {
 	while(*p == ' ') p++;
-	strncpy(req->rest, p, sizeof(req->rest));
+	req->set_rest(p);
     };
 
     Trace.printf("Post verify\n\tV=%s\n\tB=%s\n\tC=<%s>\n\tP=<%s>\n\tR=<%s>\n\t=<%s>\n", 
-	req->version, req->beat, req->cmd, req->payload, req->rest, payload);
+	req->version(), req->beat(), req->cmd(), req->payload(), req->rest(), payload);
 
-    Trace.printf("Submitting command <%s> for handing\n", req->cmd);
+    Trace.printf("Submitting command <%s> for handing\n", req->cmd());
  
-    for (std::list<ACSecurityHandler *>::iterator  it =_security_handlers.begin();
-         it!=_security_handlers.end();
-         ++it)
-    {
-        cmd_result_t r = (*it)->handle_cmd(req);
-        if (r == CMD_CLAIMED) {
-	    Trace.printf("handled by sec handler %s\n", (*it)->name());
-            goto _done;
-	};
+    // Same order as before the verb table: security handlers, the
+    // callback, the plain handlers and ACNode itself last. The table
+    // only saves the looking; it does not change who goes first.
+    //
+    h = find_command(req->cmd());
+    if (h && is_security_handler(h) && h->handle_cmd(req) == CMD_CLAIMED) {
+        Trace.printf("handled by %s\n", h->name());
+        goto _done;
     };
     
     Trace.printf("Callback: \tV=%s\n\tB=%s\n\tC=<%s>\n\tP=<%s>\n\tR=<%s>\n\tP=<%s>\n\n", 
-	req->version, req->beat, req->cmd, req->payload, req->rest, payload);
+	req->version(), req->beat(), req->cmd(), req->payload(), req->rest(), payload);
 
     if (_command_callback) {
-       cmd_result_t t = _command_callback(req->cmd, req->rest);
+       cmd_result_t t = _command_callback(req->cmd(), req->rest());
        if (t == CMD_CLAIMED) {
 	    Trace.printf("handled by callback\n");
             goto _done;
        }
     };
 
-    for (std::list<ACBase *>::iterator it = _handlers.begin();
-         it != _handlers.end();
-         ++it)
+    if (h && h != this && !is_security_handler(h) && h->handle_cmd(req) == CMD_CLAIMED) {
+        Trace.printf("handled by %s\n", h->name());
+        goto _done;
+    };
+
+    for (ACBase ** it = _catchall; it < _catchall + _nCatchall; ++it) 
     {
         cmd_result_t r = (*it)->handle_cmd(req);
         if (r == CMD_CLAIMED) {
@@ -658,35 +1188,37 @@ void ACNode::process(const char * topic, const char * payload)
             goto _done;
 	};
     }
-    
-    if (handle_cmd(req) == CMD_CLAIMED)
+
+    if (h == this && handle_cmd(req) == CMD_CLAIMED)
         goto _done;
  
-    Log.printf("Command %s ignored.\n", req->cmd); 
+    Log.printf("Command %s ignored.\n", req->cmd()); 
 _done:
     delete req;
     return;
 }
 
+// Counts down once a second; then reboots. Safe to call repeatedly.
+//
 void ACNode::delayedReboot() {
-   static int warn_counter = 0;
-   static unsigned long last = 0;
-
-   if (millis() - last < 1000) 
+   static int reboot_task = -1;
+   if (reboot_task != -1)
        return;
 
-   if (warn_counter > 5) {
-        Serial.println("Forced reboot NOW");
-        ESP.restart();
-   };
-
-   char buff[255];
-   snprintf(buff,sizeof(buff),"Countdown to forced reboot: %d", 5 - warn_counter);
+   reboot_task = _scheduler.every("reboot", 1000, []() {
+       static int warn_counter = 0;
+       if (warn_counter > 5) {
+            Serial.println("Forced reboot NOW");
+            ESP.restart();
+       };
 
-   Log.println(buff);
+       char buff[255];
+       snprintf(buff,sizeof(buff),"Countdown to forced reboot: %d", 5 - warn_counter);
 
-   last = millis();
-   warn_counter ++;
+       Log.println(buff);
+       warn_counter ++;
+   });
+   _scheduler.reschedule(reboot_task, 0);
 }
 
  #ifdef HAS_SIG2
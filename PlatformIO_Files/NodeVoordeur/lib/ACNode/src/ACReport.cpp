@@ -0,0 +1,271 @@
+#include <stdarg.h>
+#include <ACReport.h>
+#include <MakerSpaceMQTT.h>
+
+#ifndef ACREPORT_LEGACY_DOC
+#define ACREPORT_LEGACY_DOC (JSON_OBJECT_SIZE(8) + 128)
+#endif
+
+ACReport::ACReport(char * buff, size_t len, encoding_t encoding) :
+    _buff(buff), _len(len), _at(0), _encoding(encoding), _count(0), _truncated(false),
+    _history(NULL), _full(true), _value(0)
+{
+    if (_encoding == MSGPACK)
+        // map16; the count is filled in by finish().
+        _put(0xde, 0, 2);
+    else
+        _printf("{");
+}
+
+// We always keep room for the closing brace and the terminating \0.
+//
+void ACReport::_printf(const char * fmt, ...) {
+    if (_at >= _len)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(_buff + _at, _len - _at, fmt, ap);
+    va_end(ap);
+    _at = (n < 0) ? _len : _min(_at + n, _len);
+}
+
+// MessagePack type byte; followed by a big endian value.
+//
+void ACReport::_put(uint8_t type, uint64_t value, size_t bytes) {
+    if (_at + 1 + bytes > _len) {
+        _at = _len;
+        return;
+    };
+    _buff[_at++] = type;
+    while (bytes--)
+        _buff[_at++] = (value >> (8 * bytes)) & 0xFF;
+}
+
+// Smallest MessagePack int that will hold the value.
+//
+void ACReport::_int(long long value) {
+    if (value >= 0) {
+        if (value < 128) _put(value, 0, 0);
+        else if (value <= 0xFF) _put(0xcc, value, 1);
+        else if (value <= 0xFFFF) _put(0xcd, value, 2);
+        else if (value <= 0xFFFFFFFFLL) _put(0xce, value, 4);
+        else _put(0xcf, value, 8);
+        return;
+    };
+    if (value >= -32) _put(0xe0 | (value & 0x1F), 0, 0);
+    else if (value >= -128) _put(0xd0, value & 0xFF, 1);
+    else if (value >= -32768) _put(0xd1, value & 0xFFFF, 2);
+    else if (value >= -2147483648LL) _put(0xd2, value & 0xFFFFFFFF, 4);
+    else _put(0xd3, value, 8);
+}
+
+void ACReport::_string(const char * str) {
+    if (_encoding == MSGPACK) {
+        if (str == NULL) {
+            _put(0xc0, 0, 0);
+            return;
+        };
+        size_t l = strlen(str);
+        if (l < 32) _put(0xa0 | l, 0, 0);
+        else if (l <= 0xFF) _put(0xd9, l, 1);
+        else _put(0xda, l, 2);
+        if (_at + l > _len) {
+            _at = _len;
+            return;
+        };
+        memcpy(_buff + _at, str, l);
+        _at += l;
+        return;
+    };
+
+    _printf("\"");
+    for(; str && *str && _at < _len; str++) {
+        if (_at + 2 >= _len) {
+            _at = _len;
+            break;
+        };
+        if (*str == '"' || *str == '\\') {
+            _buff[_at++] = '\\';
+            _buff[_at++] = *str;
+        }
+        else if ((unsigned char) *str < 32)
+            _printf("\\u%04x", (unsigned char) *str);
+        else
+            _buff[_at++] = *str;
+    };
+    _printf("\"");
+}
+
+bool ACReport::_begin(const char * key) {
+    if (_at > 1 && _encoding == JSON)
+        _printf(",");
+    _string(key);
+    if (_encoding == JSON)
+        _printf(":");
+    _value = _at;
+    return true;
+}
+
+// FNV-1a; over the key and the value as they were serialised.
+//
+static uint32_t _fnv(const char * p, size_t len) {
+    uint32_t h = 2166136261u;
+    while (len--) {
+        h ^= (unsigned char) *p++;
+        h *= 16777619u;
+    };
+    return h;
+}
+
+bool ACReport::History::seen(uint32_t key, uint32_t value) {
+    for (unsigned int i = 0; i < _n; i++) {
+        if (_fields[i].key != key)
+            continue;
+        if (_fields[i].value == value)
+            return true;
+        _fields[i].value = value;
+        return false;
+    };
+    // Once full; untracked fields simply get sent every time.
+    if (_n < MAX_REPORT_FIELDS) {
+        _fields[_n].key = key;
+        _fields[_n].value = value;
+        _n++;
+    };
+    return false;
+}
+
+bool ACReport::_unchanged(size_t mark) {
+    if (_history == NULL)
+        return false;
+
+    // Key is between the optional comma and the value.
+    size_t k = (_encoding == JSON && _buff[mark] == ',') ? mark + 1 : mark;
+    bool seen = _history->seen(_fnv(_buff + k, _value - k), _fnv(_buff + _value, _at - _value));
+    return seen && !_full;
+}
+
+bool ACReport::_end(size_t mark) {
+    if (_at + 2 <= _len) {
+        if (!_unchanged(mark)) {
+            _count++;
+            return true;
+        };
+        _at = mark;
+        _buff[_at] = 0;
+        return false;
+    };
+
+    // Did not fit; roll back to before this field.
+    _at = mark;
+    _buff[_at] = 0;
+    _truncated = true;
+    return false;
+}
+
+void ACReport::add(const char * key, const char * value) {
+    size_t mark = _at;
+    _begin(key);
+    _string(value);
+    _end(mark);
+}
+
+void ACReport::add(const char * key, bool value) {
+    size_t mark = _at;
+    _begin(key);
+    if (_encoding == MSGPACK)
+        _put(value ? 0xc3 : 0xc2, 0, 0);
+    else
+        _printf("%s", value ? "true" : "false");
+    _end(mark);
+}
+
+void ACReport::add(const char * key, long value) {
+    size_t mark = _at;
+    _begin(key);
+    if (_encoding == MSGPACK)
+        _int(value);
+    else
+        _printf("%ld", value);
+    _end(mark);
+}
+
+void ACReport::add(const char * key, unsigned long value) {
+    size_t mark = _at;
+    _begin(key);
+    if (_encoding == MSGPACK)
+        _int(value);
+    else
+        _printf("%lu", value);
+    _end(mark);
+}
+
+void ACReport::add(const char * key, double value) {
+    size_t mark = _at;
+    _begin(key);
+    if (_encoding == MSGPACK) {
+        // float32 is plenty for temperatures and rates.
+        union { float f; uint32_t u; } v = { (float) value };
+        _put(0xca, v.u, 4);
+    }
+    else
+        _printf("%.2f", value);
+    _end(mark);
+}
+
+void ACReport::merge(std::function<void(JsonObject &)> fn) {
+    StaticJsonDocument<ACREPORT_LEGACY_DOC> doc;
+    JsonObject out = doc.to<JsonObject>();
+
+    fn(out);
+    size_t n = out.size();
+    if (n == 0)
+        return;
+
+    char tmp[MAX_MSG];
+    size_t l, skip;
+    if (_encoding == MSGPACK) {
+        // Splice in the members; without the fixmap/map16 header.
+        l = serializeMsgPack(doc, tmp, sizeof(tmp));
+        skip = (n < 16) ? 1 : 3;
+        if (l <= skip || l >= sizeof(tmp)) {
+            _truncated = true;
+            return;
+        };
+    } else {
+        l = serializeJson(doc, tmp, sizeof(tmp));
+        if (l < 2 || l >= sizeof(tmp) - 1 || tmp[0] != '{' || tmp[l-1] != '}') {
+            _truncated = true;
+            return;
+        };
+        // Splice in the members; without the braces.
+        l--;
+        skip = 1;
+    };
+
+    // Tracked as a single field; resent when any of it changed.
+    size_t mark = _at;
+    if (_at > 1 && _encoding == JSON)
+        _printf(",");
+    _value = _at;
+    if (_at + l - skip > _len)
+        _at = _len;
+    else {
+        memcpy(_buff + _at, tmp + skip, l - skip);
+        _at += l - skip;
+    };
+    if (_end(mark))
+        _count += n - 1;
+}
+
+const char * ACReport::finish() {
+    if (_encoding == MSGPACK) {
+        _buff[1] = (_count >> 8) & 0xFF;
+        _buff[2] = _count & 0xFF;
+        return _buff;
+    };
+    // There is always room for this one; see _end().
+    _buff[_at++] = '}';
+    _buff[_at] = 0;
+    return _buff;
+}
@@ -0,0 +1,94 @@
+#ifndef _H_ACREPORT
+#define _H_ACREPORT
+
+#include <functional>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Writes the periodic report as JSON straight into a caller supplied
+// buffer; one field at a time, as the handlers emit them. No document,
+// no String and no heap. A field that no longer fits is dropped whole;
+// so the result is always valid JSON.
+//
+//    report["rfid_scans"] = _scan;
+//
+// With a History attached (see track()) only fields whose value changed
+// since the last report are written; the rest is left out.
+//
+// Or; as MessagePack (a map16 of the same fields) for the binary
+// telemetry topic. See tools/telemetry-decode.py for the other end.
+//
+#ifndef MAX_REPORT_FIELDS
+#define MAX_REPORT_FIELDS (48)
+#endif
+
+class ACReport {
+public:
+    typedef enum { JSON, MSGPACK } encoding_t;
+    ACReport(char * buff, size_t len, encoding_t encoding = JSON);
+
+    // What was last sent; as a hash of key and value per field.
+    class History {
+    public:
+        History() { reset(); };
+        void reset() { _n = 0; };
+        bool empty() { return _n == 0; };
+        // Returns true if this value was already sent for this key.
+        bool seen(uint32_t key, uint32_t value);
+    private:
+        struct { uint32_t key, value; } _fields[MAX_REPORT_FIELDS];
+        unsigned int _n;
+    };
+    // From here on; skip what is unchanged (unless full) and
+    // record the rest in history.
+    void track(History * history, bool full) { _history = history; _full = full; };
+
+    class Field {
+    public:
+        Field(ACReport & report, const char * key) : _report(report), _key(key) {};
+        template<typename T> Field & operator=(T value) { _report.add(_key, value); return *this; };
+    private:
+        ACReport & _report;
+        const char * _key;
+    };
+    Field operator[](const char * key) { return Field(*this, key); };
+
+    void add(const char * key, const char * value);
+    void add(const char * key, const String & value) { add(key, value.c_str()); };
+    void add(const char * key, bool value);
+    void add(const char * key, int value) { add(key, (long) value); };
+    void add(const char * key, unsigned int value) { add(key, (unsigned long) value); };
+    void add(const char * key, long value);
+    void add(const char * key, unsigned long value);
+    void add(const char * key, double value);
+
+    // For handlers/callbacks still written against a JsonObject; their
+    // fields are collected in a small document on the stack and merged in.
+    void merge(std::function<void(JsonObject &)> fn);
+
+    // Closes the object/map. Only JSON is \0 terminated; so use
+    // length() for MSGPACK.
+    const char * finish();
+    size_t length() { return _at; };
+    unsigned int fields() { return _count; };
+    bool truncated() { return _truncated; };
+
+private:
+    char * _buff;
+    size_t _len, _at;
+    encoding_t _encoding;
+    unsigned int _count;
+    bool _truncated;
+    History * _history;
+    bool _full;
+    size_t _value;
+
+    bool _begin(const char * key);
+    bool _end(size_t mark);
+    bool _unchanged(size_t mark);
+    void _printf(const char * fmt, ...);
+    void _string(const char * str);
+    void _put(uint8_t type, uint64_t value, size_t bytes);
+    void _int(long long value);
+};
+#endif
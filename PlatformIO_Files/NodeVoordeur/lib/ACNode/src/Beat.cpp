@@ -14,12 +14,12 @@ beat_t beat_absdelta(beat_t a, beat_t b) {
 Beat::acauth_result_t Beat::verify(ACRequest * req)
 {
     //const char * topic, const char * line, const char ** payload);
-    char * p = index(req->rest,' ');
-    beat_t  b = strtoul(req->rest,NULL,10);
-    size_t bl = p - req->rest;
+    const char * p = index(req->rest(),' ');
+    beat_t  b = strtoul(req->rest(),NULL,10);
+    size_t bl = p - req->rest();
 
-    if (!p || strlen(req->rest) < 10 || b == 0 || b == ULONG_MAX || bl > 12 || bl < 2) {
-        Log.printf("Malformed beat <%s> - ignoring.\n", req->rest);
+    if (!p || strlen(req->rest()) < 10 || b == 0 || b == ULONG_MAX || bl > 12 || bl < 2) {
+        Log.printf("Malformed beat <%s> - ignoring.\n", req->rest());
         return DECLINE;
     };
     
@@ -39,33 +39,29 @@ Beat::acauth_result_t Beat::verify(ACRequest * req)
 
     // Strip off, and accept the beat.
     //
-    size_t l = bl;
-    if (bl >= sizeof(req->beat))
-	bl = sizeof(req->beat) -1;
-
-    p = req->rest + bl;
     while(*p == ' ') p++;
 
-    strncpy(req->beat,req->rest, l);
-    strncpy(req->rest, p, sizeof(req->rest));
+    if (!req->set_beat(req->rest(), bl) || !req->set_rest(p))
+        return FAIL;
     req->beatExtracted = b;
     
     return OK;
 };
 
 Beat::cmd_result_t Beat::handle_cmd(ACRequest * req) {
-    if (!strcmp(req->cmd,"beat"))
+    if (!strcmp(req->cmd(),"beat"))
         return CMD_CLAIMED;
 
     return CMD_DECLINE;
 }
 
 Beat::acauth_result_t Beat::secure(ACRequest * req) {
-    char tmp[sizeof(req->payload)];
+    char prefix[MAX_BEAT];
     beat_t bc = beatCounter;
 
-    snprintf(tmp, sizeof(tmp), BEATFORMAT " %s", bc, req->payload);
-    strncpy(req->payload, tmp, sizeof(req->payload));
+    snprintf(prefix, sizeof(prefix), BEATFORMAT " ", bc);
+    if (!req->prepend_payload(prefix))
+        return FAIL;
     
     return PASS;
 };
@@ -75,6 +71,11 @@ void Beat::begin() {
     // at some point in the future
     //
     beatCounter = 0;
+
+    _acnode->every("alive", 3000, [this]() {
+        if (_debug_alive && _acnode->isConnected())
+            send(NULL, "ping");
+    });
 }
 
 void Beat::loop() {
@@ -95,12 +96,6 @@ void Beat::loop() {
         };
     }
 
-    if (_debug_alive) {
-        if (millis() - last_beat > 3000 && _acnode->isConnected()) {
-            send(NULL, "ping");
-            last_beat = millis();
-        }
-    }
     return;
 }
 
@@ -14,12 +14,16 @@ public:
     void            loop();
     
     cmd_result_t    handle_cmd(ACRequest * req);
+    const char * const * commands() { 
+        static const char * const cmds[] = { "beat", NULL };
+        return cmds;
+    };
 
     acauth_result_t verify(ACRequest * req);
     acauth_result_t secure(ACRequest * req);
 
 private:
-    unsigned long last_loop = 0, last_beat = 0;
+    unsigned long last_loop = 0;
 };
 
 #endif
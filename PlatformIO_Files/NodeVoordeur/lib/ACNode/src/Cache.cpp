@@ -97,7 +97,7 @@ void prepareCache(bool wipe) {
     File dir = SPIFFS.open(dirName);
     File file = dir.openNextFile();
     while(file) {
-      String path = file.name();
+      String path = file.path(); // name() is just the last component on core 2.x
       file.close();
       SPIFFS.remove(path);
 #ifdef DEBUG_CACHE        
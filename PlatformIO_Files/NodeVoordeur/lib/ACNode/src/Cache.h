@@ -3,6 +3,8 @@
 
 extern unsigned long cacheMiss, cacheHit;
 
+unsigned long hash(const char * tag);
+
 void prepareCache(bool wipe);
 void setCache(const char * tag, bool ok, unsigned long beatCounter);
 bool checkCache(const char * tag);
@@ -0,0 +1,96 @@
+#include <CryptoWorker.h>
+#include <Arduino.h>
+
+unsigned long cryptoJobs = 0, cryptoInline = 0;
+unsigned long cryptoWaitUs = 0, cryptoWaitMaxUs = 0, cryptoWorkUs = 0;
+
+#if defined(ESP32) && CRYPTO_WORKER_QUEUE > 0
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "ACNode-private.h"
+
+// Jobs are passed by pointer; the submitter owns them throughout.
+static QueueHandle_t todo = NULL, done = NULL;
+static int inFlight = 0;
+
+static void cryptoTask(void * arg) {
+  crypto_job_t * job;
+  for (;;) {
+    if (xQueueReceive(todo, &job, portMAX_DELAY) != pdTRUE)
+      continue;
+    job->started = micros();
+    job->ok = job->work(job);
+    job->finished = micros();
+    xQueueSend(done, &job, portMAX_DELAY);
+  };
+}
+
+void prepareCryptoWorker() {
+  if (todo)
+    return;
+
+  todo = xQueueCreate(CRYPTO_WORKER_QUEUE, sizeof(crypto_job_t *));
+  done = xQueueCreate(CRYPTO_WORKER_QUEUE, sizeof(crypto_job_t *));
+  if (!todo || !done ||
+    xTaskCreatePinnedToCore(cryptoTask, "crypto", CRYPTO_WORKER_STACK, NULL, CRYPTO_WORKER_PRIORITY, NULL, CRYPTO_WORKER_CORE) != pdPASS) {
+    Log.println("Could not start the crypto worker; signing inline.");
+    todo = NULL;
+    return;
+  };
+  Debug.printf("Crypto worker running on core %d.\n", CRYPTO_WORKER_CORE);
+}
+
+bool cryptoSubmit(crypto_job_t * job) {
+  if (!todo || inFlight >= CRYPTO_WORKER_QUEUE) {
+    cryptoInline++;
+    return false;
+  };
+  job->queued = micros();
+  if (xQueueSend(todo, &job, 0) != pdTRUE) {
+    cryptoInline++;
+    return false;
+  };
+  inFlight++;
+  return true;
+}
+
+int cryptoInFlight() {
+  return inFlight;
+}
+
+static void complete(crypto_job_t * job) {
+  unsigned long now = micros();
+  unsigned long wait = (job->started - job->queued) + (now - job->finished);
+
+  inFlight--;
+  cryptoJobs++;
+  cryptoWorkUs += job->finished - job->started;
+  cryptoWaitUs += wait;
+  if (wait > cryptoWaitMaxUs)
+    cryptoWaitMaxUs = wait;
+
+  job->done(job);
+}
+
+void cryptoLoop() {
+  crypto_job_t * job;
+  while (inFlight && xQueueReceive(done, &job, 0) == pdTRUE)
+    complete(job);
+}
+
+void cryptoDrain() {
+  crypto_job_t * job;
+  while (inFlight && xQueueReceive(done, &job, portMAX_DELAY) == pdTRUE)
+    complete(job);
+}
+
+#else
+void prepareCryptoWorker() { return; }
+bool cryptoSubmit(crypto_job_t * job) { cryptoInline++; return false; }
+int cryptoInFlight() { return 0; }
+void cryptoLoop() { return; }
+void cryptoDrain() { return; }
+#endif
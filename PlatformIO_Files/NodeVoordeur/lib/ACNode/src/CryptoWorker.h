@@ -0,0 +1,53 @@
+#ifndef _CRYPTOWORKER_H
+#define _CRYPTOWORKER_H
+
+// Ed25519 off the main loop; a task on the other core does the signing
+// and verifying, so RFID polling, logging and the MQTT keepalive carry
+// on meanwhile. The submitter fills in a job, hands it over and gets its
+// done() callback from cryptoLoop(); i.e. back on the main loop.
+//
+// Without the worker (not an ESP32, or CRYPTO_WORKER_QUEUE 0) nothing
+// is accepted; and callers do the work inline as before.
+//
+#ifndef CRYPTO_WORKER_QUEUE
+#define CRYPTO_WORKER_QUEUE (8) // Jobs in flight; beyond that the caller does it inline.
+#endif
+
+#ifndef CRYPTO_WORKER_CORE
+#define CRYPTO_WORKER_CORE (0) // PRO_CPU; the Arduino loop() runs on core 1.
+#endif
+
+#ifndef CRYPTO_WORKER_STACK
+#define CRYPTO_WORKER_STACK (8 * 1024)
+#endif
+
+#ifndef CRYPTO_WORKER_PRIORITY
+#define CRYPTO_WORKER_PRIORITY (1) // As loop(); below the network tasks.
+#endif
+
+typedef struct crypto_job {
+    // Runs on the worker; must only touch what is in (or owned by) the job.
+    bool (*work)(struct crypto_job * job);
+    // Runs from cryptoLoop(); with ok as returned by work().
+    void (*done)(struct crypto_job * job);
+    bool ok;
+    // micros(); handed over, picked up by the worker, finished.
+    unsigned long queued, started, finished;
+} crypto_job_t;
+
+// Jobs, how many were done inline as the worker was absent or full, and
+// the time spent waiting for the worker (and for the main loop to pick up
+// the result) versus working; in uSeconds.
+//
+extern unsigned long cryptoJobs, cryptoInline;
+extern unsigned long cryptoWaitUs, cryptoWaitMaxUs, cryptoWorkUs;
+
+void prepareCryptoWorker();
+bool cryptoSubmit(crypto_job_t * job);
+int cryptoInFlight();
+void cryptoLoop();
+// Blocks until everything in flight is done; for when the caller cannot
+// go on without the results.
+void cryptoDrain();
+
+#endif
@@ -132,7 +132,7 @@
       });
     };
 
-    void MachineState::report(JsonObject& report) {
+    void MachineState::report(ACReport& report) {
       report["state"] = label();
     }
 
@@ -76,6 +76,7 @@ class MachineState : public ACBase {
     // ACBase - standard handlers.
     //
     void begin();
-    void report(JsonObject& report);
+    void report(ACReport& report);
+    const char * const * commands() { return no_commands(); };
     void loop();
 };
@@ -10,10 +10,12 @@
 // late - as this also seeems to occasionally hit some (stackdepth?) limit.
 //
 typedef struct publish_rec {
-    char * topic;
+    char * topic;               // NULL when the topic is interned.
+    int topic_id;
     char * payload;
     struct publish_rec * nxt;
     bool raw;
+    ACRequest * req;            // Being secured by the crypto worker; else NULL.
 } publish_rec_t;
 
 publish_rec_t *publish_queue = NULL;
@@ -22,24 +24,30 @@ int items_in_publish_queue = 0;
 
 
 void ACNode::send(const char * topic, const char * payload, bool _raw) {
-    char _topic[MAX_TOPIC];
-
-    if (topic == NULL) {
-        snprintf(_topic, sizeof(_topic), "%s/%s/%s", mqtt_topic_prefix, master, ACNode::moi);
-        topic = _topic;
+    int topic_id = TOPIC_UNKNOWN;
+
+    // Interned topics are passed around by id; no need to copy them.
+    if (topic == NULL) 
+        topic_id = TOPIC_TO_MASTER;
+    else if (topic >= (const char *)_topics && topic < (const char *)(_topics + _nTopics)) {
+        int i = (topic - (const char *)_topics) / sizeof(interned_topic_t);
+        if (topic == _topics[i].topic)
+            topic_id = i;
     };
 
 //    Serial.printf("send('%s','%s',%d)\n", topic ? topic : "<null>", payload ? payload : "<null>" , _raw);
 
     publish_rec_t * rec = (publish_rec_t *)malloc(sizeof(publish_rec_t));
     if (rec) {
-        rec->topic = strdup(topic);
+        rec->topic = (topic_id == TOPIC_UNKNOWN) ? strdup(topic) : NULL;
+        rec->topic_id = topic_id;
         rec->payload = strdup(payload);
 	    rec->raw = _raw;
         rec->nxt = NULL;
+        rec->req = NULL;
     }
     
-    if (!rec || !(rec->topic) || !(rec->payload)) {
+    if (!rec || (rec->topic_id == TOPIC_UNKNOWN && !(rec->topic)) || !(rec->payload)) {
         Serial.println("Out of memory");
 #ifdef DEBUG
         // Throw a core dump for debugging/GDBSTUB_H purposes.
@@ -79,9 +87,15 @@ void ACNode::send(const char * topic, const char * payload, bool _raw) {
     if (items_in_publish_queue < MAX_ITEMS_IN_PUBLISH_QUEUE) {
         items_in_publish_queue++;
     } else {
-        // Queue is full, remove oldest item from queue
-        rec = publish_queue;
-        publish_queue = rec->nxt;
+        // Queue is full, remove oldest item from queue; unless the
+        // crypto worker is on that one, then the one after it.
+        p = &publish_queue;
+        if ((*p)->req)
+            p = &(*p)->nxt;
+        rec = *p;
+        *p = rec->nxt;
+        if (rec == last_item_in_publish_queue)
+            last_item_in_publish_queue = publish_queue;
         free(rec->topic);
         free(rec->payload);
         free(rec);
@@ -125,7 +139,7 @@ const char * ACNode::state2str(int state) {
 #endif
 }
 
-void ACNode::reconnectMQTT() {
+bool ACNode::reconnectMQTT() {
     Log.printf("Connecting <%s> to %s:%d (MQTT State : %s)\n",
 		ACNode::moi, mqtt_server, mqtt_port, 
 		state2str(_client.state()));
@@ -133,37 +147,37 @@ void ACNode::reconnectMQTT() {
     if (!_client.connect(ACNode::moi)) {
         Log.print("Reconnect failed : ");
         Log.println(state2str(_client.state()));
-	return;
+	return false;
     }
     
     Debug.println("(re)connected ");
     _mqtt_reconnects ++;
  
-    char topic[MAX_TOPIC];
-    snprintf(topic, sizeof(topic), "%s/%s/%s", mqtt_topic_prefix, ACNode::moi, master);
-    _client.subscribe(topic);
+    // QoS 1 - so the broker retries replies (approvals) to us. Our own
+    // publishes are QoS 0 (PubSubClient limit); see approvalLoop().
+    _client.subscribe(topic(TOPIC_FROM_MASTER), 1);
     Debug.print("Subscribed to ");
-    Debug.println(topic);
+    Debug.println(topic(TOPIC_FROM_MASTER));
    
-    snprintf(topic, sizeof(topic), "%s/%s/%s", mqtt_topic_prefix, master, master);
-    _client.subscribe(topic);
+    _client.subscribe(topic(TOPIC_MASTER_BCAST));
     Debug.print("Subscribed to ");
-    Debug.println(topic);
+    Debug.println(topic(TOPIC_MASTER_BCAST));
 
     send_helo();
+
+    // Subscribers of the delta reports start with a full snapshot.
+    report_resync();
+    return true;
 }
 
 void ACNode::send_helo(char * token) {
-    char topic[MAX_TOPIC];
-    snprintf(topic, sizeof(topic), "%s/%s/%s", mqtt_topic_prefix, ACNode::moi, master);
-
-    ACRequest * req = new ACRequest(topic, token ? token : "announce");
+    ACRequest * req = new ACRequest(topic(TOPIC_FROM_MASTER), token ? token : "announce");
 
     bool canBeSent = false;
 
     ACSecurityHandler::acauth_results r = ACSecurityHandler::FAIL;
-    for (std::list<ACSecurityHandler *>::iterator it =_security_handlers.begin();
-         it!=_security_handlers.end() && r != ACSecurityHandler::OK;
+    for (ACSecurityHandler ** it = _security_handlers;
+         it < _security_handlers + _nSecurityHandlers && r != ACSecurityHandler::OK;
          ++it)
     {
         r = (*it)->helo(req);
@@ -177,21 +191,99 @@ void ACNode::send_helo(char * token) {
             case ACSecurityHandler::FAIL:
             default:
                 Log.printf("Failing HELO on (%s) - failing.\n", (*it)->name());
+                delete req;
                 return;
                 break;
         }
     }
     // at least someone should have touched it.
     if (canBeSent) {
-	    Debug.printf("Send from reconnect: %s\n", req->payload);
-	    send(NULL, req->payload);
+	    Debug.printf("Send from reconnect: %s\n", req->payload());
+	    send(NULL, req->payload());
     } else {
 	    Debug.printf("No helo yet sent; not enough stack up.\n");
     }
+    delete req;
 }
 
 void mqtt_callback(char* topic, byte * payload_theirs, unsigned int length);
 
+// djb2, as used for the tag cache; but seeded with the length and over
+// just the tail. Our topics differ in their last part (the sender); a
+// collision only costs a memcmp().
+#define TOPIC_HASH_TAIL (8)
+static uint32_t topic_hash(const char * topic, uint16_t * len) {
+    size_t n = strlen(topic);
+    uint32_t hash = 5381 + n;
+    for(const char * p = topic + (n > TOPIC_HASH_TAIL ? n - TOPIC_HASH_TAIL : 0); *p; p++)
+        hash = ((hash << 5) + hash) + *p;
+    *len = n;
+    return hash;
+}
+
+void ACNode::update_topics() {
+    const char * fixed[TOPIC_FIRST_FREE][2] = {
+        { master, moi },                // TOPIC_TO_MASTER
+        { moi, master },                // TOPIC_FROM_MASTER
+        { master, master },             // TOPIC_MASTER_BCAST
+        { logpath, moi },               // TOPIC_LOG
+        { MQTT_TOPIC_TELEMETRY, moi },  // TOPIC_TELEMETRY
+    };
+    for(int i = 0; i < TOPIC_FIRST_FREE; i++) {
+        snprintf(_topics[i].topic, sizeof(_topics[i].topic), "%s/%s/%s", mqtt_topic_prefix, fixed[i][0], fixed[i][1]);
+        _topics[i].hash = topic_hash(_topics[i].topic, &_topics[i].len);
+    };
+    if (_nTopics < TOPIC_FIRST_FREE)
+        _nTopics = TOPIC_FIRST_FREE;
+
+    // The fixed ones keep their id; but their hash may have changed.
+    rehash_topics();
+}
+
+void ACNode::rehash_topics() {
+    bzero(_topic_bucket, sizeof(_topic_bucket));
+    for(int i = 0; i < _nTopics; i++) {
+        unsigned int b = _topics[i].hash % (2 * MAX_INTERNED_TOPICS);
+        while (_topic_bucket[b])
+            b = (b + 1) % (2 * MAX_INTERNED_TOPICS);
+        _topic_bucket[b] = i + 1;
+    };
+}
+
+int ACNode::lookup_topic(const char * topic) {
+    uint16_t len;
+    uint32_t hash = topic_hash(topic, &len);
+
+    for(unsigned int b = hash % (2 * MAX_INTERNED_TOPICS); _topic_bucket[b]; b = (b + 1) % (2 * MAX_INTERNED_TOPICS)) {
+        interned_topic_t * t = &_topics[ _topic_bucket[b] - 1 ];
+        if (t->hash == hash && t->len == len && !memcmp(t->topic, topic, len))
+            return _topic_bucket[b] - 1;
+    };
+    return TOPIC_UNKNOWN;
+}
+
+int ACNode::intern_topic(const char * topic) {
+    int i = lookup_topic(topic);
+    if (i != TOPIC_UNKNOWN)
+        return i;
+
+    if (_nTopics >= MAX_INTERNED_TOPICS || strlen(topic) >= MAX_TOPIC) {
+        Log.printf("Cannot intern topic %s - ignored.\n", topic);
+        return TOPIC_UNKNOWN;
+    };
+
+    i = _nTopics++;
+    strncpy(_topics[i].topic, topic, sizeof(_topics[i].topic));
+    _topics[i].hash = topic_hash(_topics[i].topic, &_topics[i].len);
+
+    unsigned int b = _topics[i].hash % (2 * MAX_INTERNED_TOPICS);
+    while (_topic_bucket[b])
+        b = (b + 1) % (2 * MAX_INTERNED_TOPICS);
+    _topic_bucket[b] = i + 1;
+
+    return i;
+}
+
 void ACNode::configureMQTT()  {
     if (ACNode::moi == NULL || *ACNode::moi == 0)
 	strncpy(moi,"no-mqtt-client-id-set",sizeof(moi));
@@ -199,6 +291,9 @@ void ACNode::configureMQTT()  {
     if (mqtt_port ==0)
 	mqtt_port = MQTT_DEFAULT_PORT;
 
+    // Configuration may have been loaded/changed behind our back (config portal).
+    update_topics();
+
     _client.setServer(mqtt_server, mqtt_port);
     _client.setCallback(mqtt_callback);
 }
@@ -243,17 +338,43 @@ bool ACNode::isUp() {
 }
 
 void ACNode::mqttLoop() {
-    static unsigned long last_mqtt_connect_try = 0;
-    _client.loop();
+    static unsigned long last_mqtt_connect_try = 0, backoff = MQTT_RECONNECT_MIN, wait = 0;
+    static bool wasUp = false;
+
+    // Keep reading while messages come in back to back (a reconnect, the
+    // master replaying state); so they can be verified in one go.
+    //
+    for (int i = 0; i < VERIFY_BATCH_MAX; i++) {
+        unsigned int before = _nInbound;
+        _client.loop();
+        if (_nInbound == before)
+            break;
+    };
+    process_inbound();
     
     if (!isUp()) {
+        // Jittered exponential backoff; so that after a broker outage not
+        // all nodes come knocking at the very same time. Which also goes
+        // for the very first try after we lost the connection.
+        //
+        if (wasUp) {
+            wasUp = false;
+            backoff = MQTT_RECONNECT_MIN;
+            wait = trng() % backoff;
+            last_mqtt_connect_try = millis();
+        };
         // report transient error ? Which ? And how often ?
-        if (millis() - last_mqtt_connect_try > 10000 || last_mqtt_connect_try == 0) {
-            reconnectMQTT();
+        if (millis() - last_mqtt_connect_try > wait || last_mqtt_connect_try == 0) {
             last_mqtt_connect_try = millis();
+            if (!reconnectMQTT()) {
+                wait = backoff / 2 + trng() % (backoff / 2 + 1);
+                backoff = _min(backoff * 2, (unsigned long) MQTT_RECONNECT_MAX);
+                Debug.printf("Next MQTT reconnect in %lu mSeconds.\n", wait);
+            };
         }
         return;
     };
+    wasUp = true;
     
     if (!publish_queue)
         return;
@@ -262,44 +383,64 @@ void ACNode::mqttLoop() {
     // here quickly.
     //
     publish_rec_t * rec = publish_queue;
+    ACRequest * reqOut = rec->req;
+    ACSecurityHandler ** it;
+    ACSecurityHandler::acauth_results r = ACSecurityHandler::FAIL;
 
 //    Serial.printf("Picking from queu: <%s>\n", rec->payload);
+
+    // Handed to the crypto worker on an earlier loop; see if it is done.
+    if (reqOut) {
+        if (reqOut->securing)
+            return;
+        if (reqOut->secureFailed) {
+            Log.printf("Adding signature to outbound failed. Aborting.\n\t%s\n\t%s\n", reqOut->topic(), reqOut->payload());
+            goto _done_without_send;
+        };
+        goto _send;
+    };
     
-    ACRequest * reqOut = new ACRequest();
+    reqOut = new ACRequest();
     if (!reqOut) {
 	Serial.println("Out of memory. Rebooting");
 	delay(1000);
 	ESP.restart();
     };
 
-    strncpy(reqOut->topic, rec->topic, sizeof(reqOut->topic));
-    strncpy(reqOut->payload, rec->payload, sizeof(reqOut->payload));
-    
     // We are runing in reverse order. As we need to
     // `wrap things' back up.
     //
-    std::list<ACSecurityHandler *>::reverse_iterator it;
-    ACSecurityHandler::acauth_results r = ACSecurityHandler::FAIL;
+    if (!reqOut->set_topic(rec->topic ? rec->topic : topic(rec->topic_id)) || !reqOut->set_payload(rec->payload)) {
+        Log.printf("Outbound message too long. Aborting.\n");
+        goto _done_without_send;
+    };
 
     if (rec->raw == false) {
-       for (it =_security_handlers.rbegin();
-        it!=_security_handlers.rend() && r != ACSecurityHandler::OK;
-        ++it) {
-// Debug.printf("PRE  %s: %s %s\n", (*it)->name(), reqOut->payload, reqOut->rest);
+       approval_stamped(rec->payload, beatCounter);
+       for (it = _security_handlers + _nSecurityHandlers - 1;
+        it >= _security_handlers && r != ACSecurityHandler::OK;
+        --it) {
+// Debug.printf("PRE  %s: %s %s\n", (*it)->name(), reqOut->payload(), reqOut->rest());
         r = (*it)->secure(reqOut);
         if (r == ACSecurityHandler::FAIL) {
             Log.printf("Adding signature to outbound failed (%s). Aborting.\n", (*it)->name());
-            Log.printf("\t%s\n\t%s\n", reqOut->topic, reqOut->payload);
+            Log.printf("\t%s\n\t%s\n", reqOut->topic(), reqOut->payload());
             goto _done_without_send;
         };
-// Debug.printf("POST %s: %s %s\n", (*it)->name(), reqOut->payload, reqOut->rest);
+        // Signed on the other core; we publish it once it is back.
+        if (r == ACSecurityHandler::PENDING) {
+            rec->req = reqOut;
+            return;
+        };
+// Debug.printf("POST %s: %s %s\n", (*it)->name(), reqOut->payload(), reqOut->rest());
       }
     }
 
+_send:
     if (!rec->raw) 
-    	Debug.printf("[%s]%s>>: %s\n", reqOut->topic, rec->raw ? "r" : " ", reqOut->payload);
+    	Debug.printf("[%s]%s>>: %s\n", reqOut->topic(), rec->raw ? "r" : " ", reqOut->payload());
 
-    _client.publish(reqOut->topic, reqOut->payload);
+    _client.publish(reqOut->topic(), reqOut->payload());
 
 _done_without_send:
     delete reqOut;
@@ -64,6 +64,10 @@
 #define MQTT_TOPIC_LOG "log"
 #endif
 
+#ifndef MQTT_TOPIC_TELEMETRY
+#define MQTT_TOPIC_TELEMETRY "telemetry"
+#endif
+
 #ifndef MQTT_TOPIC_MASTER
 #define MQTT_TOPIC_MASTER "master"
 #endif
@@ -85,3 +89,23 @@
 #ifndef MAX_ITEMS_IN_PUBLISH_QUEUE 
 #define MAX_ITEMS_IN_PUBLISH_QUEUE   50
 #endif
+
+// Reconnect back-off (mSeconds); doubled on each failure, with jitter.
+#ifndef MQTT_RECONNECT_MIN
+#define MQTT_RECONNECT_MIN (2 * 1000)
+#endif
+
+#ifndef MQTT_RECONNECT_MAX
+#define MQTT_RECONNECT_MAX (120 * 1000)
+#endif
+
+#ifndef MAX_TRUST_N
+#define MAX_TRUST_N (16) // Nodes we take signed messages from directly; each has its own topic.
+#endif
+
+#ifndef MAX_INTERNED_TOPICS
+#define MAX_INTERNED_TOPICS (8 + MAX_TRUST_N)
+#endif
+#if MAX_INTERNED_TOPICS > 254
+#error "MAX_INTERNED_TOPICS too large; the topic buckets hold index + 1 in a byte."
+#endif
@@ -16,9 +16,7 @@ MqttLogStream::MqttLogStream() {
 }
 
 void MqttLogStream::begin() {
-  snprintf(_logtopic, sizeof(_logtopic), "%s/%s/%s",
-	_acnode->mqtt_topic_prefix, _acnode->logpath, _acnode->moi);
-  Debug.printf("Sending output to logtopic %s\n", _logtopic);
+  Debug.printf("Sending output to logtopic %s\n", _acnode->topic(ACNode::TOPIC_LOG));
 }
 
 size_t MqttLogStream::write(uint8_t c) {
@@ -46,7 +44,7 @@ size_t MqttLogStream::write(uint8_t c) {
      snprintf(buff,sizeof(buff),"%s %s", _acnode->moi, _logbuff);
 #endif
      if (_acnode->isUp())
-	     _acnode->send(_logtopic, buff, true);
+	     _acnode->send(_acnode->topic(ACNode::TOPIC_LOG), buff, true);
      // else silently drop logging data when the bus is down.
   }
   return 1;
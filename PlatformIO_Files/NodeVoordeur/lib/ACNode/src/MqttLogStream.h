@@ -11,7 +11,7 @@ class MqttLogStream: public ACLog {
     void begin();
     virtual size_t write(uint8_t c); 
   private:
-    char _logbuff[MAX_MSG], _logtopic[MAX_MSG];
+    char _logbuff[MAX_MSG];
     size_t _at;
   protected:
 };
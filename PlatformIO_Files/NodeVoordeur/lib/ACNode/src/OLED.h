@@ -55,7 +55,8 @@ class OLED : public ACBase {
 	TwoWire * i2cbus= &Wire
     );
 
-    void report(JsonObject& report);
+    void report(ACReport& report);
+    const char * const * commands() { return no_commands(); };
 
     void setSpeed(int speed);
     void setIcon(int slot, const unsigned char *icon);
@@ -50,7 +50,7 @@ void OTA::begin() {
   Debug.println("OTA Enabled");
 }
 
-void OTA::report(JsonObject& report) {
+void OTA::report(ACReport& report) {
   report["ota"] = true;
 }
 
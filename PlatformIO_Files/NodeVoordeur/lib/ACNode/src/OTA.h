@@ -10,7 +10,8 @@ class OTA: public ACBase
     OTA(const char * password);
     void loop();
     void begin();
-    void report(JsonObject& report);
+    void report(ACReport& report);
+    const char * const * commands() { return no_commands(); };
   protected:
 	const char * _ota_password;
 };
@@ -0,0 +1,178 @@
+#ifdef ESP32
+
+#include <Outbox.h>
+#include <string.h>
+#include <Arduino.h>
+#include "FS.h"
+#include "SPIFFS.h"
+#include "ACNode-private.h"
+
+// #define DEBUG_OUTBOX
+
+#define OUTBOX_DIR_PREFIX "/outbox"
+#define EVENT_FILE_PREFIX "/ev"
+
+unsigned long outboxQueued = 0;
+unsigned long outboxReplayed = 0;
+unsigned long outboxDropped = 0;
+
+extern int items_in_publish_queue;
+
+struct outboxevent {
+  unsigned long seq;
+  char event[MAX_OUTBOX_EVENT];
+};
+
+// Events are kept one per file; in a ring of MAX_OUTBOX_DEPTH slots
+// indexed by sequence number. So we can recover the order on boot
+// by just looking at the sequence numbers.
+//
+static unsigned long head = 0; // next seq to write
+static unsigned long tail = 0; // oldest seq not yet confirmed as sent
+static bool inFlight = false;  // tail has been handed to the publish queue
+
+static String slotPath(unsigned long seq) {
+  return OUTBOX_DIR_PREFIX + (String)EVENT_FILE_PREFIX + String(seq % MAX_OUTBOX_DEPTH, DEC);
+}
+
+static bool readSlot(unsigned long seq, struct outboxevent * ev) {
+  String path = slotPath(seq);
+  if (!SPIFFS.exists(path))
+    return false;
+
+  File f = SPIFFS.open(path, "rb");
+  f.setTimeout(0);
+  int readSize = f.readBytes((char*)ev, sizeof(*ev));
+  f.close();
+
+  if (readSize != sizeof(*ev))
+    return false;
+  ev->event[sizeof(ev->event) - 1] = 0;
+  return true;
+}
+
+static void removeSlot(unsigned long seq) {
+  String path = slotPath(seq);
+  if (SPIFFS.exists(path))
+    SPIFFS.remove(path);
+}
+
+void prepareOutbox(bool wipe) {
+  // Relies on prepareCache() having mounted SPIFFS.
+  String dirName = OUTBOX_DIR_PREFIX;
+  if (!SPIFFS.exists(dirName)) { 
+    SPIFFS.mkdir(dirName);
+  }
+
+  head = tail = 0;
+  inFlight = false;
+
+  bool found = false;
+  struct outboxevent ev;
+  for (int i = 0; i < MAX_OUTBOX_DEPTH; i++) {
+    if (wipe) {
+      removeSlot(i);
+      continue;
+    };
+    if (!readSlot(i, &ev) || (ev.seq % MAX_OUTBOX_DEPTH) != (unsigned long) i) 
+      continue;
+    if (!found || ev.seq < tail)
+      tail = ev.seq;
+    if (!found || ev.seq >= head)
+      head = ev.seq + 1;
+    found = true;
+  };
+
+  if (outboxDepth())
+    Log.printf("Outbox has %d audit event(s) pending from before.\n", outboxDepth());
+}
+
+int outboxDepth() {
+  return head - tail;
+}
+
+bool outboxAdd(const char * event) {
+  struct outboxevent ev;
+
+  if (strlen(event) >= sizeof(ev.event)) {
+    Log.println("Audit event too long for the outbox - dropped.");
+    outboxDropped++;
+    return false;
+  };
+
+  // Full - sacrifice the oldest; but never the one in flight.
+  if (outboxDepth() >= MAX_OUTBOX_DEPTH) {
+    if (inFlight) {
+      Log.println("Outbox full - audit event dropped.");
+      outboxDropped++;
+      return false;
+    };
+    removeSlot(tail);
+    tail++;
+    outboxDropped++;
+    Log.println("Outbox full - oldest audit event dropped.");
+  };
+
+  bzero(&ev, sizeof(ev));
+  ev.seq = head;
+  strncpy(ev.event, event, sizeof(ev.event) - 1);
+
+  File f = SPIFFS.open(slotPath(head), "wb");
+  unsigned int writeSize = f.write((byte*)&ev, sizeof(ev));
+  f.close();
+
+  if (writeSize != sizeof(ev)) {
+    Log.println("Could not write audit event to SPIFFS - dropped.");
+    removeSlot(head);
+    outboxDropped++;
+    return false;
+  };
+
+#ifdef DEBUG_OUTBOX
+  Debug.printf("Outbox: stored #%lu: %s\n", head, event);
+#endif
+  head++;
+  outboxQueued++;
+  return true;
+}
+
+// Replay in order, one at a time; only handing over the next event once
+// the in-RAM publish queue has fully drained. The event is only removed
+// from flash once it has left that queue; so a reboot in between causes
+// a (harmless) duplicate rather than a gap.
+//
+void outboxLoop() {
+  if (!outboxDepth() || !_acnode->isUp() || items_in_publish_queue > 0)
+    return;
+
+  if (inFlight) {
+    removeSlot(tail);
+    tail++;
+    inFlight = false;
+    outboxReplayed++;
+    return;
+  };
+
+  struct outboxevent ev;
+  if (!readSlot(tail, &ev) || ev.seq != tail) {
+    Log.printf("Outbox: event #%lu unreadable - skipped.\n", tail);
+    removeSlot(tail);
+    tail++;
+    outboxDropped++;
+    return;
+  };
+
+#ifdef DEBUG_OUTBOX
+  Debug.printf("Outbox: replaying #%lu: %s\n", tail, ev.event);
+#endif
+  _acnode->send(ev.event);
+  inFlight = true;
+}
+
+#else
+unsigned long outboxQueued = 0, outboxReplayed = 0, outboxDropped = 0;
+void prepareOutbox(bool wipe) { return; }
+bool outboxAdd(const char * event) { return false; }
+int outboxDepth() { return 0; }
+void outboxLoop() { return; }
+#endif
@@ -0,0 +1,23 @@
+#ifndef _OUTBOX_H
+#define _OUTBOX_H
+
+// Flash (SPIFFS) backed outbox for audit events, such as door opens
+// on a cached approval or denials; so the master its audit trail stays
+// complete across network outages and reboots.
+//
+#ifndef MAX_OUTBOX_DEPTH
+#define MAX_OUTBOX_DEPTH 64
+#endif
+
+#ifndef MAX_OUTBOX_EVENT
+#define MAX_OUTBOX_EVENT 96
+#endif
+
+extern unsigned long outboxQueued, outboxReplayed, outboxDropped;
+
+void prepareOutbox(bool wipe);
+bool outboxAdd(const char * event);
+int outboxDepth();
+void outboxLoop();
+
+#endif
@@ -0,0 +1,77 @@
+#include <Profile.h>
+#include <string.h>
+
+static profile_slot_t slots[MAX_PROFILE_SLOTS];
+static int nSlots = 0;
+
+// Slots are looked up by name once; at registration. Handlers that
+// share a name() share a slot.
+//
+int profileSlot(const char * name) {
+    for (int i = 0; i < nSlots; i++)
+        if (!strcmp(slots[i].name, name))
+            return i;
+    if (nSlots >= MAX_PROFILE_SLOTS)
+        return -1;
+
+    bzero(&slots[nSlots], sizeof(profile_slot_t));
+    slots[nSlots].name = name;
+    slots[nSlots].min = ~0UL;
+    return nSlots++;
+}
+
+void profileAdd(int slot, unsigned long us) {
+    if (slot < 0 || slot >= nSlots)
+        return;
+    profile_slot_t * s = &slots[slot];
+
+    s->n++;
+    s->total += us;
+    if (us < s->min) s->min = us;
+    if (us > s->max) s->max = us;
+
+    int b = 0;
+    for (unsigned long d = 10; b < PROFILE_BUCKETS - 1 && us >= d; d *= 10)
+        b++;
+    s->hist[b]++;
+}
+
+void profileReset() {
+    for (int i = 0; i < nSlots; i++) {
+        const char * name = slots[i].name;
+        bzero(&slots[i], sizeof(profile_slot_t));
+        slots[i].name = name;
+        slots[i].min = ~0UL;
+    };
+}
+
+const profile_slot_t * profileGet(int slot) {
+    return (slot < 0 || slot >= nSlots) ? NULL : &slots[slot];
+}
+
+// The one with the highest average; as that is the one starving the loop.
+//
+const profile_slot_t * profileSlowest() {
+    const profile_slot_t * worst = NULL;
+    for (int i = 0; i < nSlots; i++) {
+        if (slots[i].n == 0)
+            continue;
+        if (worst == NULL || slots[i].total * worst->n > worst->total * slots[i].n)
+            worst = &slots[i];
+    };
+    return worst;
+}
+
+void profileLog(Print & out) {
+    out.printf("%-16s %8s %8s %8s %8s  <10us <100us <1ms <10ms <100ms <1s >1s\n", 
+        "phase", "count", "min", "avg", "max");
+    for (int i = 0; i < nSlots; i++) {
+        profile_slot_t * s = &slots[i];
+        if (s->n == 0)
+            continue;
+        out.printf("%-16s %8lu %8lu %8lu %8lu ", s->name, s->n, s->min, (unsigned long)(s->total / s->n), s->max);
+        for (int b = 0; b < PROFILE_BUCKETS; b++)
+            out.printf(" %lu", s->hist[b]);
+        out.println();
+    };
+}
@@ -0,0 +1,42 @@
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include <Arduino.h>
+
+// Lightweight timing of the phases of ACNode::loop() and of each
+// handler its loop(); min/avg/max and a coarse histogram per phase.
+// Shown with the 'profile' command; the slowest phase is in the report.
+//
+#ifndef MAX_PROFILE_SLOTS
+#define MAX_PROFILE_SLOTS (24)
+#endif
+
+// Decades of microseconds; <10us, <100us .. <1s, and >= 1 second.
+#define PROFILE_BUCKETS (7)
+
+typedef struct {
+    const char * name;
+    unsigned long n, min, max;
+    unsigned long long total;
+    unsigned long hist[PROFILE_BUCKETS];
+} profile_slot_t;
+
+int profileSlot(const char * name);
+void profileAdd(int slot, unsigned long us);
+void profileReset();
+const profile_slot_t * profileGet(int slot);
+const profile_slot_t * profileSlowest();
+void profileLog(Print & out);
+
+// Times the enclosing scope.
+//
+class ProfileScope {
+public:
+    ProfileScope(int slot) : _slot(slot), _start(micros()) {};
+    ~ProfileScope() { profileAdd(_slot, micros() - _start); };
+private:
+    int _slot;
+    unsigned long _start;
+};
+
+#endif
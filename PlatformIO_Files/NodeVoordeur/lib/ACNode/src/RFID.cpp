@@ -94,6 +94,8 @@ bool RFID::CheckPN53xBoardAvailable()
 void RFID::begin() {
    if (nfcCardUsed) {
       _nfc532->begin();
+      if (_nfc_task == -1)
+         _nfc_task = _acnode->every("nfc", 100, [this]() { nfc_poll(); });
       uint32_t versiondata = _nfc532->getFirmwareVersion();
       if (! versiondata) {
          Serial.println("RFId: Didn't find PN53x board");
@@ -122,56 +124,60 @@ void RFID::begin() {
    }
 }
 
+// Polled from the scheduler every 100 mSeconds; see begin().
+//
+void RFID::nfc_poll() {
+   if (!foundPN53xBoard)
+      return;
+
+   uint8_t success;
+   uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };  // Buffer to store the returned UID
+   uint8_t uidLength;                                       // Length of the UID (4 or 7 bytes depending on ISO14443A card type)
+                                                            // maximun 12 bytes for other types
+   // Wait for an ISO14443A type cards (Mifare, etc.).  When one is found
+   // 'uid' will be populated with the UID, and uidLength will indicate
+   // if the uid is 4 bytes (Mifare Classic) or 7 bytes (Mifare Ultralight)
+
+   success = _nfc532->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 20);
+   if (success && uidLength && !tagDecoded) {
+      tagDecoded = true;
+      char tag[MAX_TAG_LEN * 4] = { 0 };
+      for (int i = 0; i < uidLength; i++) {
+         char buff[5];
+         snprintf(buff, sizeof(buff), "%s%d", i ? "-" : "", uid[i]);
+         strncat(tag, buff, sizeof(tag));
+      };
+      // Log.printf("Tag ID = %s\n", tag);
+      Serial.printf("Tag ID = %s\n\r", tag);
+
+      // Limit the rate of reporting. Unless it is a new tag.
+      //
+      if (strncmp(lasttag, tag, sizeof(lasttag)) || millis() - lastswipe > 3000) {
+            lastswipe = millis();
+         strncpy(lasttag, tag, sizeof(tag));
+
+         if (!_swipe_cb || (_swipe_cb(lasttag) != ACNode::CMD_CLAIMED)) {
+               // Simple approval request; default is to 'energise' the contactor on 'machine'.
+            Log.println("Requesting approval");
+            _acnode->request_approval_devices(lasttag, NULL,NULL, useTagsStoredInCache);
+         } else {
+            Debug.println( _swipe_cb ? "internal rq used " : "callback claimed" );
+         };
+      };
+      _scan++;
+   } else {
+      if (!success) {
+         tagDecoded = false;
+      }
+      if (success && (uidLength <= 0)) {
+         _miss++;
+      }
+   }
+}
+
 void RFID::loop() {
    if (nfcCardUsed) {
-      if (foundPN53xBoard) {
-         uint8_t success;
-         uint8_t uid[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };  // Buffer to store the returned UID
-         uint8_t uidLength;                                       // Length of the UID (4 or 7 bytes depending on ISO14443A card type)
-                                                                  // maximun 12 bytes for other types
-         // Wait for an ISO14443A type cards (Mifare, etc.).  When one is found
-         // 'uid' will be populated with the UID, and uidLength will indicate
-         // if the uid is 4 bytes (Mifare Classic) or 7 bytes (Mifare Ultralight)
-
-         if ((millis() > nextCheck)) {
-            success = _nfc532->readPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &uidLength, 20);
-            if (success && uidLength && !tagDecoded) {
-               tagDecoded = true;
-               char tag[MAX_TAG_LEN * 4] = { 0 };
-               for (int i = 0; i < uidLength; i++) {
-                  char buff[5];
-                  snprintf(buff, sizeof(buff), "%s%d", i ? "-" : "", uid[i]);
-                  strncat(tag, buff, sizeof(tag));
-               };
-               // Log.printf("Tag ID = %s\n", tag);
-               Serial.printf("Tag ID = %s\n\r", tag);
-
-               // Limit the rate of reporting. Unless it is a new tag.
-               //
-               if (strncmp(lasttag, tag, sizeof(lasttag)) || millis() - lastswipe > 3000) {
-                     lastswipe = millis();
-                  strncpy(lasttag, tag, sizeof(tag));
-
-                  if (!_swipe_cb || (_swipe_cb(lasttag) != ACNode::CMD_CLAIMED)) {
-                        // Simple approval request; default is to 'energise' the contactor on 'machine'.
-                     Log.println("Requesting approval");
-                     _acnode->request_approval_devices(lasttag, NULL,NULL, useTagsStoredInCache);
-                  } else {
-                     Debug.println( _swipe_cb ? "internal rq used " : "callback claimed" );
-                  };
-               };
-               _scan++;
-            } else {
-               if (!success) {
-                  tagDecoded = false;
-               }
-               if (success && (uidLength <= 0)) {
-                  _miss++;
-               }
-            }
-            nextCheck = millis() + 100;
-         }
-      }      
+      // The PN53x is polled by nfc_poll(); from the scheduler.
       return;      
    } else {
       // if we are in IRQ mode; and we've seen no card; then just
@@ -236,7 +242,7 @@ void RFID::loop() {
    }
 }
 
-void RFID::report(JsonObject& report) {
+void RFID::report(ACReport& report) {
 	report["rfid_scans"] = _scan;
 	report["rfid_misses"] = _miss;
 }
@@ -68,7 +68,8 @@ class RFID : public ACBase {
 
     void loop();
 
-    void report(JsonObject& report);
+    void report(ACReport& report);
+    const char * const * commands() { return no_commands(); };
 
     typedef std::function<ACBase::cmd_result_t(const char *)> THandlerFunction_SwipeCB;
 
@@ -92,7 +93,8 @@ class RFID : public ACBase {
 
     char lasttag[MAX_TAG_LEN * 4];      // Up to a 3 digit byte and a dash or terminating \0. */
     unsigned long lastswipe, _scan, _miss;
-    unsigned long nextCheck = 0;
+    int _nfc_task = -1;
+    void nfc_poll();
     bool tagDecoded = false;
 };
 #endif
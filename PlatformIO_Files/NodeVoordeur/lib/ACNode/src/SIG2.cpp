@@ -7,10 +7,19 @@
 #include <Ed25519.h>
 #include <RNG.h>
 #include <SHA256.h>
+#include <BLAKE2s.h>
 
 #include <EEPROM.h>
+#ifdef ESP32
+#include "FS.h"
+#include "SPIFFS.h"
+#endif
 #include <AES.h>
 #include <CBC.h>
+#include <ChaChaPoly.h>
+
+#include "CryptoWorker.h"
+#include "Cache.h" // hash()
 
 #include <unordered_map>
 
@@ -65,7 +74,7 @@ extern uint8_t sessionkey[CURVE259919_SESSIONLEN];
 
 extern bool sig2_active();
 
-extern void kickoff_RNG();
+extern bool kickoff_RNG();
 
 extern void load_eeprom();
 extern void save_eeprom();
@@ -89,12 +98,339 @@ uint8_t node_publicsession[CURVE259919_KEYLEN];
 uint8_t node_privatesession[CURVE259919_KEYLEN];
 uint8_t sessionkey[CURVE259919_SESSIONLEN];
 
+// Master keys the current sessionkey was derived against; so that a
+// welcome/announce after a mere reconnect can resume the session
+// rather than redo the (slow) Curve25519 calculation.
+//
+static uint8_t session_master_sign[CURVE259919_KEYLEN];
+static uint8_t session_master_encr[CURVE259919_SESSIONLEN];
+static bool session_valid = false;
+unsigned long sessionsResumed = 0;
+
+// SIG/3 keys; one per direction, derived from the session key. Only
+// used once the master its welcome said it speaks SIG/3 too.
+//
+static uint8_t mac_to_master[HASH_LENGTH];
+static uint8_t mac_from_master[HASH_LENGTH];
+static uint8_t cloak_key[HASH_LENGTH];
+static bool mac_agreed = false;
+unsigned long macVerified = 0, macSent = 0;
+
+#define SIG3_VERSION "SIG/3.0"
+
+static void derive_mac_keys() {
+  SHA256 sha256;
+  sha256.resetHMAC(sessionkey, sizeof(sessionkey));
+  sha256.update("SIG/3 node to master", 20);
+  sha256.finalizeHMAC(sessionkey, sizeof(sessionkey), mac_to_master, sizeof(mac_to_master));
+
+  sha256.resetHMAC(sessionkey, sizeof(sessionkey));
+  sha256.update("SIG/3 master to node", 20);
+  sha256.finalizeHMAC(sessionkey, sizeof(sessionkey), mac_from_master, sizeof(mac_from_master));
+
+  sha256.resetHMAC(sessionkey, sizeof(sessionkey));
+  sha256.update("SIG/3 cloak", 11);
+  sha256.finalizeHMAC(sessionkey, sizeof(sessionkey), cloak_key, sizeof(cloak_key));
+}
+
+// The key for the audit tags; see tag_mac(). Unlike the session key it
+// survives a reboot; so an event that sat in the outbox still carries a
+// tag the master can resolve when it is replayed, whatever session it is
+// replayed in. Derived from our private signing key; the master is told
+// it, cloaked, with every new session.
+//
+static uint8_t audit_key[HASH_LENGTH];
+static bool audit_key_valid = false;
+static bool audit_key_due = false;
+
+static bool derive_audit_key() {
+  if (!(eeprom.flags & CRYPTO_HAS_PRIVATE_KEYS))
+    return false;
+  if (audit_key_valid)
+    return true;
+
+  SHA256 sha256;
+  sha256.resetHMAC(eeprom.node_privatesign, sizeof(eeprom.node_privatesign));
+  sha256.update("SIG/2 audit", 11);
+  sha256.finalizeHMAC(eeprom.node_privatesign, sizeof(eeprom.node_privatesign), audit_key, sizeof(audit_key));
+  audit_key_valid = true;
+  return true;
+}
+
+// Nearly everything we verify is signed by the master; so keep its key
+// decoded, with its table of multiples, rather than decode it per message.
+//
+static Ed25519::VerifyKey master_verifykey;
+static bool master_verifykey_prepared = false;
+
+// Messages from the master that arrived back to back (or a lone one when
+// there is a crypto worker); their signatures are checked in one go by
+// verify_batch(). One batch at a time; ACNode holds the requests back
+// while verifying().
+//
+static struct {
+  crypto_job_t job;
+  ACRequest * reqs[VERIFY_BATCH_MAX];
+  uint8_t signatures[VERIFY_BATCH_MAX][ED59919_SIGLEN];
+  const uint8_t * sigs[VERIFY_BATCH_MAX], * keys[VERIFY_BATCH_MAX];
+  const void * msgs[VERIFY_BATCH_MAX];
+  size_t lens[VERIFY_BATCH_MAX];
+  size_t n;
+  bool busy;
+} inbound;
+
+static bool verify_signature(const uint8_t signature[ED59919_SIGLEN], const uint8_t * signkey, const char * msg) {
+  if (memcmp(signkey, eeprom.master_publicsignkey, sizeof(eeprom.master_publicsignkey)))
+    return Ed25519::verify(signature, signkey, msg, strlen(msg));
+
+  if (!master_verifykey_prepared || memcmp(master_verifykey.key, signkey, sizeof(master_verifykey.key))) {
+    // The worker may be using the one we have; leave it be.
+    if (inbound.busy)
+      return Ed25519::verify(signature, signkey, msg, strlen(msg));
+    Ed25519::prepareVerifyKey(master_verifykey, signkey);
+    master_verifykey_prepared = true;
+  };
+  return Ed25519::verify(signature, master_verifykey, msg, strlen(msg));
+}
+
+unsigned long sigBatches = 0, sigBatched = 0, sigBatchesFailed = 0;
+
+static void session_mac(const uint8_t key[HASH_LENGTH], const char * msg, uint8_t mac[HASH_LENGTH]) {
+  SHA256 sha256;
+  sha256.resetHMAC(key, HASH_LENGTH);
+  sha256.update(msg, strlen(msg));
+  sha256.finalizeHMAC(key, HASH_LENGTH, mac, HASH_LENGTH);
+}
+
+// Replay window; per sender (i.e. the topic it comes in on). A bitmap of
+// the beats, over the last REPLAY_WINDOW, that carried an accepted message;
+// and a fingerprint of the signed part of the last REPLAY_FP of those. As
+// beats are seconds several messages can share one. A copy of an accepted
+// message, or anything older than the window, is dropped before its
+// signature or MAC is looked at.
+//
+#define REPLAY_WINDOW (64) // beats; a bit each in a uint64_t.
+
+#ifndef REPLAY_FP
+#define REPLAY_FP (8)
+#endif
+
+typedef struct {
+  beat_t top;     // newest beat accepted; 0 if none yet.
+  uint64_t seen;  // bit i; a message with beat top - i was accepted.
+  beat_t floor;   // newest beat whose fingerprint fell out of recent[].
+  struct { beat_t beat; unsigned long fp; } recent[REPLAY_FP];
+  uint8_t next;
+} replay_t;
+
+typedef enum { REPLAY_NEW, REPLAY_DUPLICATE, REPLAY_STALE } replay_result_t;
+
+static replay_t replay[ MAX_INTERNED_TOPICS ];
+unsigned long replayDuplicates = 0, replayStale = 0;
+
+static replay_result_t replay_check(int topic_id, beat_t beat, unsigned long fp) {
+  if (topic_id < 0 || topic_id >= MAX_INTERNED_TOPICS)
+    return REPLAY_NEW;
+  replay_t * r = &replay[topic_id];
+  if (r->top == 0 || beat > r->top)
+    return REPLAY_NEW;
+
+  beat_t age = r->top - beat;
+  if (age >= REPLAY_WINDOW)
+    return REPLAY_STALE;
+  if (!(r->seen & (1ULL << age)))
+    return REPLAY_NEW;
+
+  for (int i = 0; i < REPLAY_FP; i++)
+    if (r->recent[i].beat == beat && r->recent[i].fp == fp)
+      return REPLAY_DUPLICATE;
+
+  // Not in recent[]; but that only covers what came after floor.
+  return (beat > r->floor) ? REPLAY_NEW : REPLAY_STALE;
+}
+
+static void replay_accept(int topic_id, beat_t beat, unsigned long fp) {
+  if (topic_id < 0 || topic_id >= MAX_INTERNED_TOPICS)
+    return;
+  replay_t * r = &replay[topic_id];
+  if (r->top == 0 || beat > r->top) {
+    beat_t shift = r->top ? beat - r->top : REPLAY_WINDOW;
+    r->seen = (shift >= REPLAY_WINDOW) ? 0 : (r->seen << shift);
+    r->top = beat;
+  };
+  // Only a nonced welcome gets past replay_check() this old.
+  if (r->top - beat >= REPLAY_WINDOW)
+    return;
+  r->seen |= 1ULL << (r->top - beat);
+
+  if (r->recent[r->next].beat > r->floor)
+    r->floor = r->recent[r->next].beat;
+  r->recent[r->next].beat = beat;
+  r->recent[r->next].fp = fp;
+  r->next = (r->next + 1) % REPLAY_FP;
+}
+
+static bool replay_drop(replay_result_t seen, beat_t beat) {
+  switch (seen) {
+  case REPLAY_DUPLICATE:
+    Debug.println("Duplicate of a message already accepted - dropped.");
+    replayDuplicates++;
+    return true;
+  case REPLAY_STALE:
+    Log.printf("Message with beat %lu is older than the replay window - dropped.\n", beat);
+    replayStale++;
+    return true;
+  default:
+    break;
+  };
+  return false;
+}
+
+// Nonces are not secret; but what gets them accepted is. So compare
+// in constant time; the length is no secret either.
+//
+static bool nonce_equal(const char * a, const char * b) {
+  size_t len = strlen(a);
+  return len && len == strlen(b) && secure_compare(a, b, len);
+}
+
 // Keys upon whcih trust can be registed. the requested field is used for a nonce; but can be used as an age.
-typedef struct { char node[MAX_NAME]; uint8_t pubkey[CURVE259919_KEYLEN]; unsigned long requested; } trust_t;
-#define MAX_TRUST_N (8)
+//
+// Found by the hash of the node name (open addressing; nodes are never
+// removed), or by the topic their messages come in on. The keys the
+// master vouched for are kept in SPIFFS; so after a reboot messages from
+// these nodes verify straight away rather than after a pubkey round trip
+// per node. A stored key is asked for again lazily; once it is older than
+// TRUST_REVALIDATE or when a message fails to verify against it.
+//
+#ifndef TRUST_REVALIDATE
+#define TRUST_REVALIDATE (7 * 24 * 3600) // beats; i.e. seconds.
+#endif
+
+#ifndef TRUST_REREQUEST_MIN
+#define TRUST_REREQUEST_MIN (60 * 1000) // mSeconds between asking the master about the same node.
+#endif
+
+#define TRUST_FILE "/trust"
+#define TRUST_FILE_VERSION (0x0001)
+
+typedef struct {
+  char node[MAX_NAME];
+  unsigned long hash;
+  uint8_t pubkey[CURVE259919_KEYLEN];
+  bool haveKey;
+  beat_t validated;        // when the master last vouched for the key.
+  unsigned long requested; // millis(); 0 if never asked.
+  int topic_id;
+} trust_t;
+
 trust_t trust[ MAX_TRUST_N ];
 int nTrusted = 0;
 
+// Index + 1 into trust[]; 0 is empty.
+static uint8_t trust_bucket[ 2 * MAX_TRUST_N ];
+static uint8_t trust_by_topic[ MAX_INTERNED_TOPICS ];
+static bool trust_loaded = false;
+
+unsigned long trustHit = 0, trustMiss = 0, trustRequests = 0;
+
+static int find_trusted(const char * node) {
+  unsigned long h = hash(node);
+  for (unsigned int b = h % (2 * MAX_TRUST_N); trust_bucket[b]; b = (b + 1) % (2 * MAX_TRUST_N)) {
+    trust_t * t = &trust[ trust_bucket[b] - 1 ];
+    if (t->hash == h && !strcmp(t->node, node))
+      return trust_bucket[b] - 1;
+  };
+  return -1;
+}
+
+static int trusted_by_topic(int topic_id) {
+  if (topic_id < 0 || topic_id >= MAX_INTERNED_TOPICS)
+    return -1;
+  return trust_by_topic[topic_id] - 1;
+}
+
+static bool trust_stale(int i) {
+  return !trust[i].haveKey || beat_absdelta(trust[i].validated, beatCounter) > TRUST_REVALIDATE;
+}
+
+#ifdef ESP32
+typedef struct __attribute__ ((packed)) {
+  uint16_t version;
+  uint16_t n;
+  uint8_t master_publicsignkey[CURVE259919_KEYLEN];
+} trust_file_t;
+
+typedef struct __attribute__ ((packed)) {
+  char node[MAX_NAME];
+  uint8_t pubkey[CURVE259919_KEYLEN];
+  uint32_t validated;
+} trust_record_t;
+
+// Only keys vouched for by the master we are slaved to count; a file
+// from an earlier master (or an earlier TOFU) is ignored.
+//
+static void load_trust() {
+  if (!SPIFFS.exists(TRUST_FILE))
+    return;
+
+  File f = SPIFFS.open(TRUST_FILE, "rb");
+  f.setTimeout(0);
+  trust_file_t hdr;
+  if (f.readBytes((char *)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.version != TRUST_FILE_VERSION ||
+      memcmp(hdr.master_publicsignkey, eeprom.master_publicsignkey, sizeof(hdr.master_publicsignkey))) {
+    Log.println("Ignoring stored trusted keys; other version or master.");
+    f.close();
+    return;
+  };
+
+  int n = 0;
+  trust_record_t rec;
+  for (int r = 0; r < hdr.n && f.readBytes((char *)&rec, sizeof(rec)) == sizeof(rec); r++) {
+    rec.node[sizeof(rec.node) - 1] = 0;
+    int i = find_trusted(rec.node);
+    if (i < 0 || trust[i].haveKey)
+      continue;
+    memcpy(trust[i].pubkey, rec.pubkey, sizeof(trust[i].pubkey));
+    trust[i].validated = rec.validated;
+    trust[i].haveKey = true;
+    n++;
+  };
+  f.close();
+  Debug.printf("Loaded %d stored trusted key(s).\n", n);
+}
+
+static void save_trust() {
+  File f = SPIFFS.open(TRUST_FILE, "wb");
+  if (!f) {
+    Log.println("Could not store the trusted keys.");
+    return;
+  };
+
+  trust_file_t hdr = { TRUST_FILE_VERSION, 0 };
+  memcpy(hdr.master_publicsignkey, eeprom.master_publicsignkey, sizeof(hdr.master_publicsignkey));
+  for (int i = 0; i < nTrusted; i++)
+    if (trust[i].haveKey)
+      hdr.n++;
+  f.write((uint8_t *)&hdr, sizeof(hdr));
+
+  for (int i = 0; i < nTrusted; i++) {
+    if (!trust[i].haveKey)
+      continue;
+    trust_record_t rec;
+    bzero(&rec, sizeof(rec));
+    strncpy(rec.node, trust[i].node, sizeof(rec.node) - 1);
+    memcpy(rec.pubkey, trust[i].pubkey, sizeof(rec.pubkey));
+    rec.validated = trust[i].validated;
+    f.write((uint8_t *)&rec, sizeof(rec));
+  };
+  f.close();
+}
+#else
+static void load_trust() { return; }
+static void save_trust() { return; }
+#endif
+
 static int init_done = 0;
 
 bool sig2_active() {
@@ -103,35 +439,116 @@ bool sig2_active() {
 
 uint8_t runtime_seed[ 32 ];
 
-void kickoff_RNG() {
+// From power-on (millis()) to; the RNG seeded, the keys derived, the
+// first announce and the first welcome. Logged once, when slaved; and in
+// the on-demand crypto report. They do not change after that.
+//
+unsigned long bootEntropyMs = 0, bootKeysMs = 0, bootReadyMs = 0, bootWelcomeMs = 0;
+
+#ifndef BOOT_ENTROPY_SAMPLES
+#define BOOT_ENTROPY_SAMPLES (25)
+#endif
+
+// esp_random() itself waits for fresh bits when read back to back; the
+// spacing just spreads the samples over the jitter of the network bring up.
+#ifndef BOOT_ENTROPY_SPACING
+#define BOOT_ENTROPY_SPACING (1) // mSeconds
+#endif
+
+static SHA256 boot_entropy;
+static int boot_samples = 0;
+static unsigned long boot_last_sample = 0;
+
+bool kickoff_RNG() {
   // Attempt to get a half decent seed soon after boot. We ought to pospone all operations
   // to the run loop - well after DHCP has gotten is into business.
   //
   // Note that Wifi/BT should be on according to:
   //    https://github.com/espressif/esp-idf/blob/master/components/esp32/hw_random.c
   //
-  RNG.begin(RNG_APP_TAG);
-
-  SHA256 sha256;
-  sha256.reset();
+  // One sample per call, spaced out; rather than a 250 mSecond delay()
+  // loop. So this overlaps with the network coming up. True once seeded.
+  //
+  if (boot_samples == 0) {
+    RNG.begin(RNG_APP_TAG);
+    boot_entropy.reset();
+  }
+  else if (millis() - boot_last_sample < BOOT_ENTROPY_SPACING)
+    return false;
 
-  for (int i = 0; i < 25; i++) {
+  if (boot_samples < BOOT_ENTROPY_SAMPLES) {
     uint32_t r = trng(); // RANDOM_REG32 ; // Or esp_random(); for the ESP32 in recent libraries.
-    sha256.update((unsigned char*)&r, sizeof(r));
-    delay(10);
+    boot_entropy.update((unsigned char*)&r, sizeof(r));
+    boot_last_sample = millis();
+    boot_samples++;
+    return false;
   };
 
   uint8_t mac[6];
   WiFi.macAddress(mac);
-  sha256.update(mac, sizeof(mac));
+  boot_entropy.update(mac, sizeof(mac));
 
-  uint8_t result[sha256.hashSize()];
-  sha256.finalize(result, sizeof(result));
+  uint8_t result[boot_entropy.hashSize()];
+  boot_entropy.finalize(result, sizeof(result));
   RNG.stir(result, sizeof(result), 100);
+  boot_entropy.clear();
 
   RNG.rand(runtime_seed,sizeof(runtime_seed));
   
   RNG.setAutoSaveTime(60);
+  return true;
+}
+
+// Public keys from their private ones; on the crypto worker if there is
+// one, so the loop does not stall on them. The sign key follows from the
+// stored private key; so it is derived while the network comes up. The
+// session keypair is fresh; drawn once connected, as before.
+//
+typedef struct {
+  crypto_job_t job;
+  uint8_t secret[CURVE259919_KEYLEN];
+  uint8_t pub[CURVE259919_KEYLEN];
+  uint8_t * result;
+  bool started, ready;
+} keygen_job_t;
+
+static keygen_job_t sign_keygen, session_keygen;
+
+static bool derive_sign(crypto_job_t * job) {
+  keygen_job_t * j = (keygen_job_t *) job;
+  Ed25519::derivePublicKey(j->pub, j->secret);
+  return true;
+}
+
+// As Curve25519::dh1(); its weak point check cannot trigger for the base
+// point and a clamped secret.
+static bool derive_session(crypto_job_t * job) {
+  keygen_job_t * j = (keygen_job_t *) job;
+  return Curve25519::eval(j->pub, j->secret, 0);
+}
+
+static void derived(crypto_job_t * job) {
+  keygen_job_t * j = (keygen_job_t *) job;
+  if (j->job.ok)
+    memcpy(j->result, j->pub, sizeof(j->pub));
+  j->ready = j->job.ok;
+  j->started = j->job.ok; // else try again on the next loop.
+  memset(j->secret, 0, sizeof(j->secret));
+}
+
+static void start_keygen(keygen_job_t * j, bool (*work)(crypto_job_t *), const uint8_t secret[CURVE259919_KEYLEN], uint8_t * result) {
+  j->job.work = work;
+  j->job.done = derived;
+  memcpy(j->secret, secret, sizeof(j->secret));
+  j->result = result;
+  j->started = true;
+  j->ready = false;
+  if (cryptoSubmit(&j->job))
+    return;
+
+  resetWatchdog();
+  j->job.ok = work(&j->job);
+  derived(&j->job);
 }
 void load_eeprom() {
   for (size_t adr = 0; adr < sizeof(eeprom); adr++)
@@ -146,6 +563,7 @@ void save_eeprom() {
 
 void wipe_eeprom() {
   bzero((uint8_t *)&eeprom, sizeof(eeprom));
+  audit_key_valid = false;
   eeprom.version = EEPROM_VERSION;
   save_eeprom();
 }
@@ -170,8 +588,10 @@ void SIG2::loop() {
   Beat::loop();
 
   if (init_done == 0) {
-    kickoff_RNG();
-    init_done = 1;
+    if (kickoff_RNG()) {
+      bootEntropyMs = millis();
+      init_done = 1;
+    };
     return;
   };
 
@@ -184,6 +604,12 @@ void SIG2::loop() {
     return;
   };
 
+  if (init_done == 1 && (eeprom.flags & CRYPTO_HAS_PRIVATE_KEYS) && !sign_keygen.started)
+    start_keygen(&sign_keygen, derive_sign, eeprom.node_privatesign, node_publicsign);
+
+  if (audit_key_due && session_valid && _acnode->isUp())
+    send_audit_key();
+
   if (!_acnode->isConnected()) {
     // force re-connecting, etc post reconnect.
     if (init_done > 4) init_done = 4;
@@ -193,33 +619,40 @@ void SIG2::loop() {
   if (init_done > 4)
     return;
 
-  if (init_done == 1) {
+  // Spread over several loops; each step at most one key derivation.
+  //
+  if (init_done == 1 && !session_keygen.started) {
     Debug.println("Generating Curve25519 session keypair");
-    resetWatchdog();
-    Curve25519::dh1(node_publicsession, node_privatesession);
+    RNG.rand(node_privatesession, sizeof(node_privatesession));
+    node_privatesession[0] &= 0xF8;
+    node_privatesession[31] = (node_privatesession[31] & 0x7F) | 0x40;
     bzero(sessionkey, sizeof(sessionkey));
-
-    if (eeprom.flags & CRYPTO_HAS_PRIVATE_KEYS) {
-      Debug.printf("EEPROM Version %04x contains all needed keys and is TOFU to a master with public key\n", eeprom.version);
-    } else {
-      resetWatchdog();
-      Ed25519::generatePrivateKey(eeprom.node_privatesign);
-
-      eeprom.flags |= CRYPTO_HAS_PRIVATE_KEYS;
-
-      save_eeprom();
-      Debug.printf("EEPROM Version %04x contains all new private key for TOFU\n", eeprom.version);
-    }
-
+    session_valid = false;
+    mac_agreed = false;
+    start_keygen(&session_keygen, derive_session, node_privatesession, node_publicsession);
+    return;
+  };
+  if (init_done == 1 && !(eeprom.flags & CRYPTO_HAS_PRIVATE_KEYS)) {
     resetWatchdog();
-    Ed25519::derivePublicKey(node_publicsign, eeprom.node_privatesign);
+    Ed25519::generatePrivateKey(eeprom.node_privatesign);
 
+    eeprom.flags |= CRYPTO_HAS_PRIVATE_KEYS;
+
+    save_eeprom();
+    Debug.printf("EEPROM Version %04x contains all new private key for TOFU\n", eeprom.version);
+    return;
+  };
+  if (init_done == 1 && sign_keygen.ready && session_keygen.ready) {
+    Debug.printf("EEPROM Version %04x contains all needed keys\n", eeprom.version);
     init_done = 2;
+    bootKeysMs = millis();
     Debug.println("Full init. Ready for crypto");
     return;
   };
   if (init_done == 2 && _acnode->isUp() && sig2_active()) {
     init_done = 3;
+    if (!bootReadyMs)
+      bootReadyMs = millis();
     Log.println("SIG/2 ready, connected to mqtt, have private key and am announcing.");
     _acnode->send_helo();
    return;
@@ -227,8 +660,18 @@ void SIG2::loop() {
   // transition from 3->4 is once we are slaved.
   // 
   if (init_done == 4) {
-    for(int i = 0; i < nTrusted; i++)
-	request_trust(i);
+    if (!trust_loaded) {
+      Log.printf("Boot timeline (ms): entropy %lu, keys %lu, announce %lu, welcome %lu\n",
+        bootEntropyMs, bootKeysMs, bootReadyMs, bootWelcomeMs);
+      load_trust();
+      trust_loaded = true;
+    };
+    // Subscriptions go with the connection; the keys we may still have.
+    for(int i = 0; i < nTrusted; i++) {
+	subscribe_trusted(i);
+	if (trust_stale(i))
+		request_trust(i);
+    };
     init_done  = 5;
     return;
   };
@@ -238,38 +681,45 @@ void SIG2::loop() {
 // Note - we're not siging the topic.
 //
 ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
-  size_t len = strlen(req->payload);
+  size_t len = strlen(req->payload());
 
-  char * sender = rindex(req->topic,'/');
-  if (!sender) {
-	Log.println("No sender in topic. giving up.");
+  // Topics we listen on are interned by ACNode; so the sender follows from the id.
+  if (req->topicId == ACNode::TOPIC_UNKNOWN) {
+	Log.println("Not a topic we listen on. giving up.");
 	return ACSecurityHandler::FAIL;
   };
-  sender++; // Skip '/'.
-  bool sendIsMaster = !strcmp(_acnode->master, sender);
+  bool sendIsMaster = (req->topicId == ACNode::TOPIC_FROM_MASTER || req->topicId == ACNode::TOPIC_MASTER_BCAST);
+
+  if (strncmp(req->payload(), "SIG/3.", 6) == 0)
+    return verify_mac(req);
 
   // We only accept things starting with SIG/2*<space>hex<space>
-  if (len < 72 || strncmp(req->payload, "SIG/2.", 6) != 0) 
+  if (len < 72 || strncmp(req->payload(), "SIG/2.", 6) != 0) 
     return ACSecurityHandler::DECLINE;
 
-  if (len > sizeof(req->tmp) - 1) {
+  if (len > MAX_MSG - 1) {
     Debug.println("Failing SIG/2 signature - far too long");
     return FAIL;
   };
 
-  strncpy(req->tmp, req->payload, sizeof(req->tmp));
-  char * p = req->tmp;
+  // Scratch copy to tokenize; rest is kept as a view on the payload.
+  char tmp[len + 1];
+  strcpy(tmp, req->payload());
+  char * p = tmp;
 
   SEP(version, "SIG2Verify failed - no version", ACSecurityHandler::FAIL);
-  strncpy(req->version, version, sizeof(req->version));
+  if (!req->set_version(version))
+    return ACSecurityHandler::FAIL;
 
   SEP(signature64, "SIG2Verify failed - no signature64", ACSecurityHandler::FAIL);
 
   while (p && *p == ' ') p++;
-  strncpy(req->rest, p, sizeof(req->rest));
+  if (!p || !req->set_rest(req->payload() + (p - tmp)))
+    return ACSecurityHandler::FAIL;
 
   SEP(beat, "SIG2Verify failed - no beat", ACSecurityHandler::FAIL);
-  strncpy(req->beat, beat, sizeof(req->beat));
+  if (!req->set_beat(beat))
+    return ACSecurityHandler::FAIL;
 
   // Annoyingly - not all implementations of base64 are careful
   // with the final = and == and trailing \0.
@@ -280,7 +730,7 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
     return ACSecurityHandler::FAIL;
   };
 
-  req->beatExtracted = strtoul(req->beat, NULL, 10);
+  req->beatExtracted = strtoul(req->beat(), NULL, 10);
   if (req->beatExtracted == 0) {
     Debug.println("Failing SIG/2 sigature - beat parsing failed");
     return ACSecurityHandler::FAIL;
@@ -306,18 +756,28 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
   // XX fix me - this is asking for trouble 4 state variables; 16 permutions
   // and only a few secure. Rewrite!
   uint8_t * signkey = NULL; // tentative signing key in case of tofu
+  int trusted = -1;
   bool newsession = false;
   bool nonceOk = false;
+  bool macOffered = false;
 
   char * q = index(p, ' ');
-  size_t cmd_len = _min(sizeof(req->cmd), (q && *q) ? q - p : strlen(p));
-  req->cmd[cmd_len] = '\0';
-  strncpy(req->cmd, p, cmd_len);
+  size_t cmd_len = _min((size_t)MAX_TOKEN_LEN - 1, (q && *q) ? q - p : strlen(p));
+  if (!req->set_cmd(p, cmd_len))
+    return ACSecurityHandler::FAIL;
+
+  // A welcome with our nonce may be older than the window (and then
+  // resets it; see below). That waits for the nonce to be checked.
+  unsigned long fp = hash(req->rest());
+  replay_result_t seen = replay_check(req->topicId, req->beatExtracted, fp);
+  bool staleWelcome = (seen == REPLAY_STALE && strcmp(req->cmd(), "welcome") == 0);
+  if (!staleWelcome && replay_drop(seen, req->beatExtracted))
+    return ACSecurityHandler::FAIL;
 
   p = q;
   while (p && *p == ' ') p++;
 
-  if (sendIsMaster && (strcmp(req->cmd, "welcome") == 0  || strcmp(req->cmd, "announce") == 0)) {
+  if (sendIsMaster && (strcmp(req->cmd(), "welcome") == 0  || strcmp(req->cmd(), "announce") == 0)) {
     newsession = true;
 
     SEP(host_ip, "IP address", ACSecurityHandler::FAIL);
@@ -331,11 +791,15 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
       Debug.println("Ignoring - am hearing myself.");
       return ACSecurityHandler::OK;
     };
-    if (strcmp(req->cmd, "welcome") == 0) {
+    if (strcmp(req->cmd(), "welcome") == 0) {
       SEP(nonce, "Nonce extraction", ACSecurityHandler::FAIL);
   
-      if (!strcmp(_nonce, nonce))
+      if (nonce_equal(_nonce, nonce))
         nonceOk = true;
+
+      // Optional; a master that can do SIG/3 says so after the nonce.
+      char * mac = strsepspace(&p);
+      macOffered = mac && !strcmp(mac, SIG3_VERSION);
     };
     if (tofu) {
       if (memcmp(eeprom.master_publicsignkey, pubsign_tmp, sizeof(eeprom.master_publicsignkey))) {
@@ -353,15 +817,20 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
       signkey = pubsign_tmp;
     }
   } else 
-  if (!sendIsMaster && nTrusted) {
+  if (!sendIsMaster && (trusted = trusted_by_topic(req->topicId)) >= 0) {
     // needs to be re-written - too many easy to miss code paths that may have vulnerabilities/bypasses.
-    for(int i = 0; i < nTrusted; i++) 
-	if (strcmp(sender, trust[i].node) == 0) {
-		signkey = trust[i].pubkey;
-		Debug.printf("Allowing this message to be signed by node %s\n", sender);
-		break;
-	};
+    if (trust[trusted].haveKey) {
+	trustHit++;
+	signkey = trust[trusted].pubkey;
+	Debug.printf("Allowing this message to be signed by node %s\n", trust[trusted].node);
+    } else {
+	trustMiss++;
+	lazy_request_trust(trusted);
+    };
   };
+  if (staleWelcome && !nonceOk && replay_drop(seen, req->beatExtracted))
+    return ACSecurityHandler::FAIL;
+
   if (signkey == NULL && tofu) {
     Trace.println("Using existing master keys to verify.");
     signkey = eeprom.master_publicsignkey;
@@ -372,10 +841,19 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
   };
 
   resetWatchdog();
-  if (!Ed25519::verify(signature, signkey, req->rest, strlen(req->rest))) {
+  if (req->sigVerified && !memcmp(signkey, eeprom.master_publicsignkey, sizeof(eeprom.master_publicsignkey))) {
+    Trace.println("Signature already checked in a batch.");
+  }
+  else
+  if (!verify_signature(signature, signkey, req->rest())) {
     Log.println("Invalid Ed25519 signature on message -rejecting.");
+    // The node may have been re-keyed since the master vouched for it.
+    if (trusted >= 0 && signkey == trust[trusted].pubkey)
+      lazy_request_trust(trusted);
     return ACSecurityHandler::FAIL;
   };
+  if (trusted >= 0 && signkey == trust[trusted].pubkey && trust_stale(trusted))
+    lazy_request_trust(trusted);
 
   beat_t delta = beat_absdelta(req->beatExtracted, beatCounter);
   if (nonceOk) {
@@ -384,7 +862,7 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
   else if (delta < 1200) { // Apparently we can drive minutes in a short space of time.
     Trace.println("Beat ok.");
   }
-  else if (strcmp(req->cmd, "announce") == 0) {
+  else if (strcmp(req->cmd(), "announce") == 0) {
     Debug.printf("Beat too far off (%lu) - sending nonced welcome\n", delta);
     _acnode->send_helo();
     return ACSecurityHandler::FAIL;
@@ -395,6 +873,10 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
     return ACSecurityHandler::FAIL;
   };
 
+  // Fresh by construction; so whatever beat the master is on now goes.
+  if (nonceOk)
+    bzero(&replay[req->topicId], sizeof(replay[req->topicId]));
+
   if (!tofu && nonceOk && sendIsMaster) {
     Log.println("TOFU for Ed25519 key of master, stored in persistent store.");
     memcpy(eeprom.master_publicsignkey, signkey, sizeof(eeprom.master_publicsignkey));
@@ -405,6 +887,18 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
   else {
     Debug.println("Trusted; based on data from presistent store.");
   };
+  if (newsession && session_valid &&
+      !memcmp(session_master_sign, pubsign_tmp, sizeof(session_master_sign)) &&
+      !memcmp(session_master_encr, pubencr_tmp, sizeof(session_master_encr))) 
+  {
+    // Same master, same keys; and ours only change on reboot. So
+    // the session key would come out the same.
+    Debug.println("Master keys unchanged - resuming session.");
+    sessionsResumed++;
+    if (strcmp(req->cmd(), "welcome") == 0)
+      mac_agreed = _session_mac && macOffered;
+  }
+  else
   if (newsession) {
     // Allways allow for the updating of session keys. On every welcome/announce. Provided that
     // the signature matched.
@@ -435,19 +929,226 @@ ACSecurityHandler::acauth_result_t SIG2::verify(ACRequest * req) {
     Log.printf("(Re)calculated session key - slaved to master public signkey %s and masterpublic encrypt key %s\n",
                master_publicsignkey_b64, master_publicencryptkey_b64);
 
+    memcpy(session_master_sign, pubsign_tmp, sizeof(session_master_sign));
+    memcpy(session_master_encr, pubencr_tmp, sizeof(session_master_encr));
+    session_valid = true;
+
+    derive_mac_keys();
+    audit_key_due = true;
+    mac_agreed = _session_mac && macOffered && strcmp(req->cmd(), "welcome") == 0;
+    if (mac_agreed)
+      Log.println("Master speaks SIG/3 - using the session MAC from now on.");
+
     // Only accept pubkeys on poweron; not on simple server restarts.
     // So that a temp-fault/hack at the server does not mean wrong
     // keys in all nodes.
     //
     if (init_done < 4)
         init_done = 4;
+    if (!bootWelcomeMs)
+        bootWelcomeMs = millis();
 
     eeprom.flags |= CRYPTO_HAS_MASTER_TOFU;
   };
 
-  return  Beat::verify(req);
+  beat_t sent = req->beatExtracted;
+  acauth_result_t r = Beat::verify(req);
+  if (r == ACSecurityHandler::OK)
+    replay_accept(req->topicId, sent, fp);
+  return r;
 };
 
+// Messages from the master that arrive back to back get their signatures
+// checked in one batch; verify() then skips the Ed25519 step for those.
+// If the batch fails, verify() finds out which ones one by one. With the
+// crypto worker this happens on the other core; and is worth it even for
+// a single message.
+//
+static void prepare_master_verifykey() {
+  if (master_verifykey_prepared && !memcmp(master_verifykey.key, eeprom.master_publicsignkey, sizeof(master_verifykey.key)))
+    return;
+  Ed25519::prepareVerifyKey(master_verifykey, eeprom.master_publicsignkey);
+  master_verifykey_prepared = true;
+}
+
+static bool verify_inbound(crypto_job_t * job) {
+  if (inbound.n == 1)
+    return Ed25519::verify(inbound.sigs[0], master_verifykey, inbound.msgs[0], inbound.lens[0]);
+  return Ed25519::verifyBatch(inbound.sigs, inbound.keys, inbound.msgs, inbound.lens, inbound.n);
+}
+
+static void verified_inbound(crypto_job_t * job) {
+  inbound.busy = false;
+  if (!job->ok) {
+    if (inbound.n > 1)
+      sigBatchesFailed++;
+    return;
+  };
+  for (size_t i = 0; i < inbound.n; i++)
+    inbound.reqs[i]->sigVerified = true;
+  if (inbound.n > 1) {
+    sigBatches++;
+    sigBatched += inbound.n;
+  };
+}
+
+void SIG2::verify_batch(ACRequest ** reqs, size_t n) {
+  size_t m = 0;
+
+  if (!(eeprom.flags & CRYPTO_HAS_MASTER_TOFU) || inbound.busy)
+    return;
+
+  for (size_t i = 0; i < n && m < VERIFY_BATCH_MAX; i++) {
+    ACRequest * req = reqs[i];
+    size_t len = strlen(req->payload());
+    if (req->topicId != ACNode::TOPIC_FROM_MASTER && req->topicId != ACNode::TOPIC_MASTER_BCAST)
+      continue;
+    if (len < 72 || len > MAX_MSG - 1 || strncmp(req->payload(), "SIG/2.", 6) != 0)
+      continue;
+
+    // Split exactly as verify() does; the signed part is what it verifies.
+    char tmp[len + 1];
+    strcpy(tmp, req->payload());
+    char * p = tmp;
+    if (!strsepspace(&p))
+      continue;
+    char * signature64 = strsepspace(&p);
+    if (!signature64 || decode_base64_length((unsigned char *)signature64) != ED59919_SIGLEN)
+      continue;
+    while (p && *p == ' ') p++;
+    if (!p)
+      continue;
+    if (replay_check(req->topicId, strtoul(p, NULL, 10), hash(p)) != REPLAY_NEW)
+      continue;
+
+    decode_base64((unsigned char *)signature64, inbound.signatures[m]);
+    inbound.sigs[m] = inbound.signatures[m];
+    inbound.keys[m] = eeprom.master_publicsignkey;
+    inbound.msgs[m] = req->payload() + (p - tmp);
+    inbound.lens[m] = strlen(req->payload() + (p - tmp));
+    inbound.reqs[m++] = req;
+  };
+  inbound.n = m;
+  if (m == 0)
+    return;
+
+  if (m == 1)
+    prepare_master_verifykey();
+  inbound.job.work = verify_inbound;
+  inbound.job.done = verified_inbound;
+  if (cryptoSubmit(&inbound.job)) {
+    inbound.busy = true;
+    return;
+  };
+
+  // Inline; a lone one is left to verify().
+  if (m < 2)
+    return;
+  resetWatchdog();
+  inbound.job.ok = verify_inbound(&inbound.job);
+  verified_inbound(&inbound.job);
+}
+
+bool SIG2::verifying() {
+  return inbound.busy;
+}
+
+// SIG/3.0 <base64 HMAC> <beat> <cmd> ..; only from the master, only on
+// its topic for us and only once it agreed to SIG/3 in a signed welcome.
+//
+ACSecurityHandler::acauth_result_t SIG2::verify_mac(ACRequest * req) {
+  if (req->topicId != ACNode::TOPIC_FROM_MASTER || !mac_agreed || !session_valid) {
+    Log.println("SIG/3 message without an agreed session - rejecting.");
+    return ACSecurityHandler::FAIL;
+  };
+
+  char tmp[strlen(req->payload()) + 1];
+  strcpy(tmp, req->payload());
+  char * p = tmp;
+
+  SEP(version, "SIG3Verify failed - no version", ACSecurityHandler::FAIL);
+  if (!req->set_version(version))
+    return ACSecurityHandler::FAIL;
+
+  SEP(mac64, "SIG3Verify failed - no mac", ACSecurityHandler::FAIL);
+
+  while (p && *p == ' ') p++;
+  if (!p || !req->set_rest(req->payload() + (p - tmp)))
+    return ACSecurityHandler::FAIL;
+
+  beat_t sent = strtoul(req->rest(), NULL, 10);
+  unsigned long fp = hash(req->rest());
+  if (replay_drop(replay_check(req->topicId, sent, fp), sent))
+    return ACSecurityHandler::FAIL;
+
+  uint8_t mac[HASH_LENGTH], expected[HASH_LENGTH];
+  B64DE(mac64, mac, "SIG/3 mac", ACSecurityHandler::FAIL);
+  session_mac(mac_from_master, req->rest(), expected);
+  if (!secure_compare(mac, expected, sizeof(mac))) {
+    Log.println("Invalid SIG/3 mac on message - rejecting.");
+    return ACSecurityHandler::FAIL;
+  };
+
+  SEP(beat, "SIG3Verify failed - no beat", ACSecurityHandler::FAIL);
+  if (!req->set_beat(beat))
+    return ACSecurityHandler::FAIL;
+
+  SEP(cmd, "SIG3Verify failed - no command", ACSecurityHandler::FAIL);
+  if (!req->set_cmd(cmd, _min((size_t)MAX_TOKEN_LEN - 1, strlen(cmd))))
+    return ACSecurityHandler::FAIL;
+
+  // Anything that (re)keys has to be signed.
+  if (!strcmp(req->cmd(), "welcome") || !strcmp(req->cmd(), "announce") || !strcmp(req->cmd(), "trust")) {
+    Log.printf("Refusing a %s with just a SIG/3 mac.\n", req->cmd());
+    return ACSecurityHandler::FAIL;
+  };
+
+  req->beatExtracted = strtoul(req->beat(), NULL, 10);
+  if (req->beatExtracted == 0 || beat_absdelta(req->beatExtracted, beatCounter) >= 1200) {
+    Log.printf("Beat is too far off (%lu) - rejecting SIG/3 message\n", beat_absdelta(req->beatExtracted, beatCounter));
+    return ACSecurityHandler::FAIL;
+  };
+  macVerified++;
+  acauth_result_t r = Beat::verify(req);
+  if (r == ACSecurityHandler::OK)
+    replay_accept(req->topicId, sent, fp);
+  return r;
+}
+
+static bool add_signature(ACRequest * req, uint8_t signature[ED59919_SIGLEN]) {
+  char sigb64[ED59919_SIGLEN * 2]; // plenty for an HMAC and for a 64 byte signature.
+  encode_base64(signature, ED59919_SIGLEN, (unsigned char *)sigb64);
+
+  char prefix[sizeof(sigb64) + 16];
+  snprintf(prefix, sizeof(prefix), "%s %s ", "SIG/2.0", sigb64);
+
+  return req->prepend_payload(prefix) && req->set_version("SIG/2.0");
+}
+
+// Signing an outbound message on the crypto worker. It gets copies of
+// the keys; the request is left alone by mqttLoop() until done.
+//
+typedef struct {
+  crypto_job_t job;
+  ACRequest * req;
+  uint8_t privatesign[CURVE259919_KEYLEN], publicsign[CURVE259919_KEYLEN];
+  uint8_t signature[ED59919_SIGLEN];
+} sign_job_t;
+
+static bool sign_outbound(crypto_job_t * job) {
+  sign_job_t * j = (sign_job_t *) job;
+  Ed25519::sign(j->signature, j->privatesign, j->publicsign, j->req->payload(), strlen(j->req->payload()));
+  return true;
+}
+
+static void signed_outbound(crypto_job_t * job) {
+  sign_job_t * j = (sign_job_t *) job;
+  j->req->secureFailed = !j->job.ok || !add_signature(j->req, j->signature);
+  j->req->securing = false;
+  memset(j->privatesign, 0, sizeof(j->privatesign));
+  delete j;
+}
+
 SIG2::acauth_result_t SIG2::secure(ACRequest * req) {
   acauth_result_t r = Beat::secure(req);
   if (r == FAIL || r == OK)
@@ -456,25 +1157,139 @@ SIG2::acauth_result_t SIG2::secure(ACRequest * req) {
   if (!sig2_active())
     return FAIL;
 
-  uint8_t signature[ED59919_SIGLEN];
+  // Steady state to the master; anything that (re)keys stays signed.
+  const char * cmd = index(req->payload(), ' ');
+  bool handshake = !cmd || !strncmp(cmd + 1, "announce", 8) || !strncmp(cmd + 1, "pubkey", 6);
+  if (mac_agreed && session_valid && !handshake && !strcmp(req->topic(), _acnode->topic(ACNode::TOPIC_TO_MASTER))) {
+    uint8_t mac[HASH_LENGTH];
+    char macb64[B64L(HASH_LENGTH)];
+    session_mac(mac_to_master, req->payload(), mac);
+    encode_base64(mac, sizeof(mac), (unsigned char *)macb64);
+
+    char prefix[sizeof(macb64) + 16];
+    snprintf(prefix, sizeof(prefix), "%s %s ", SIG3_VERSION, macb64);
+    if (!req->prepend_payload(prefix) || !req->set_version(SIG3_VERSION))
+      return FAIL;
+    macSent++;
+    return OK;
+  };
 
-  resetWatchdog();
-  Ed25519::sign(signature, eeprom.node_privatesign, node_publicsign, req->payload, strlen(req->payload));
+  // On the crypto worker if there is one; see signed_outbound().
+  sign_job_t * job = new sign_job_t;
+  if (job) {
+    job->job.work = sign_outbound;
+    job->job.done = signed_outbound;
+    job->req = req;
+    memcpy(job->privatesign, eeprom.node_privatesign, sizeof(job->privatesign));
+    memcpy(job->publicsign, node_publicsign, sizeof(job->publicsign));
+    if (cryptoSubmit(&job->job)) {
+      req->securing = true;
+      return PENDING;
+    };
+    memset(job->privatesign, 0, sizeof(job->privatesign));
+    delete job;
+  };
 
-  char sigb64[ED59919_SIGLEN * 2]; // plenty for an HMAC and for a 64 byte signature.
-  encode_base64(signature, sizeof(signature), (unsigned char *)sigb64);
+  uint8_t signature[ED59919_SIGLEN];
 
-  strncpy(req->version, "SIG/2.0", sizeof(req->version));
-  snprintf(req->tmp, sizeof(req->tmp), "%s %s %s", req->version, sigb64, req->payload);
+  resetWatchdog();
+  Ed25519::sign(signature, eeprom.node_privatesign, node_publicsign, req->payload(), strlen(req->payload()));
 
-  strncpy(req->payload, req->tmp, sizeof(req->payload));
+  if (!add_signature(req, signature))
+    return FAIL;
   return OK;
 };
 
+#define CLOAK_NONCE_LEN (12)
+#define CLOAK_TAG_LEN (16)
+
+// SIG/3 masters get the tag as ccp.<base64 of nonce, ciphertext and the
+// Poly1305 tag>; ChaCha20-Poly1305 under a key derived from the session
+// key. The nonce is our beat and 8 random bytes; the context (the request
+// the cloaked tag goes into) and that beat are the additional authenticated
+// data. The master checks the beat against that of the request.
+//
+static SIG2::acauth_result_t cloak_aead(ACRequest * req) {
+  ChaChaPoly cipher;
+  size_t len = strlen(req->tag());
+  uint8_t buff[CLOAK_NONCE_LEN + len + CLOAK_TAG_LEN];
+  uint8_t * nonce = buff, * output = buff + CLOAK_NONCE_LEN;
+
+  beat_t beat = beatCounter;
+  for (int i = 0; i < 4; i++)
+    nonce[i] = (beat >> (24 - 8 * i)) & 0xFF;
+  RNG.rand(nonce + 4, CLOAK_NONCE_LEN - 4);
+
+  if (!cipher.setKey(cloak_key, sizeof(cloak_key)) || !cipher.setIV(nonce, CLOAK_NONCE_LEN)) {
+    Log.println("FAIL setting up the cloak");
+    return SIG2::FAIL;
+  };
+  char aad[MAX_MSG];
+  snprintf(aad, sizeof(aad), "%s %lu", req->payload(), (unsigned long)(beat & 0xFFFFFFFF));
+  cipher.addAuthData(aad, strlen(aad));
+  cipher.encrypt(output, (const uint8_t *)req->tag(), len);
+  cipher.computeTag(output + len, CLOAK_TAG_LEN);
+  cipher.clear();
+
+  char cloaked[4 + B64L(sizeof(buff))];
+  strcpy(cloaked, "ccp.");
+  encode_base64(buff, sizeof(buff), (unsigned char *)cloaked + 4);
+
+  if (!req->set_tag(cloaked))
+    return SIG2::FAIL;
+  return SIG2::OK;
+}
+
+// The tag as the first 64 bits of its HMAC-SHA256 under the audit key;
+// in hex. The master, having the tags and our audit key, can tell which
+// one it was. Nobody else can; unlike with its (cache) hash.
+//
+SIG2::acauth_result_t SIG2::tag_mac(ACRequest * req) {
+  if (!sig2_active() || !derive_audit_key())
+    return ACSecurityHandler::DECLINE;
+
+  uint8_t mac[8];
+  SHA256 sha256;
+  sha256.resetHMAC(audit_key, sizeof(audit_key));
+  sha256.update("audit ", 6);
+  sha256.update(req->tag(), strlen(req->tag()));
+  sha256.finalizeHMAC(audit_key, sizeof(audit_key), mac, sizeof(mac));
+
+  char hex[2 * sizeof(mac) + 1];
+  for (size_t i = 0; i < sizeof(mac); i++)
+    snprintf(hex + 2 * i, 3, "%02x", mac[i]);
+  if (!req->set_tag(hex))
+    return ACSecurityHandler::FAIL;
+  return ACSecurityHandler::OK;
+}
+
+// Sent as an approval request would be; so the master uncloaks it the
+// same way. Once per session; the master may have lost it or be new.
+//
+void SIG2::send_audit_key() {
+  audit_key_due = false;
+  if (!derive_audit_key())
+    return;
+
+  char key[MAX_MSG], context[16 + MAX_NAME], payload[MAX_MSG];
+  encode_base64(audit_key, sizeof(audit_key), (unsigned char *)key);
+  snprintf(context, sizeof(context), "auditkey %s audit", _acnode->moi);
+  if (!_acnode->cloak(key, context)) {
+    Log.println("Could not cloak the audit key - not sent.");
+    return;
+  };
+  snprintf(payload, sizeof(payload), "%s %s", context, key);
+  _acnode->send(payload);
+}
+
 SIG2::acauth_result_t SIG2::cloak(ACRequest * req) {
   if (!sig2_active())
     return ACSecurityHandler::FAIL;
 
+  // Masters that do not speak SIG/3 only know the CBC cloak.
+  if (mac_agreed && session_valid)
+    return cloak_aead(req);
+
   CBC<AES256> cipher;
 
   uint8_t iv[16];
@@ -494,13 +1309,13 @@ SIG2::acauth_result_t SIG2::cloak(ACRequest * req) {
   // https://www.ietf.org/rfc/rfc2315.txt
   // -- section 10.3, page 21 Note 2.
   //
-  size_t len = strlen(req->tag);
+  size_t len = strlen(req->tag());
   int pad = 16 - (len % 16); // cipher.blockSize();
   if (pad == 0) pad = 16; //cipher.blockSize();
 
   size_t paddedlen = len + pad;
   uint8_t input[ paddedlen ], output[ paddedlen ], output_b64[ paddedlen * 4 / 3 + 4  ], iv_b64[ 32 ];
-  strcpy((char *)input, req->tag);
+  strcpy((char *)input, req->tag());
 
 
   for (int i = 0; i < pad; i++)
@@ -523,24 +1338,28 @@ SIG2::acauth_result_t SIG2::cloak(ACRequest * req) {
   Serial.print("Cypher="); Serial.println((char *)output_b64);
 #endif
   
-  snprintf(req->tag, sizeof(req->tag), "%s.%s", iv_b64, output_b64);
+  char cloaked[ sizeof(iv_b64) + 1 + sizeof(output_b64) ];
+  snprintf(cloaked, sizeof(cloaked), "%s.%s", iv_b64, output_b64);
   
+  if (!req->set_tag(cloaked))
+    return FAIL;
   return OK;
 };
 
 SIG2::cmd_result_t SIG2::handle_cmd(ACRequest * req)
 {
-  if (!strncmp("welcome", req->cmd, 7)) {
+  if (!strncmp("welcome", req->cmd(), 7)) {
     return CMD_CLAIMED;
   }
-  if (!strncmp("announce", req->cmd, 8)) {
+  if (!strncmp("announce", req->cmd(), 8)) {
     /// I think we can drop this one.
     _acnode->send_helo();
     return CMD_CLAIMED;
   }
-  if (!strncmp("trust", req->cmd, 5)) {
-	strncpy(req->tmp, req->rest, sizeof(req->tmp));
-	char * p = req->tmp;
+  if (!strncmp("trust", req->cmd(), 5)) {
+	char tmp[strlen(req->rest()) + 1];
+	strcpy(tmp, req->rest());
+	char * p = tmp;
 
         SEP(nonce , "Trust failed - no nonce", CMD_CLAIMED);
         SEP(node, "Trust failed - no node name", CMD_CLAIMED);
@@ -558,9 +1377,8 @@ SIG2::cmd_result_t SIG2::handle_cmd(ACRequest * req)
 
         // Is this a node name we are interested in ?
 	//
-        int i  = 0;
-        for(i = 0; i < nTrusted; i++) if (!strcmp(node, trust[ i ].node)) break;
-	if (i == nTrusted) {
+        int i = find_trusted(node);
+	if (i < 0) {
 		Log.println("Trust failed - not a node we'er interested in.");
 		return CMD_CLAIMED;
 	};
@@ -570,14 +1388,21 @@ SIG2::cmd_result_t SIG2::handle_cmd(ACRequest * req)
         snprintf(seed,sizeof(seed),"%lu-%s",trust[i].requested,trust[i].node);
         populate_nonce(seed, mynonce); 
 
-        if (strcmp(nonce,mynonce)) {
+        if (!nonce_equal(nonce,mynonce)) {
 		Log.println("Trust failed - not my (last) nonce");
 		return CMD_CLAIMED;
 	}
 
-        B64DE(b64pubkey, trust[ i].pubkey, "Trust failed - key decode", CMD_CLAIMED);
+        uint8_t pubkey[CURVE259919_KEYLEN];
+        B64DE(b64pubkey, pubkey, "Trust failed - key decode", CMD_CLAIMED);
 
-        Log.printf("Got trust in <%s> - public key stored.\n", node);
+        bool changed = !trust[i].haveKey || memcmp(pubkey, trust[i].pubkey, sizeof(pubkey));
+        memcpy(trust[i].pubkey, pubkey, sizeof(pubkey));
+        trust[i].haveKey = true;
+        trust[i].validated = beatCounter;
+        save_trust();
+
+        Log.printf("Got trust in <%s> - public key %s.\n", node, changed ? "stored" : "unchanged");
 
 	// Update the timer - so block some sort of reply.
 	//
@@ -589,6 +1414,8 @@ SIG2::cmd_result_t SIG2::handle_cmd(ACRequest * req)
 }
 
 void SIG2::add_trusted_node(const char *node) {
+        if (find_trusted(node) >= 0)
+		return;
         if (nTrusted >= MAX_TRUST_N) {
         	Log.println("Hit hardcoded limit on number of nodes I can trust.");
 		return;
@@ -599,11 +1426,28 @@ void SIG2::add_trusted_node(const char *node) {
 	};
         strncpy(trust[ nTrusted ].node, node, sizeof(trust[ nTrusted ].node));
 	bzero(trust[nTrusted].pubkey,sizeof(trust[nTrusted].pubkey));
+	trust[nTrusted].haveKey = false;
+	trust[nTrusted].requested = 0;
+	trust[nTrusted].topic_id = ACNode::TOPIC_UNKNOWN;
+	trust[nTrusted].hash = hash(node);
 
-        if (init_done > 4)
-		request_trust(nTrusted);
+	unsigned int b = trust[nTrusted].hash % (2 * MAX_TRUST_N);
+	while (trust_bucket[b])
+		b = (b + 1) % (2 * MAX_TRUST_N);
+	trust_bucket[b] = nTrusted + 1;
 
 	nTrusted++;
+
+        if (init_done > 4) {
+		subscribe_trusted(nTrusted - 1);
+		request_trust(nTrusted - 1);
+	};
+}
+
+void SIG2::lazy_request_trust(int i) {
+	if (init_done < 5 || (trust[i].requested && millis() - trust[i].requested < TRUST_REREQUEST_MIN))
+		return;
+	request_trust(i);
 }
 
 void SIG2::request_trust(int i) {
@@ -619,63 +1463,85 @@ void SIG2::request_trust(int i) {
 
 	Debug.printf("Requesting trust for <%s>\n", trust[i].node);
     	_acnode->send(payload);
+	trustRequests++;
+};
 
+void SIG2::subscribe_trusted(int i) {
         char topic[MAX_TOPIC];
         snprintf(topic, sizeof(topic), "%s/%s/%s", 
 		_acnode->mqtt_topic_prefix, _acnode->moi, trust[i].node);
+        trust[i].topic_id = _acnode->intern_topic(topic);
+        if (trust[i].topic_id >= 0 && trust[i].topic_id < MAX_INTERNED_TOPICS)
+		trust_by_topic[ trust[i].topic_id ] = i + 1;
         _acnode->_client.subscribe(topic);
 	Debug.printf("Subscribing to %s for the trusted messages.>\n", topic);
 };
 
 SIG2::acauth_result_t SIG2::helo(ACRequest * req) {
   if (!sig2_active()) {
-    Debug.printf("Not sending %s from _send_helo() - not yet active.\n", req->payload);
+    Debug.printf("Not sending %s from _send_helo() - not yet active.\n", req->payload());
     return ACSecurityHandler::DECLINE;
   };
 
   IPAddress myIp = _acnode->localIP();
   char buff[MAX_TOKEN_LEN * 2];
-  snprintf(buff, sizeof(buff), "%s %d.%d.%d.%d", req->payload, myIp[0], myIp[1], myIp[2], myIp[3]);
+  size_t at = snprintf(buff, sizeof(buff), "%s %d.%d.%d.%d", req->payload(), myIp[0], myIp[1], myIp[2], myIp[3]);
 
   char b64[128];
 
   // Add ED25519 signing/non-repudiation key
   //
-  strncat(buff, " ", sizeof(buff));
   encode_base64((unsigned char *)node_publicsign, sizeof(node_publicsign), (unsigned char *)b64);
-  strncat(buff, b64, sizeof(buff));
+  if (at < sizeof(buff))
+    at += snprintf(buff + at, sizeof(buff) - at, " %s", b64);
 
   // Add Curve25519 session/confidentiality key
   //
-  strncat(buff, " ", sizeof(buff));
   encode_base64((unsigned char *)(node_publicsession), sizeof(node_publicsession), (unsigned char *)b64);
-  strncat(buff, b64, sizeof(buff));
+  if (at < sizeof(buff))
+    at += snprintf(buff + at, sizeof(buff) - at, " %s", b64);
 
   // Add a nonce - so we can time-point the reply.
   //
   populate_nonce(NULL,_nonce);
 
-  strncat(buff, " ", sizeof(buff));
-  strncat(buff, _nonce, sizeof(buff));
+  if (at < sizeof(buff))
+    at += snprintf(buff + at, sizeof(buff) - at, " %s", _nonce);
+
+  // Masters that do not know SIG/3 ignore the extra field.
+  if (_session_mac && at < sizeof(buff))
+    at += snprintf(buff + at, sizeof(buff) - at, " %s", SIG3_VERSION);
 
-  strncpy(req->payload, buff, sizeof(req->payload));
+  if (at >= sizeof(buff)) {
+    Log.println("Helo too long - not sent.");
+    return FAIL;
+  };
+
+  if (!req->set_payload(buff))
+    return FAIL;
   return OK;
 }
 
+// Keyed BLAKE2s in counter mode; the key (runtime_seed) is drawn from the
+// RNG once per boot. So no RNG draw, nor hashing of the public keys, per
+// nonce; and still unpredictable without the key. With a seed the nonce
+// follows from just that; so a reply can be checked by recomputing it.
+//
+static uint64_t nonce_counter = 0;
+
 void SIG2::populate_nonce(const char * seedOrNull, char nonce[B64L(HASH_LENGTH)]) {
   uint8_t nonce_raw[ HASH_LENGTH ];
-  SHA256 sha256;
-  sha256.reset();
-  sha256.update(runtime_seed, sizeof(runtime_seed));
-  sha256.update(node_publicsign, sizeof(node_publicsign));
-  sha256.update(node_publicsession, sizeof(node_publicsession));
-  if (seedOrNull)
-	sha256.update(seedOrNull, strlen(seedOrNull));
-  else {
-	RNG.rand(nonce_raw, sizeof(nonce_raw));
-  	sha256.update(nonce_raw, sizeof(nonce_raw));
+  BLAKE2s blake2s;
+  blake2s.reset(runtime_seed, sizeof(runtime_seed), sizeof(nonce_raw));
+  if (seedOrNull) {
+	blake2s.update("s", 1);
+	blake2s.update(seedOrNull, strlen(seedOrNull));
+  } else {
+	nonce_counter++;
+	blake2s.update("c", 1);
+	blake2s.update(&nonce_counter, sizeof(nonce_counter));
   };
-  sha256.finalize(nonce_raw, sizeof(nonce_raw));
+  blake2s.finalize(nonce_raw, sizeof(nonce_raw));
 
   // We know that this fits - see header of SIG2.h
   //
@@ -12,18 +12,35 @@ public:
     void loop();
     
     cmd_result_t    handle_cmd(ACRequest * req);
+    const char * const * commands() { 
+        static const char * const cmds[] = { "welcome", "announce", "trust", "beat", NULL };
+        return cmds;
+    };
 
     acauth_result_t helo(ACRequest * req);
     acauth_result_t verify(ACRequest * req);
+    void verify_batch(ACRequest ** reqs, size_t n);
+    bool verifying();
     acauth_result_t secure(ACRequest * req);
     acauth_result_t cloak(ACRequest * req);
+    acauth_result_t tag_mac(ACRequest * req);
 
     void add_trusted_node(const char *node);
 
+    // SIG/3; once the master agrees in its welcome, steady state messages
+    // to and from it carry an HMAC under the session key rather than an
+    // Ed25519 signature. Handshakes and broadcasts stay SIG/2.
+    void set_session_mac(bool mac) { _session_mac = mac; };
+
 private:
+    bool _session_mac = false;
     char _nonce[B64L(HASH_LENGTH)];
+    acauth_result_t verify_mac(ACRequest * req);
     void populate_nonce(const char * seedOrNull, char nonce[B64L(HASH_LENGTH)]);
     void request_trust(int i);
+    void lazy_request_trust(int i);
+    void subscribe_trusted(int i);
+    void send_audit_key();
 };
 
 extern void wipe_eeprom();
@@ -0,0 +1,149 @@
+#include <Scheduler.h>
+#include <Profile.h>
+
+#define _slot(ms) (((ms) >> SCHED_TICK_SHIFT) % SCHED_WHEEL_SLOTS)
+
+ACScheduler::ACScheduler() : late_max(0), late_total(0), runs(0) {
+    for (int i = 0; i < MAX_SCHED_TASKS; i++) {
+        _tasks[i].used = _tasks[i].queued = false;
+        _tasks[i].next = -1;
+    };
+    for (int i = 0; i < SCHED_WHEEL_SLOTS; i++)
+        _wheel[i] = -1;
+    _tick = millis() >> SCHED_TICK_SHIFT;
+}
+
+int ACScheduler::_add(const char * name, unsigned long delay, unsigned long period, THandlerFunction_Task fn) {
+    for (int i = 0; i < MAX_SCHED_TASKS; i++) {
+        if (_tasks[i].used)
+            continue;
+        _tasks[i].name = name;
+        _tasks[i].fn = fn;
+        _tasks[i].period = period;
+        _tasks[i].due = millis() + delay;
+        _tasks[i].profile = profileSlot(name);
+        _tasks[i].used = true;
+        _insert(i);
+        return i;
+    };
+    return -1;
+}
+
+int ACScheduler::every(const char * name, unsigned long period, THandlerFunction_Task fn) {
+    return _add(name, period, period, fn);
+}
+
+int ACScheduler::after(const char * name, unsigned long delay, THandlerFunction_Task fn) {
+    return _add(name, delay, 0, fn);
+}
+
+void ACScheduler::_insert(int id) {
+    int s = _slot(_tasks[id].due);
+    _tasks[id].next = _wheel[s];
+    _tasks[id].queued = true;
+    _wheel[s] = id;
+}
+
+void ACScheduler::_unlink(int id) {
+    if (!_tasks[id].queued)
+        return;
+    for (int8_t * p = &_wheel[_slot(_tasks[id].due)]; *p != -1; p = &_tasks[*p].next) {
+        if (*p == id) {
+            *p = _tasks[id].next;
+            break;
+        };
+    };
+    _tasks[id].next = -1;
+    _tasks[id].queued = false;
+}
+
+void ACScheduler::cancel(int id) {
+    if (id < 0 || id >= MAX_SCHED_TASKS || !_tasks[id].used)
+        return;
+    _unlink(id);
+    _tasks[id].used = false;
+    _tasks[id].fn = NULL;
+}
+
+void ACScheduler::reschedule(int id, unsigned long in) {
+    if (id < 0 || id >= MAX_SCHED_TASKS || !_tasks[id].used)
+        return;
+    _unlink(id);
+    _tasks[id].due = millis() + in;
+    _insert(id);
+}
+
+void ACScheduler::set_period(int id, unsigned long period) {
+    if (id < 0 || id >= MAX_SCHED_TASKS || !_tasks[id].used)
+        return;
+    _tasks[id].period = period;
+    reschedule(id, period);
+}
+
+void ACScheduler::loop() {
+    unsigned long now = millis();
+    unsigned long tick = now >> SCHED_TICK_SHIFT;
+
+    // Walk every slot that passed since the last call (and the current
+    // one again); but at most one full revolution if we fell behind.
+    unsigned long n = tick - _tick + 1;
+    if (n > SCHED_WHEEL_SLOTS)
+        n = SCHED_WHEEL_SLOTS;
+
+    for (unsigned long t = tick - n + 1; n--; t++) {
+        int8_t * p = &_wheel[t % SCHED_WHEEL_SLOTS];
+        while (*p != -1) {
+            int id = *p;
+            task_t * task = &_tasks[id];
+
+            // Belongs to a later revolution of the wheel.
+            if ((long)(now - task->due) < 0) {
+                p = &task->next;
+                continue;
+            };
+            *p = task->next;
+            task->next = -1;
+            task->queued = false;
+
+            unsigned long late = now - task->due;
+            if (late > late_max) late_max = late;
+            late_total += late;
+            runs++;
+
+            {
+                ProfileScope ps(task->profile);
+                task->fn();
+            }
+
+            // The task may have cancelled or rescheduled itself.
+            if (!task->used || task->queued)
+                continue;
+            if (task->period == 0) {
+                task->used = false;
+                task->fn = NULL;
+                continue;
+            };
+            // Keep the rate; unless we are so far behind that we would
+            // just run it again straight away.
+            task->due += task->period;
+            if ((long)(now - task->due) >= 0)
+                task->due = now + task->period;
+            _insert(id);
+        };
+    };
+    _tick = tick;
+}
+
+unsigned long ACScheduler::next_due() {
+    unsigned long now = millis(), best = ~0UL;
+    for (int i = 0; i < MAX_SCHED_TASKS; i++) {
+        if (!_tasks[i].used || !_tasks[i].queued)
+            continue;
+        long d = (long)(_tasks[i].due - now);
+        if (d <= 0)
+            return 0;
+        if ((unsigned long) d < best)
+            best = d;
+    };
+    return best;
+}
@@ -0,0 +1,60 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <functional>
+#include <Arduino.h>
+
+// Small hashed timer wheel for periodic and one-shot tasks; so loop()
+// only looks at the slots that came due since the last call rather than
+// at every timer. Tasks are timed in the loop profiler by their name.
+//
+//    _acnode->every("ping", 3000, [this]() { send(NULL, "ping"); });
+//
+#ifndef MAX_SCHED_TASKS
+#define MAX_SCHED_TASKS (24)
+#endif
+
+// A power of two; so the slot index stays continuous as millis() wraps.
+#define SCHED_TICK_SHIFT (3)            // 8 mSecond granularity.
+#define SCHED_WHEEL_SLOTS (64)          // About half a second per revolution.
+
+class ACScheduler {
+public:
+    typedef std::function<void(void)> THandlerFunction_Task;
+
+    ACScheduler();
+
+    // Returns a task id; or -1 when full.
+    int every(const char * name, unsigned long period, THandlerFunction_Task fn);
+    int after(const char * name, unsigned long delay, THandlerFunction_Task fn);
+    void cancel(int id);
+    // Run the task 'in' mSeconds from now (0 is the next loop); periodic
+    // tasks continue at their normal rate from there.
+    void reschedule(int id, unsigned long in);
+    void set_period(int id, unsigned long period);
+
+    void loop();
+    // mSeconds until the next task is due; ~0UL when there is none.
+    unsigned long next_due();
+
+    // How late tasks ran compared to their deadline; in mSeconds.
+    unsigned long late_max, late_total, runs;
+
+private:
+    typedef struct {
+        const char * name;
+        THandlerFunction_Task fn;
+        unsigned long due, period;
+        int profile;
+        int8_t next;
+        bool used, queued;
+    } task_t;
+    task_t _tasks[MAX_SCHED_TASKS];
+    int8_t _wheel[SCHED_WHEEL_SLOTS];
+    unsigned long _tick;
+
+    int _add(const char * name, unsigned long delay, unsigned long period, THandlerFunction_Task fn);
+    void _insert(int id);
+    void _unlink(int id);
+};
+#endif
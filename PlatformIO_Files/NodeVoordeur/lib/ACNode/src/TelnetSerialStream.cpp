@@ -8,10 +8,10 @@
 #include <ACNode-private.h>
 #include "TelnetSerialStream.h"
 
+// Called for every byte logged; so only look at our own state here.
+//
 size_t TelnetSerialStream::write(uint8_t c) {
-	if (!_acnode->isConnected())
-		return 1;
-  	if (!_server)
+	if (!_up || !_nClients)
 		return 1;
 	for (int i = 0; i < MAX_SERIAL_TELNET_CLIENTS; i++) {
       		if (_serverClients[i] && _serverClients[i].connected()) {
@@ -42,13 +42,26 @@ void TelnetSerialStream::stop() {
   _server->stop();
 }
 
-void TelnetSerialStream::loop() {
-  if (!_acnode->isConnected()) 
+void TelnetSerialStream::link_changed(bool up) {
+  _up = up;
+  if (up)
 	return;
+  // Sockets do not survive the link going away.
+  for (int i = 0; i < MAX_SERIAL_TELNET_CLIENTS; i++) 
+    if (_serverClients[i])
+      _serverClients[i].stop();
+  _nClients = 0;
+}
 
-  if (!_server)
+void TelnetSerialStream::loop() {
+  if (!_up || !_server) 
 	return;
 
+  _nClients = 0;
+  for (int i = 0; i < MAX_SERIAL_TELNET_CLIENTS; i++) 
+    if (_serverClients[i] && _serverClients[i].connected())
+      _nClients++;
+
   if (_server->hasClient()) {
     int i;
     for (i = 0; i < MAX_SERIAL_TELNET_CLIENTS; i++) {
@@ -57,6 +70,7 @@ void TelnetSerialStream::loop() {
         if (_serverClients[i]) 
 		_serverClients[i].stop();
         _serverClients[i] = _server->available();
+        _nClients++;
 	if (_acnode && _acnode->moi)
           _serverClients[i].print(_acnode->moi);
         _serverClients[i].print(" Serial connected ");
@@ -16,9 +16,12 @@ class TelnetSerialStream : public ACLog {
     virtual void begin();
     virtual void loop();
     virtual void stop();
+    virtual void link_changed(bool up);
 
   private:
     uint16_t _telnetPort;
+    bool _up = false;
+    int _nClients = 0;
     WiFiServer * _server = NULL;
     WiFiClient _serverClients[MAX_SERIAL_TELNET_CLIENTS];
   protected:
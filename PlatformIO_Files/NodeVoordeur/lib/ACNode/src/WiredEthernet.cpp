@@ -1,12 +1,17 @@
 #include <ACNode-private.h>
 
 #ifdef ESP32
-static bool _connected = false;
+std::atomic<bool> link_up(false);
+std::atomic<unsigned int> link_generation(0);
 
-bool eth_connected () {
-	return _connected;
+static void set_link(bool up) {
+  if (link_up.exchange(up) != up)
+      link_generation++;
 }
 
+// Runs in the event task; not in loop(). So only flip the flag here and
+// leave the fan out to handlers to ACNode::loop().
+//
 void WiFiEvent(WiFiEvent_t event)
 {
   switch (event) {
@@ -35,29 +40,37 @@ void WiFiEvent(WiFiEvent_t event)
       Log.print(ETH.linkSpeed());
       Log.println("Mbps");
 
-      _connected = true;
+      set_link(true);
+      break;
+    case SYSTEM_EVENT_STA_CONNECTED:
+      Log.println("Wifi Connected");
+      break;
+    case SYSTEM_EVENT_STA_DISCONNECTED:
+    case SYSTEM_EVENT_STA_LOST_IP:
+      Log.println("Wifi Disconnected");
+      set_link(false);
       break;
     case SYSTEM_EVENT_ETH_DISCONNECTED:
       Log.println("ETH Disconnected");
-      _connected = false;
+      set_link(false);
       break;
     case SYSTEM_EVENT_ETH_STOP:
       Log.println("ETH Stopped");
-      _connected = false;
+      set_link(false);
       break;
     case SYSTEM_EVENT_AP_STADISCONNECTED:
       break;
     case SYSTEM_EVENT_AP_PROBEREQRECVED:
       break;
     case SYSTEM_EVENT_ACTION_TX_STATUS:
-      _connected = false;
+      set_link(false);
       break;
     case SYSTEM_EVENT_ROC_DONE:
-      _connected = true;
+      set_link(true);
       break;
     default:
+      // Scan done, auth mode changes, etc; these say nothing about the link.
       Log.printf("ETH unknown event %d (ignored)\n", event);
-      _connected = false;
       break;
   }
 }
@@ -5,7 +5,16 @@
 
 #ifdef ESP32
 #include <ETH.h>
-extern bool eth_connected();
+#include <atomic>
+
+// Link state as tracked by WiFiEvent(); for both the wired and the wifi
+// interface. Updated from the event task; so atomic. The generation is
+// bumped on every change so loop() can spot it with a single load.
+//
+extern std::atomic<bool> link_up;
+extern std::atomic<unsigned int> link_generation;
+
+inline bool eth_connected() { return link_up.load(std::memory_order_relaxed); }
 extern void WiFiEvent(WiFiEvent_t event);
 #endif
 
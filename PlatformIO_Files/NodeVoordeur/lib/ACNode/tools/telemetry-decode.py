@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Decode the binary (MessagePack) reports that an ACNode publishes on
+# PREFIX/telemetry/<node> when set_report_binary(true) is used; and print
+# them as one JSON line per report. Without dependencies; e.g.
+#
+#    mosquitto_sub -h broker -v -t 'ac/telemetry/#' -F '%t %x' | \
+#        ./telemetry-decode.py
+#
+# or on a raw payload saved to a file:
+#
+#    ./telemetry-decode.py report.bin
+#
+# With delta reports (set_report_delta()) only changed fields are sent;
+# --merge keeps the last known state per node and prints that instead.
+#
+import sys, json, struct, argparse
+
+def unpack(b, i = 0):
+    t = b[i]; i += 1
+    if t <= 0x7f: return t, i
+    if t >= 0xe0: return t - 0x100, i
+    if 0xa0 <= t <= 0xbf: n = t & 0x1f; return b[i:i+n].decode('utf-8', 'replace'), i + n
+    if 0x80 <= t <= 0x8f: return unpack_map(b, i, t & 0x0f)
+    if 0x90 <= t <= 0x9f: return unpack_array(b, i, t & 0x0f)
+    if t == 0xc0: return None, i
+    if t == 0xc2: return False, i
+    if t == 0xc3: return True, i
+    fixed = {
+        0xcc: '>B', 0xcd: '>H', 0xce: '>I', 0xcf: '>Q',
+        0xd0: '>b', 0xd1: '>h', 0xd2: '>i', 0xd3: '>q',
+        0xca: '>f', 0xcb: '>d',
+    }
+    if t in fixed:
+        f = fixed[t]; n = struct.calcsize(f)
+        v = struct.unpack(f, b[i:i+n])[0]
+        return (round(v, 2) if t == 0xca else v), i + n
+    if t in (0xd9, 0xda, 0xdb):
+        f = { 0xd9: '>B', 0xda: '>H', 0xdb: '>I' }[t]; n = struct.calcsize(f)
+        l = struct.unpack(f, b[i:i+n])[0]; i += n
+        return b[i:i+l].decode('utf-8', 'replace'), i + l
+    if t in (0xde, 0xdf):
+        f = '>H' if t == 0xde else '>I'; n = struct.calcsize(f)
+        return unpack_map(b, i + n, struct.unpack(f, b[i:i+n])[0])
+    if t in (0xdc, 0xdd):
+        f = '>H' if t == 0xdc else '>I'; n = struct.calcsize(f)
+        return unpack_array(b, i + n, struct.unpack(f, b[i:i+n])[0])
+    raise ValueError('Unsupported MessagePack type 0x%02x at offset %d' % (t, i - 1))
+
+def unpack_map(b, i, n):
+    d = {}
+    for _ in range(n):
+        k, i = unpack(b, i)
+        v, i = unpack(b, i)
+        d[k] = v
+    return d, i
+
+def unpack_array(b, i, n):
+    a = []
+    for _ in range(n):
+        v, i = unpack(b, i)
+        a.append(v)
+    return a, i
+
+def main():
+    p = argparse.ArgumentParser(description = 'Decode ACNode binary telemetry reports.')
+    p.add_argument('--merge', action = 'store_true', help = 'apply delta reports to the last known state per node')
+    p.add_argument('file', nargs = '?', help = 'raw payload; otherwise "<topic> <hex>" lines on stdin')
+    args = p.parse_args()
+
+    state = {}
+    def show(topic, payload):
+        try:
+            report, _ = unpack(payload)
+        except (ValueError, IndexError, struct.error) as e:
+            print('%s: %s' % (topic, e), file = sys.stderr)
+            return
+        if args.merge:
+            node = report.get('node', topic)
+            if report.get('full', True):
+                state[node] = {}
+            state.setdefault(node, {}).update(report)
+            report = state[node]
+        print(json.dumps({ 'topic': topic, 'report': report } if topic else report))
+        sys.stdout.flush()
+
+    if args.file:
+        with open(args.file, 'rb') as f:
+            show(None, f.read())
+        return
+
+    for line in sys.stdin:
+        parts = line.split()
+        if not parts:
+            continue
+        topic, hexed = (parts[0], parts[1]) if len(parts) > 1 else (None, parts[0])
+        try:
+            show(topic, bytes.fromhex(hexed))
+        except ValueError as e:
+            print('%s: %s' % (topic, e), file = sys.stderr)
+
+if __name__ == '__main__':
+    main()
@@ -26,6 +26,7 @@
 #include "RNG.h"
 #include "utility/LimbUtil.h"
 #include <string.h>
+#include <stdlib.h>
 
 /**
  * \class Ed25519 Ed25519.h <Ed25519.h>
@@ -111,6 +112,8 @@ static limb_t const numQ[NUM_LIMBS_256BIT] PROGMEM = {
     LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x10000000)
 };
 
+#include "Ed25519Comb.h"
+
 /** @endcond */
 
 /**
@@ -146,7 +149,7 @@ void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
     reduceQFromBuffer(r, buf, t);
 
     // Encode rB into the first half of the signature buffer as R.
-    mul(rB, r);
+    mulBase(rB, r);
     encodePoint(signature, rB);
 
     // Hash R, A, and the message to get k.
@@ -184,6 +187,10 @@ void Ed25519::sign(uint8_t signature[64], const uint8_t privateKey[32],
  * \return Returns true if the \a signature is valid for \a message;
  * or false if the \a signature is not valid.
  *
+ * The check is the cofactored one, 8 * s * B = 8 * R + 8 * k * A; so a
+ * signature with a small order component in R passes, as it does with
+ * verifyBatch().
+ *
  * \sa sign()
  */
 bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
@@ -194,6 +201,7 @@ bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
     Point R;
     Point sB;
     Point kA;
+    limb_t kr[NUM_LIMBS_256BIT];
     uint8_t *k = (uint8_t *)(hash.state.w); // Reuse hash buffer to save memory.
     bool result = false;
 
@@ -208,16 +216,16 @@ bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
 
         // Calculate s * B.  The s value is stored temporarily in kA.t.
         BigNumberUtil::unpackLE(kA.t, NUM_LIMBS_256BIT, signature + 32, 32);
-        mul(sB, kA.t, false);
+        mulBase(sB, kA.t);
 
-        // Calculate R + k * A.  We don't need sB.t in equal() below,
-        // so we reuse that as a temporary buffer when reducing k.
-        reduceQFromBuffer(sB.t, k, kA.x);
-        mul(kA, sB.t, A, false);
+        // Calculate R + k * A.  Not in sB.t; equalCofactor() needs it.
+        reduceQFromBuffer(kr, k, kA.x);
+        mul(kA, kr, A, false);
         add(R, kA);
 
-        // Compare s * B and R + k * A for equality.
-        result = equal(sB, R);
+        // Compare s * B and R + k * A for equality; up to a small order
+        // component, as verifyBatch() does.
+        result = equalCofactor(sB, R);
     }
 
     // Clean up and exit.
@@ -225,6 +233,305 @@ bool Ed25519::verify(const uint8_t signature[64], const uint8_t publicKey[32],
     clean(R);
     clean(sB);
     clean(kA);
+    clean(kr);
+    return result;
+}
+
+/**
+ * \brief Decodes a public key once for repeated verification.
+ *
+ * \param key The decoded key; with a table of multiples of the point.
+ * \param publicKey The public key to decode.
+ *
+ * \return Returns false if \a publicKey is not a valid curve point; in
+ * which case verify() will reject everything with \a key.
+ *
+ * Decoding a public key costs a square root; verify() with a prepared
+ * key skips that and does the two scalar multiplications together using
+ * the table.  Worthwhile when most messages come from the same signer.
+ *
+ * \sa verify()
+ */
+bool Ed25519::prepareVerifyKey(VerifyKey &key, const uint8_t publicKey[32])
+{
+    Point A;
+
+    key.valid = false;
+    memcpy(key.key, publicKey, 32);
+    if (!decodePoint(A, publicKey)) {
+        clean(A);
+        return false;
+    }
+
+    // Store -A; so that verify() can compute s * B - k * A in one go.
+    memset(A.z, 0, sizeof(A.z));
+    Curve25519::sub(A.x, A.z, A.x);
+    Curve25519::sub(A.t, A.z, A.t);
+    memcpy_P(A.z, numBz, sizeof(A.z));
+
+    fillTable(key.table, A);
+    key.valid = true;
+    clean(A);
+    return true;
+}
+
+/**
+ * \brief Verifies a signature using a prepared Ed25519 public key.
+ *
+ * \param signature The signature value to be verified.
+ * \param key The public key; as prepared by prepareVerifyKey().
+ * \param message The message whose signature is to be verified.
+ * \param len The length of the \a message to be verified.
+ *
+ * \return Returns true if the \a signature is valid for \a message;
+ * or false if the \a signature is not valid.
+ *
+ * Same result as the other verify(); but s * B - k * A is calculated
+ * with 4-bit windows over both scalars at once, so with half the
+ * doublings, and against precomputed multiples of B and of the key.
+ *
+ * \sa prepareVerifyKey(), sign()
+ */
+bool Ed25519::verify(const uint8_t signature[64], const VerifyKey &key,
+                     const void *message, size_t len)
+{
+    SHA512 hash;
+    Point R;
+    Point P;
+    limb_t s[NUM_LIMBS_256BIT];
+    limb_t k[NUM_LIMBS_256BIT];
+    limb_t t[NUM_LIMBS_512BIT + 1];
+    uint8_t *h = (uint8_t *)(hash.state.w); // Reuse hash buffer to save memory.
+    bool result = false;
+
+    const CachedPoint *baseTable = baseMultiples();
+
+    if (key.valid && decodePoint(R, signature)) {
+        // Reconstruct the k value from the signing step.
+        hash.reset();
+        hash.update(signature, 32);
+        hash.update(key.key, 32);
+        hash.update(message, len);
+        hash.finalize(h, 0);
+        reduceQFromBuffer(k, h, t);
+        BigNumberUtil::unpackLE(s, NUM_LIMBS_256BIT, signature + 32, 32);
+
+        // P = s * B + k * -A; from the most significant nibble down.
+        memset(&P, 0, sizeof(Point));
+        P.y[0] = 1;
+        P.z[0] = 1;
+        for (uint8_t posn = 64; posn > 0; --posn) {
+            if (posn != 64) {
+                dbl(P);
+                dbl(P);
+                dbl(P);
+                dbl(P);
+            }
+            uint8_t n = bits(s, (posn - 1) * 4, 4);
+            if (n)
+                add(P, baseTable[n - 1]);
+            n = bits(k, (posn - 1) * 4, 4);
+            if (n)
+                add(P, key.table[n - 1]);
+        }
+
+        // Compare s * B - k * A and R for equality; as above.
+        result = equalCofactor(P, R);
+    }
+
+    // Clean up and exit.
+    clean(R);
+    clean(P);
+    clean(s);
+    clean(k);
+    clean(t);
+    return result;
+}
+
+/**
+ * \brief Verifies several signatures at once.
+ *
+ * \param signatures The signatures.
+ * \param publicKeys The public key of each signature; these may repeat.
+ * \param messages The signed messages.
+ * \param lens The length of each message.
+ * \param count The number of signatures.
+ *
+ * \return Returns true if all signatures are valid; false if at least one
+ * of them is not.  Which one is left to the caller; e.g. by going through
+ * them one by one with verify().
+ *
+ * Checks 8 * (sum(z * s) * B - sum(z * R) - sum(z * k * A)) = 0 for random
+ * 128 bit weights z; derived by hashing all of the input.  The sum over
+ * the signatures of one key is a single term; so a batch from one signer
+ * costs little more than one verify plus some 50 point additions and a square
+ * root per signature.  Multiplied by the cofactor; as verify() checks.
+ *
+ * Needs about 500 bytes of heap per signature plus 2k per distinct key;
+ * if that is not available the signatures are verified one by one.
+ *
+ * \sa verify()
+ */
+bool Ed25519::verifyBatch(const uint8_t *const signatures[],
+                          const uint8_t *const publicKeys[],
+                          const void *const messages[], const size_t lens[],
+                          size_t count)
+{
+    if (count < 2) {
+        return count == 0 ||
+               verify(signatures[0], publicKeys[0], messages[0], lens[0]);
+    }
+
+    // Usually there are only one or two signers; a table each.
+    size_t distinct = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t j;
+        for (j = 0; j < i; ++j) {
+            if (!memcmp(publicKeys[j], publicKeys[i], 32))
+                break;
+        }
+        if (j == i)
+            ++distinct;
+    }
+
+    BatchSig *sigs = (BatchSig *)malloc(count * sizeof(BatchSig));
+    BatchKey *keys = (BatchKey *)malloc(distinct * sizeof(BatchKey));
+    if (!sigs || !keys) {
+        free(sigs);
+        free(keys);
+        for (size_t i = 0; i < count; ++i) {
+            if (!verify(signatures[i], publicKeys[i], messages[i], lens[i]))
+                return false;
+        }
+        return true;
+    }
+
+    SHA512 hash;
+    SHA512 transcript;
+    Point P;
+    limb_t sB[NUM_LIMBS_256BIT];
+    limb_t t[NUM_LIMBS_512BIT + 1];
+    uint8_t *h = (uint8_t *)(hash.state.w); // Reuse hash buffer to save memory.
+    size_t nkeys = 0;
+    bool result = false;
+
+    const CachedPoint *baseTable = baseMultiples();
+
+    // Decode the keys, once each, and the R of every signature; and
+    // reconstruct the k values from the signing step.
+    transcript.reset();
+    for (size_t i = 0; i < count; ++i) {
+        BatchSig &sig = sigs[i];
+        size_t j;
+        for (j = 0; j < nkeys; ++j) {
+            if (!memcmp(keys[j].publicKey, publicKeys[i], 32))
+                break;
+        }
+        if (j == nkeys) {
+            if (!decodePoint(P, publicKeys[i]))
+                goto cleanup;
+            memset(P.z, 0, sizeof(P.z));
+            Curve25519::sub(P.x, P.z, P.x);
+            Curve25519::sub(P.t, P.z, P.t);
+            memcpy_P(P.z, numBz, sizeof(P.z));
+            fillTable(keys[j].a, P);
+            keys[j].publicKey = publicKeys[i];
+            memset(keys[j].scalar, 0, sizeof(keys[j].scalar));
+            ++nkeys;
+        }
+        sig.key = j;
+
+        if (!decodePoint(P, signatures[i]))
+            goto cleanup;
+        memset(P.z, 0, sizeof(P.z));
+        Curve25519::sub(P.x, P.z, P.x);
+        Curve25519::sub(P.t, P.z, P.t);
+        memcpy_P(P.z, numBz, sizeof(P.z));
+        toCached(sig.r[0], P);
+        add(P, sig.r[0]);
+        toCached(sig.r[1], P);
+        add(P, sig.r[0]);
+        toCached(sig.r[2], P);
+
+        hash.reset();
+        hash.update(signatures[i], 32);
+        hash.update(publicKeys[i], 32);
+        hash.update(messages[i], lens[i]);
+        hash.finalize(h, 0);
+        transcript.update(signatures[i], 64);
+        transcript.update(h, 64);
+        reduceQFromBuffer(sig.k, h, t);
+        BigNumberUtil::unpackLE(sig.s, NUM_LIMBS_256BIT, signatures[i] + 32, 32);
+    }
+
+    // The weights; four per hash of the transcript and a counter.
+    transcript.finalize(t, 0);
+    for (size_t i = 0; i < count; ++i) {
+        if ((i % 4) == 0) {
+            hash.reset();
+            hash.update(t, 64);
+            hash.update(&i, sizeof(i));
+            hash.finalize(h, 0);
+        }
+        memset(sigs[i].z, 0, sizeof(sigs[i].z));
+        BigNumberUtil::unpackLE(sigs[i].z, NUM_LIMBS_128BIT, h + (i % 4) * 16, 16);
+    }
+
+    // Sum the scalars; z * s for B and z * k per key.
+    memset(sB, 0, sizeof(sB));
+    for (size_t i = 0; i < count; ++i) {
+        mulAddQ(sB, sigs[i].z, sigs[i].s);
+        mulAddQ(keys[sigs[i].key].scalar, sigs[i].z, sigs[i].k);
+    }
+
+    // P = sB * B + sum(scalar * -A) + sum(z * -R); 4-bit windows for the
+    // full size scalars, 2-bit windows for the 128 bit weights.
+    memset(&P, 0, sizeof(Point));
+    P.y[0] = 1;
+    P.z[0] = 1;
+    for (uint16_t posn = 256; posn > 0; --posn) {
+        uint8_t bit = posn - 1;
+        if (posn != 256)
+            dbl(P);
+        if ((bit % 4) == 0) {
+            uint8_t n = bits(sB, bit, 4);
+            if (n)
+                add(P, baseTable[n - 1]);
+            for (size_t j = 0; j < nkeys; ++j) {
+                n = bits(keys[j].scalar, bit, 4);
+                if (n)
+                    add(P, keys[j].a[n - 1]);
+            }
+        }
+        if (bit < 128 && (bit % 2) == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                uint8_t n = bits(sigs[i].z, bit, 2);
+                if (n)
+                    add(P, sigs[i].r[n - 1]);
+            }
+        }
+    }
+
+    // Multiply by the cofactor and compare with the neutral element.
+    dbl(P);
+    dbl(P);
+    dbl(P);
+    {
+        Point O;
+        memset(&O, 0, sizeof(Point));
+        O.y[0] = 1;
+        O.z[0] = 1;
+        result = equal(P, O);
+    }
+
+cleanup:
+    clean(P);
+    clean(sB);
+    clean(t);
+    clean(sigs, count * sizeof(BatchSig));
+    clean(keys, distinct * sizeof(BatchKey));
+    free(sigs);
+    free(keys);
     return result;
 }
 
@@ -263,7 +570,7 @@ void Ed25519::derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32
     deriveKeys(&hash, a, privateKey);
 
     // Compute the point A = aB and encode it.
-    mul(ptA, a);
+    mulBase(ptA, a);
     encodePoint(publicKey, ptA);
 
     // Clean up and exit.
@@ -444,22 +751,56 @@ void Ed25519::mul(Point &result, const limb_t *s, Point &p, bool constTime)
 }
 
 /**
- * \brief Multiplies a value by the base point of the curve.
+ * \brief Multiplies a value by the base point of the curve; with the
+ * fixed-base comb of Ed25519Comb.h.
  *
  * \param result The result of the multiplication.
  * \param s The value, which must be NUM_LIMBS_256BIT limbs in size.
- * \param constTime Set to true if the evaluation must be constant-time
- * because \a s is a secret values.
+ *
+ * Bit i of comb j's index is bit 32 * j + 64 * k + i of \a s for tooth
+ * k; so 31 doublings and 64 additions. Constant-time; every lookup reads
+ * all 16 entries of the comb.
  */
-void Ed25519::mul(Point &result, const limb_t *s, bool constTime)
+void Ed25519::mulBase(Point &result, const limb_t *s)
 {
-    Point P;
-    memcpy_P(P.x, numBx, sizeof(P.x));
-    memcpy_P(P.y, numBy, sizeof(P.y));
-    memcpy_P(P.z, numBz, sizeof(P.z));
-    memcpy_P(P.t, numBt, sizeof(P.t));
-    mul(result, s, P, constTime);
-    clean(P);
+    CachedPoint q;
+    limb_t entry[3][NUM_LIMBS_256BIT];
+    limb_t mask;
+
+    // Initialize the result to (0, 1, 1, 0); the comb entries have z = 1.
+    memset(&result, 0, sizeof(Point));
+    result.y[0] = 1;
+    result.z[0] = 1;
+    memset(q.z, 0, sizeof(q.z));
+    q.z[0] = 1;
+
+    for (uint8_t i = 32; i > 0; --i) {
+        if (i != 32)
+            dbl(result);
+        for (uint8_t j = 0; j < 2; ++j) {
+            uint8_t posn = 32 * j + i - 1;
+            uint8_t n = bits(s, posn, 1) | (bits(s, posn + 64, 1) << 1) |
+                        (bits(s, posn + 128, 1) << 2) | (bits(s, posn + 192, 1) << 3);
+            memset(q.ypx, 0, sizeof(q.ypx));
+            memset(q.ymx, 0, sizeof(q.ymx));
+            memset(q.t2d, 0, sizeof(q.t2d));
+            for (uint8_t e = 0; e < 16; ++e) {
+                memcpy_P(entry, combB[j][e], sizeof(entry));
+                mask = ((limb_t)(e ^ n) - 1) >> (LIMB_BITS - 1);
+                mask = ~(mask - 1);
+                for (uint8_t l = 0; l < NUM_LIMBS_256BIT; ++l) {
+                    q.ypx[l] |= entry[0][l] & mask;
+                    q.ymx[l] |= entry[1][l] & mask;
+                    q.t2d[l] |= entry[2][l] & mask;
+                }
+            }
+            add(result, q);
+        }
+    }
+
+    // Clean up.
+    clean(q);
+    clean(entry);
 }
 
 /**
@@ -500,6 +841,165 @@ void Ed25519::add(Point &p, const Point &q)
     clean(D);
 }
 
+/**
+ * \brief Adds a curve point in cached form to another.
+ *
+ * \param p The first point and the result.
+ * \param q The second point.
+ */
+void Ed25519::add(Point &p, const CachedPoint &q)
+{
+    limb_t A[NUM_LIMBS_256BIT];
+    limb_t B[NUM_LIMBS_256BIT];
+    limb_t C[NUM_LIMBS_256BIT];
+    limb_t D[NUM_LIMBS_256BIT];
+
+    Curve25519::sub(A, p.y, p.x);
+    Curve25519::mul(A, A, q.ymx);
+    Curve25519::add(B, p.y, p.x);
+    Curve25519::mul(B, B, q.ypx);
+    Curve25519::mul(C, p.t, q.t2d);
+    Curve25519::mul(D, p.z, q.z);
+    Curve25519::add(D, D, D);
+    Curve25519::sub(p.t, B, A);             // E = B - A
+    Curve25519::sub(p.z, D, C);             // F = D - C
+    Curve25519::add(D, D, C);               // G = D + C
+    Curve25519::add(B, B, A);               // H = B + A
+    Curve25519::mul(p.x, p.t, p.z);         // p.x = E * F
+    Curve25519::mul(p.y, D, B);             // p.y = G * H
+    Curve25519::mul(p.z, p.z, D);           // p.z = F * G
+    Curve25519::mul(p.t, p.t, B);           // p.t = E * H
+
+    clean(A);
+    clean(B);
+    clean(C);
+    clean(D);
+}
+
+/**
+ * \brief Doubles a curve point.
+ *
+ * \param p The point to double and the result.
+ *
+ * Dedicated doubling; it does not need p.t, unlike add(p, p).
+ */
+void Ed25519::dbl(Point &p)
+{
+    limb_t A[NUM_LIMBS_256BIT];
+    limb_t B[NUM_LIMBS_256BIT];
+    limb_t C[NUM_LIMBS_256BIT];
+    limb_t D[NUM_LIMBS_256BIT];
+
+    Curve25519::square(A, p.x);
+    Curve25519::square(B, p.y);
+    Curve25519::square(C, p.z);
+    Curve25519::add(C, C, C);
+    Curve25519::add(D, p.x, p.y);
+    Curve25519::square(D, D);
+    Curve25519::add(p.y, A, B);             // H = A + B
+    Curve25519::sub(p.x, D, p.y);           // E = (x + y)^2 - A - B
+    Curve25519::sub(p.z, B, A);             // G = B - A
+    Curve25519::sub(p.t, C, p.z);           // F = 2 * z^2 - G
+    Curve25519::mul(A, p.x, p.t);           // x = E * F
+    Curve25519::mul(B, p.z, p.y);           // y = G * H
+    Curve25519::mul(p.z, p.t, p.z);         // z = F * G
+    Curve25519::mul(p.t, p.x, p.y);         // t = E * H
+    memcpy(p.x, A, sizeof(A));
+    memcpy(p.y, B, sizeof(B));
+
+    clean(A);
+    clean(B);
+    clean(C);
+    clean(D);
+}
+
+/**
+ * \brief Converts a curve point into cached form.
+ *
+ * \param c The cached form of \a p.
+ * \param p The curve point.
+ */
+void Ed25519::toCached(CachedPoint &c, const Point &p)
+{
+    Curve25519::add(c.ypx, p.y, p.x);
+    Curve25519::sub(c.ymx, p.y, p.x);
+    Curve25519::mul_P(c.t2d, p.t, numDx2);
+    memcpy(c.z, p.z, sizeof(c.z));
+}
+
+/**
+ * \brief Fills a table with the multiples 1..15 of a curve point.
+ *
+ * \param table The table; entry i holds (i + 1) * p in cached form.
+ * \param p The curve point.
+ */
+void Ed25519::fillTable(CachedPoint table[15], const Point &p)
+{
+    Point q = p;
+    toCached(table[0], p);
+    for (uint8_t i = 1; i < 15; ++i) {
+        add(q, table[0]);
+        toCached(table[i], q);
+    }
+    clean(q);
+}
+
+/**
+ * \brief Returns the multiples 1..15 of the base point, in cached form.
+ *
+ * Built on first use. A function local static; so that it is built just
+ * once when two tasks verify at the same time.
+ */
+const Ed25519::CachedPoint *Ed25519::baseMultiples()
+{
+    struct Table {
+        CachedPoint table[15];
+        Table()
+        {
+            Point P;
+            memcpy_P(P.x, numBx, sizeof(P.x));
+            memcpy_P(P.y, numBy, sizeof(P.y));
+            memcpy_P(P.z, numBz, sizeof(P.z));
+            memcpy_P(P.t, numBt, sizeof(P.t));
+            fillTable(table, P);
+        }
+    };
+    static const Table base;
+    return base.table;
+}
+
+/**
+ * \brief Extracts a window of bits from a scalar.
+ *
+ * \param s The scalar, NUM_LIMBS_256BIT limbs in size.
+ * \param posn The lowest bit of the window; a multiple of \a width.
+ * \param width The width of the window; 2 or 4.
+ */
+uint8_t Ed25519::bits(const limb_t *s, uint8_t posn, uint8_t width)
+{
+    return (uint8_t)((s[posn / LIMB_BITS] >> (posn % LIMB_BITS)) & ((1 << width) - 1));
+}
+
+/**
+ * \brief Computes result = (result + x * y) mod q.
+ *
+ * \param result The sum; NUM_LIMBS_256BIT limbs, less than q.
+ * \param x The first factor; NUM_LIMBS_256BIT limbs.
+ * \param y The second factor; NUM_LIMBS_256BIT limbs.  x * y must be
+ * less than (q - 1)^2.
+ */
+void Ed25519::mulAddQ(limb_t *result, const limb_t *x, const limb_t *y)
+{
+    limb_t t[NUM_LIMBS_512BIT + 1];
+
+    Curve25519::mulNoReduce(t, x, y);
+    t[NUM_LIMBS_512BIT] = 0;
+    reduceQ(t, t);
+    BigNumberUtil::add(result, result, t, NUM_LIMBS_256BIT);
+    BigNumberUtil::reduceQuick_P(result, result, numQ, NUM_LIMBS_256BIT);
+    clean(t);
+}
+
 /**
  * \brief Determine if two curve points are equal.
  *
@@ -527,6 +1027,39 @@ bool Ed25519::equal(const Point &p, const Point &q)
     return result;
 }
 
+/**
+ * \brief Determines if two curve points are equal up to a small order
+ * component; i.e. if 8 * (p - q) is the neutral element.
+ *
+ * \param p The first point; destroyed.
+ * \param q The second point; destroyed.
+ *
+ * \return Returns true if 8 * p and 8 * q are equal.
+ *
+ * The cofactored check of RFC 8032, section 5.1.7; which is also the
+ * only one a batch can do.  So that verify() and verifyBatch() agree.
+ */
+bool Ed25519::equalCofactor(Point &p, Point &q)
+{
+    Point O;
+    bool result;
+
+    // p = p - q.
+    memset(&O, 0, sizeof(Point));
+    Curve25519::sub(q.x, O.x, q.x);
+    Curve25519::sub(q.t, O.t, q.t);
+    add(p, q);
+
+    dbl(p);
+    dbl(p);
+    dbl(p);
+    O.y[0] = 1;
+    O.z[0] = 1;
+    result = equal(p, O);
+    clean(O);
+    return result;
+}
+
 /**
  * \brief Encodes a curve point into a 32-byte buffer.
  *
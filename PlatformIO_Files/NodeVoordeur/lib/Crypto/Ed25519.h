@@ -28,13 +28,54 @@
 
 class Ed25519
 {
+#if defined(TEST_ED25519_POINT_OPS)
 public:
+#else
+private:
+#endif
+    // Curve point represented in extended homogeneous coordinates.
+    struct Point
+    {
+        limb_t x[32 / sizeof(limb_t)];
+        limb_t y[32 / sizeof(limb_t)];
+        limb_t z[32 / sizeof(limb_t)];
+        limb_t t[32 / sizeof(limb_t)];
+    };
+
+    // Curve point as (y + x, y - x, 2 * d * t, z); for adding it to
+    // another point with fewer multiplications.
+    struct CachedPoint
+    {
+        limb_t ypx[32 / sizeof(limb_t)];
+        limb_t ymx[32 / sizeof(limb_t)];
+        limb_t t2d[32 / sizeof(limb_t)];
+        limb_t z[32 / sizeof(limb_t)];
+    };
+
+public:
+    // A public key decoded once; with the multiples 1..15 of its negation.
+    struct VerifyKey
+    {
+        uint8_t key[32];
+        bool valid;
+        CachedPoint table[15];
+    };
+
     static void sign(uint8_t signature[64], const uint8_t privateKey[32],
                      const uint8_t publicKey[32], const void *message,
                      size_t len);
     static bool verify(const uint8_t signature[64], const uint8_t publicKey[32],
                        const void *message, size_t len);
 
+    static bool prepareVerifyKey(VerifyKey &key, const uint8_t publicKey[32]);
+    static bool verify(const uint8_t signature[64], const VerifyKey &key,
+                       const void *message, size_t len);
+
+    static bool verifyBatch(const uint8_t *const signatures[],
+                            const uint8_t *const publicKeys[],
+                            const void *const messages[], const size_t lens[],
+                            size_t count);
+
     static void generatePrivateKey(uint8_t privateKey[32]);
     static void derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32]);
 
@@ -43,24 +84,43 @@ private:
     Ed25519();
     ~Ed25519();
 
-    // Curve point represented in extended homogeneous coordinates.
-    struct Point
+#if defined(TEST_ED25519_POINT_OPS)
+public:
+#endif
+
+    // Per signature and per distinct key state for verifyBatch().
+    struct BatchSig
     {
-        limb_t x[32 / sizeof(limb_t)];
-        limb_t y[32 / sizeof(limb_t)];
-        limb_t z[32 / sizeof(limb_t)];
-        limb_t t[32 / sizeof(limb_t)];
+        CachedPoint r[3];                   // 1..3 times -R.
+        limb_t z[32 / sizeof(limb_t)];      // Random 128 bit weight.
+        limb_t s[32 / sizeof(limb_t)];
+        limb_t k[32 / sizeof(limb_t)];
+        size_t key;                         // Index into the keys.
+    };
+    struct BatchKey
+    {
+        const uint8_t *publicKey;
+        CachedPoint a[15];                  // 1..15 times -A.
+        limb_t scalar[32 / sizeof(limb_t)]; // Sum of z * k over its signatures.
     };
 
     static void reduceQFromBuffer(limb_t *result, const uint8_t buf[64], limb_t *temp);
     static void reduceQ(limb_t *result, limb_t *r);
 
     static void mul(Point &result, const limb_t *s, Point &p, bool constTime = true);
-    static void mul(Point &result, const limb_t *s, bool constTime = true);
+    static void mulBase(Point &result, const limb_t *s);
 
     static void add(Point &p, const Point &q);
+    static void add(Point &p, const CachedPoint &q);
+    static void dbl(Point &p);
+    static void toCached(CachedPoint &c, const Point &p);
+    static void fillTable(CachedPoint table[15], const Point &p);
+    static const CachedPoint *baseMultiples();
+    static uint8_t bits(const limb_t *s, uint8_t posn, uint8_t width);
+    static void mulAddQ(limb_t *result, const limb_t *x, const limb_t *y);
 
     static bool equal(const Point &p, const Point &q);
+    static bool equalCofactor(Point &p, Point &q);
 
     static void encodePoint(uint8_t *buf, Point &point);
     static bool decodePoint(Point &point, const uint8_t *buf);
@@ -0,0 +1,171 @@
+// Generated by gen-ed25519-comb.py; do not edit.
+//
+// Fixed-base comb for Ed25519::mulBase(); 2 combs of 16 entries, each
+// (y + x, y - x, 2 * d * x * y) of a sum of multiples of the base point.
+//
+static limb_t const combB[2][16][3][NUM_LIMBS_256BIT] PROGMEM = {
+    {
+        { // 0
+            { LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000) },
+            { LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000) },
+            { LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000) },
+        },
+        { // 1
+            { LIMB_PAIR(0xF58C3B85, 0x2FBC93C6), LIMB_PAIR(0xFB8C0E19, 0xCF932DC6), LIMB_PAIR(0x643D42C2, 0x270B4898), LIMB_PAIR(0x33D4BA65, 0x07CF9D3A) },
+            { LIMB_PAIR(0xD740913E, 0x9D103905), LIMB_PAIR(0xD140BEB3, 0xFD399F05), LIMB_PAIR(0x688F8A09, 0xA5C18434), LIMB_PAIR(0x98F81267, 0x44FD2F92) },
+            { LIMB_PAIR(0x877AAA68, 0xABC91205), LIMB_PAIR(0xCCAAC49E, 0x26D9E823), LIMB_PAIR(0xDD43598C, 0x5A1B7DCB), LIMB_PAIR(0x9F0C65A8, 0x6F117B68) },
+        },
+        { // 2
+            { LIMB_PAIR(0x77D1F515, 0xCD2A65E7), LIMB_PAIR(0x8FAA60F1, 0x54899187), LIMB_PAIR(0xDABC06E5, 0xB1B73BBC), LIMB_PAIR(0xA97CC9FB, 0x654878CB) },
+            { LIMB_PAIR(0x8DF6B0FE, 0x51138EC7), LIMB_PAIR(0xE575F51B, 0x5397DA89), LIMB_PAIR(0x717AF1B9, 0x09207A1D), LIMB_PAIR(0x2B20D650, 0x2102FDBA) },
+            { LIMB_PAIR(0x055CE6A1, 0x969EE405), LIMB_PAIR(0x1251AD29, 0x36BCA768), LIMB_PAIR(0xAA7DA415, 0x3A1AF517), LIMB_PAIR(0x29ECB2BA, 0x0AD725DB) },
+        },
+        { // 3
+            { LIMB_PAIR(0x601E59E8, 0x0055C585), LIMB_PAIR(0x66480E60, 0x8793342B), LIMB_PAIR(0xFE45E44C, 0x3E14AAD0), LIMB_PAIR(0x4813CF2B, 0x26EAD8E6) },
+            { LIMB_PAIR(0x9C8462A4, 0xCB75B8B6), LIMB_PAIR(0x67D31CD7, 0x2DD86FC5), LIMB_PAIR(0x881342F6, 0xCD1972EC), LIMB_PAIR(0x0FC12F2F, 0x0975B597) },
+            { LIMB_PAIR(0xDA5BA743, 0x63CF2303), LIMB_PAIR(0x52F1BA6E, 0x04BF9D81), LIMB_PAIR(0xAA7367DA, 0x333790D0), LIMB_PAIR(0x9DF6C5EA, 0x53467047) },
+        },
+        { // 4
+            { LIMB_PAIR(0xACAD8EA2, 0x583B04BF), LIMB_PAIR(0x148BE884, 0x29B743E8), LIMB_PAIR(0x0810C5DB, 0x2B1E583B), LIMB_PAIR(0x8EB3BBAA, 0x2B5449E5) },
+            { LIMB_PAIR(0xEB3DBE47, 0x5F3A7562), LIMB_PAIR(0x8EBDA0B8, 0xF7EA3854), LIMB_PAIR(0x45747299, 0x00C3E531), LIMB_PAIR(0x1627D551, 0x1304E9E7) },
+            { LIMB_PAIR(0x6ADC9CFE, 0x789814D2), LIMB_PAIR(0x8B48DD0B, 0x3C1BAB3F), LIMB_PAIR(0xF979C60A, 0xDA0FE1FF), LIMB_PAIR(0x7C2DD693, 0x4468DE2D) },
+        },
+        { // 5
+            { LIMB_PAIR(0xE3BC6748, 0x2118278D), LIMB_PAIR(0xD0B20EF7, 0xE71FFD60), LIMB_PAIR(0xC67BB198, 0xF551BE51), LIMB_PAIR(0xD0543D4D, 0x26A13664) },
+            { LIMB_PAIR(0x13A339EE, 0x29522D3B), LIMB_PAIR(0x6CD89529, 0x85522550), LIMB_PAIR(0xACF4F0F1, 0xDFEA3AD4), LIMB_PAIR(0x7942742E, 0x49D76BBA) },
+            { LIMB_PAIR(0x8D56E61D, 0x14FA4233), LIMB_PAIR(0xC351299A, 0x191D3946), LIMB_PAIR(0xA7ADB185, 0x247D576D), LIMB_PAIR(0xA8FCEDC2, 0x4E1FAFE3) },
+        },
+        { // 6
+            { LIMB_PAIR(0x236A044C, 0x15E7053D), LIMB_PAIR(0x3B8D87E3, 0x3CDDBCB1), LIMB_PAIR(0xD321A828, 0x519960D2), LIMB_PAIR(0x0FC5BBA4, 0x4E559A0F) },
+            { LIMB_PAIR(0x9C12701C, 0xFE00E876), LIMB_PAIR(0x039C3B5F, 0x95DCDC0A), LIMB_PAIR(0x0C02EB1B, 0xC169454B), LIMB_PAIR(0x5F87530C, 0x727021D3) },
+            { LIMB_PAIR(0x27DF241E, 0xA5710407), LIMB_PAIR(0xB2900D36, 0xDF45EFAA), LIMB_PAIR(0x60A69ADE, 0xFE6EDB5C), LIMB_PAIR(0x07BBC01D, 0x64FCB730) },
+        },
+        { // 7
+            { LIMB_PAIR(0x6FD390CA, 0x38EF58CC), LIMB_PAIR(0x171A98FC, 0xEF786575), LIMB_PAIR(0xC442D65F, 0x8850B78F), LIMB_PAIR(0x6FD086EF, 0x6F34C66D) },
+            { LIMB_PAIR(0x3898DC04, 0x93F3CBB4), LIMB_PAIR(0x4307B727, 0x0791FFB2), LIMB_PAIR(0xCE34981D, 0xD7BD8096), LIMB_PAIR(0x8B849F6D, 0x0B598B8E) },
+            { LIMB_PAIR(0x0CC2F689, 0x11CFC18A), LIMB_PAIR(0xB529CE2A, 0x81114607), LIMB_PAIR(0xC00B5940, 0x0A9BC046), LIMB_PAIR(0xB1AC66C8, 0x412128B0) },
+        },
+        { // 8
+            { LIMB_PAIR(0xC80C1AC0, 0xA66DCC9D), LIMB_PAIR(0x1B38A436, 0x97A05CF4), LIMB_PAIR(0x95DBD7C6, 0xA7EBF3BE), LIMB_PAIR(0x8D7E7DAB, 0x7DA0B8F6) },
+            { LIMB_PAIR(0x385675A6, 0xEF782014), LIMB_PAIR(0xAAFDA9E8, 0xA2649F30), LIMB_PAIR(0x5CDFA8CB, 0x4CD1EB50), LIMB_PAIR(0x1D4DC0B3, 0x46115ABA) },
+            { LIMB_PAIR(0xC3B5DA76, 0xD40F1953), LIMB_PAIR(0x21119E9B, 0x1DAC6F73), LIMB_PAIR(0xFEB25960, 0x03CC6021), LIMB_PAIR(0x83674B4B, 0x5A5F887E) },
+        },
+        { // 9
+            { LIMB_PAIR(0x0CA2C1F4, 0x0A8D6018), LIMB_PAIR(0xCC68DF40, 0x815EB0DB), LIMB_PAIR(0xB82F4E99, 0xD7E67A47), LIMB_PAIR(0x607F15C0, 0x45A02890) },
+            { LIMB_PAIR(0xFD41F184, 0xFEF366D1), LIMB_PAIR(0x01CFE11E, 0x8B694A11), LIMB_PAIR(0x0150A74D, 0x4B39E15E), LIMB_PAIR(0x6AD351BA, 0x4013F03D) },
+            { LIMB_PAIR(0x6EE065CC, 0xBD0282DC), LIMB_PAIR(0x224AE646, 0x36B994FD), LIMB_PAIR(0xFEBCE874, 0x534E9AD8), LIMB_PAIR(0xD9F06E4F, 0x482255C1) },
+        },
+        { // 10
+            { LIMB_PAIR(0x71CEF800, 0x3C03EACF), LIMB_PAIR(0xCA8AFEBB, 0x90367544), LIMB_PAIR(0x6A29C477, 0x383FEA28), LIMB_PAIR(0xBC655462, 0x4E8593B0) },
+            { LIMB_PAIR(0xA3E5638C, 0x12DE114A), LIMB_PAIR(0x29C4F20D, 0xBA2A4AA9), LIMB_PAIR(0x7B8B13A3, 0x56B0D29D), LIMB_PAIR(0x7B9B7944, 0x6BB91A49) },
+            { LIMB_PAIR(0xC5E7D206, 0x2A49E646), LIMB_PAIR(0x9263C445, 0xB13EF9CD), LIMB_PAIR(0xEDAB529E, 0x50AB6CE8), LIMB_PAIR(0xB0EBE39B, 0x20CF7D79) },
+        },
+        { // 11
+            { LIMB_PAIR(0x8AE75C48, 0xCBD28F4E), LIMB_PAIR(0x44000B60, 0x3CDE0291), LIMB_PAIR(0x98BC2170, 0x373BB9C8), LIMB_PAIR(0x9F570886, 0x7C118853) },
+            { LIMB_PAIR(0xF0FE7DCA, 0x7DB4939D), LIMB_PAIR(0xCBA951CE, 0xF50EB90F), LIMB_PAIR(0x357E1D1D, 0x098BE61C), LIMB_PAIR(0x8899469D, 0x02356237) },
+            { LIMB_PAIR(0xE15A4C03, 0x20F6EFFA), LIMB_PAIR(0x3C778E05, 0x2F470A94), LIMB_PAIR(0xFC99DE67, 0x79F50A03), LIMB_PAIR(0xD1061483, 0x38D20188) },
+        },
+        { // 12
+            { LIMB_PAIR(0x0E6315DF, 0x23E811AD), LIMB_PAIR(0xE2AEB290, 0x0B650D05), LIMB_PAIR(0xA75D586C, 0xB7BA0F59), LIMB_PAIR(0x5E1F4DEE, 0x043EEDD4) },
+            { LIMB_PAIR(0xC7073217, 0xF6C147F2), LIMB_PAIR(0xF3AFD20C, 0xC651B919), LIMB_PAIR(0x7041F802, 0x258FDBFD), LIMB_PAIR(0x4F45073E, 0x173C4FA9) },
+            { LIMB_PAIR(0x928DF9C4, 0x3D71EA60), LIMB_PAIR(0x3373562D, 0x5B7E7806), LIMB_PAIR(0xA29552B2, 0xD9B0514C), LIMB_PAIR(0x993CC472, 0x1E2A7024) },
+        },
+        { // 13
+            { LIMB_PAIR(0xD45C811F, 0x601A0FBC), LIMB_PAIR(0x92EC0803, 0x24B7BC7D), LIMB_PAIR(0x17D2407F, 0xA0CAE62B), LIMB_PAIR(0x06225B26, 0x5FCB43EE) },
+            { LIMB_PAIR(0x3509FBA4, 0x310509B9), LIMB_PAIR(0x05631B75, 0x0D8DB376), LIMB_PAIR(0x52401C87, 0x97DECCBA), LIMB_PAIR(0x11B2E773, 0x044649F4) },
+            { LIMB_PAIR(0x9598215F, 0x0C0D24AD), LIMB_PAIR(0xCC36628C, 0x1B7F9026), LIMB_PAIR(0x7016DCEA, 0x338E2F55), LIMB_PAIR(0x5CC0E58F, 0x0C8A1BFA) },
+        },
+        { // 14
+            { LIMB_PAIR(0x681D104C, 0x8DE703B5), LIMB_PAIR(0x1263CB45, 0x3D2F7A59), LIMB_PAIR(0x1CE56C63, 0xAE710C17), LIMB_PAIR(0xFCC3E6CA, 0x6B857C7E) },
+            { LIMB_PAIR(0x8B2801C0, 0x79D256B4), LIMB_PAIR(0x3C400FC4, 0x7E9FBEAC), LIMB_PAIR(0x4733BA41, 0xA751AB1D), LIMB_PAIR(0xDD418ACA, 0x09DE2BF5) },
+            { LIMB_PAIR(0xEFF0687F, 0x3BF10FF3), LIMB_PAIR(0xF1E37BA2, 0x5EBAEA34), LIMB_PAIR(0x1D66034D, 0xE49E6126), LIMB_PAIR(0xC3B242CA, 0x5B466E2A) },
+        },
+        { // 15
+            { LIMB_PAIR(0x47FBB842, 0x137EEB67), LIMB_PAIR(0x60811A8B, 0x79DF5C75), LIMB_PAIR(0x71F8C89A, 0x5A2BA76F), LIMB_PAIR(0x3BC8FFC2, 0x09952A56) },
+            { LIMB_PAIR(0xDC7EF83C, 0xA2A8CB4B), LIMB_PAIR(0x5F93C226, 0x96B5C6FA), LIMB_PAIR(0x0664E3A5, 0xD4EBEB1B), LIMB_PAIR(0xE5C6CF2F, 0x409B4ADC) },
+            { LIMB_PAIR(0x834350C4, 0x44D53DB9), LIMB_PAIR(0xA5F505B4, 0x89299305), LIMB_PAIR(0x5949FF2F, 0xFB22FAA2), LIMB_PAIR(0x04657D64, 0x69B968A7) },
+        },
+    },
+    {
+        { // 0
+            { LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000) },
+            { LIMB_PAIR(0x00000001, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000) },
+            { LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000), LIMB_PAIR(0x00000000, 0x00000000) },
+        },
+        { // 1
+            { LIMB_PAIR(0x7B85C5E8, 0x8765B69F), LIMB_PAIR(0xD168BAB2, 0x6FF0678B), LIMB_PAIR(0x1D330F9B, 0x3A70E77C), LIMB_PAIR(0xB0AF8E7C, 0x3A5F6D51) },
+            { LIMB_PAIR(0xA60DAC5F, 0x61368756), LIMB_PAIR(0xEBABDC57, 0x17E02F6A), LIMB_PAIR(0x4CCE0F7D, 0x7F193F2D), LIMB_PAIR(0x89ECDCF0, 0x20234A77) },
+            { LIMB_PAIR(0x7178B252, 0x76D20DB6), LIMB_PAIR(0xD51ED160, 0x071C34F9), LIMB_PAIR(0xB3E41170, 0xF62A4A20), LIMB_PAIR(0x3CFFE366, 0x7CD68235) },
+        },
+        { // 2
+            { LIMB_PAIR(0x12DDB0A4, 0xD598639C), LIMB_PAIR(0xC024866B, 0xA5D19F30), LIMB_PAIR(0x58FCE460, 0xD17C2F03), LIMB_PAIR(0x2E095E8A, 0x07A19515) },
+            { LIMB_PAIR(0x9C2EC4DE, 0x296FA9C5), LIMB_PAIR(0x4F84F3CB, 0xBC8B61BF), LIMB_PAIR(0x17A8F908, 0x1C7706D9), LIMB_PAIR(0x7AD3255D, 0x63B795FC) },
+            { LIMB_PAIR(0x389E5FC8, 0xA8368F02), LIMB_PAIR(0xCF8DE43B, 0x90433B02), LIMB_PAIR(0xC5412643, 0xAFA1FD5D), LIMB_PAIR(0x032F0137, 0x3E8FE83D) },
+        },
+        { // 3
+            { LIMB_PAIR(0x59DC4791, 0xFCA8EA41), LIMB_PAIR(0x8B3AA058, 0x0FAE3DAB), LIMB_PAIR(0x4EE996EB, 0xBE13396F), LIMB_PAIR(0x51936C6F, 0x379D09BB) },
+            { LIMB_PAIR(0xF614AFFB, 0xB6601A1B), LIMB_PAIR(0x210392EA, 0x8360C886), LIMB_PAIR(0x56349198, 0x4867333C), LIMB_PAIR(0xF049C42C, 0x03224A6F) },
+            { LIMB_PAIR(0x6FB88974, 0x5E267A30), LIMB_PAIR(0x4F8FB990, 0xBEB84F82), LIMB_PAIR(0x18C57B0D, 0x6029B7B9), LIMB_PAIR(0xA2357DF1, 0x60670BBE) },
+        },
+        { // 4
+            { LIMB_PAIR(0x305B2F51, 0x96EEBFFB), LIMB_PAIR(0x889596B8, 0xD3F938AD), LIMB_PAIR(0x46D5DD25, 0xF0F52DC7), LIMB_PAIR(0xBB3A0095, 0x57968290) },
+            { LIMB_PAIR(0x8C58AEDC, 0x4637974E), LIMB_PAIR(0xABF041A4, 0xB9EF22FB), LIMB_PAIR(0xE980718A, 0xE185D956), LIMB_PAIR(0xB143A8A6, 0x2F1B78FA) },
+            { LIMB_PAIR(0x0A20E101, 0xF71AB843), LIMB_PAIR(0x24F0EC47, 0xF393658D), LIMB_PAIR(0x6EE2EED1, 0xCF7509A8), LIMB_PAIR(0xDC2AA3E1, 0x7DC43E35) },
+        },
+        { // 5
+            { LIMB_PAIR(0x06BAAFDA, 0xBC045FDE), LIMB_PAIR(0xFB5A4416, 0x47739AE0), LIMB_PAIR(0x5D2EE4A6, 0x7C8463D8), LIMB_PAIR(0x04374AD2, 0x2203EAC5) },
+            { LIMB_PAIR(0xA05C01E7, 0x0EFF92FE), LIMB_PAIR(0x895FB7CC, 0x75F7039C), LIMB_PAIR(0x9404E0F8, 0x8D6A8217), LIMB_PAIR(0x8A9A737A, 0x573560A5) },
+            { LIMB_PAIR(0x59DD3897, 0x86782D19), LIMB_PAIR(0x70D83750, 0x60123667), LIMB_PAIR(0xFCE034C3, 0x9B25D884), LIMB_PAIR(0x01E23583, 0x3E1460C5) },
+        },
+        { // 6
+            { LIMB_PAIR(0x75E3FB78, 0x39D004C9), LIMB_PAIR(0x29B114E0, 0x18B6E865), LIMB_PAIR(0xD16C3194, 0x38EBE25F), LIMB_PAIR(0x9E79F5CF, 0x607D2344) },
+            { LIMB_PAIR(0x2338841D, 0xCE240F2C), LIMB_PAIR(0x8631E5D1, 0xF0ECCD75), LIMB_PAIR(0xF18A552D, 0xA57EE5F1), LIMB_PAIR(0x1C9B3233, 0x7AB87BC8) },
+            { LIMB_PAIR(0x1B17760E, 0x7E7F7150), LIMB_PAIR(0xE158A26E, 0xB6632A86), LIMB_PAIR(0xBE0AC1D5, 0x39EA5398), LIMB_PAIR(0x503BA911, 0x68A56D9D) },
+        },
+        { // 7
+            { LIMB_PAIR(0xC8A5BC9B, 0xFFE05716), LIMB_PAIR(0x465E9F43, 0x066A99E4), LIMB_PAIR(0x4A91D729, 0x5F1F7C8B), LIMB_PAIR(0x1C435B3B, 0x24102BD9) },
+            { LIMB_PAIR(0xF4CA0F68, 0xF20B8F9E), LIMB_PAIR(0xE0AEF35B, 0xDC05F306), LIMB_PAIR(0x2D531E9A, 0xB4666F04), LIMB_PAIR(0x1B535EE9, 0x383FF5D3) },
+            { LIMB_PAIR(0x442B19AA, 0x84DCD7CB), LIMB_PAIR(0xE6B5984D, 0x4118DB5F), LIMB_PAIR(0x21A7DEC1, 0x4FE5DD46), LIMB_PAIR(0xD86EF74F, 0x1CC49092) },
+        },
+        { // 8
+            { LIMB_PAIR(0x193B877F, 0xBB2E00C9), LIMB_PAIR(0xE0DC506B, 0xECE3A890), LIMB_PAIR(0x36DE649F, 0xECF3B7C0), LIMB_PAIR(0x98DE9E1A, 0x5F460408) },
+            { LIMB_PAIR(0x832FCEDB, 0x739D8845), LIMB_PAIR(0xAE6BF863, 0xFA38D6C9), LIMB_PAIR(0xB74FFEF7, 0x32BC0DCA), LIMB_PAIR(0x14BCE45E, 0x73937E88) },
+            { LIMB_PAIR(0x297BF48D, 0xB9037116), LIMB_PAIR(0xD4F06834, 0xA9D13B22), LIMB_PAIR(0x4696BDC6, 0xE1971557), LIMB_PAIR(0x91D5E835, 0x2CF8A4E8) },
+        },
+        { // 9
+            { LIMB_PAIR(0x40B81EDC, 0xB131A877), LIMB_PAIR(0xC50A6E37, 0x2529CCE1), LIMB_PAIR(0x3D86DF40, 0xF87178C4), LIMB_PAIR(0x72690814, 0x3AA294B9) },
+            { LIMB_PAIR(0x083AC1C0, 0x31746C23), LIMB_PAIR(0x1C3DB42F, 0x3DAC7B51), LIMB_PAIR(0x228A9F80, 0xD4F12B16), LIMB_PAIR(0xB1806C0A, 0x40730AB9) },
+            { LIMB_PAIR(0x0552A87D, 0x152402F2), LIMB_PAIR(0x46352008, 0xE69F2C75), LIMB_PAIR(0x3DA75873, 0x09D51A51), LIMB_PAIR(0x428677AB, 0x4E71CD08) },
+        },
+        { // 10
+            { LIMB_PAIR(0xD78789AC, 0x084ABC56), LIMB_PAIR(0x4C34A837, 0x5659A950), LIMB_PAIR(0xC8E32D7B, 0xFCBC29CC), LIMB_PAIR(0x13A35552, 0x490BAD92) },
+            { LIMB_PAIR(0xE038D4E9, 0x9B3F9942), LIMB_PAIR(0x6CD96AA5, 0xEDA655EC), LIMB_PAIR(0xF0B1D81F, 0xB2A94883), LIMB_PAIR(0x3A65A94A, 0x38639CCF) },
+            { LIMB_PAIR(0xA7817C8B, 0x2AF87C80), LIMB_PAIR(0xCD31C019, 0x3290308B), LIMB_PAIR(0xA7BE274B, 0xC389CFAE), LIMB_PAIR(0x10BFE889, 0x6A125AEB) },
+        },
+        { // 11
+            { LIMB_PAIR(0x3BA3C672, 0xF56E4142), LIMB_PAIR(0xE9368956, 0x573E3974), LIMB_PAIR(0xE7A5B7B3, 0xD6A2DF8E), LIMB_PAIR(0x4A134A97, 0x3147F866) },
+            { LIMB_PAIR(0x8C5FB918, 0x961CD052), LIMB_PAIR(0x645EBC80, 0x8120A7A9), LIMB_PAIR(0x0F1E6013, 0xD448452A), LIMB_PAIR(0x06AA1A4C, 0x05D53ACA) },
+            { LIMB_PAIR(0xDAED85E1, 0xC6C34026), LIMB_PAIR(0xB2D4B1E0, 0x3CFB0BD6), LIMB_PAIR(0x370B87CB, 0x0F12416C), LIMB_PAIR(0xAA945A13, 0x0224A2EB) },
+        },
+        { // 12
+            { LIMB_PAIR(0xF3FDDFE3, 0x77102749), LIMB_PAIR(0x79BEAC52, 0x093B1317), LIMB_PAIR(0xBABA54C7, 0x2C1A5CC1), LIMB_PAIR(0x82ED20F9, 0x7CC2EFFD) },
+            { LIMB_PAIR(0x627C7B1C, 0xFE5E30FE), LIMB_PAIR(0x8D82FC2F, 0x7D6DE30D), LIMB_PAIR(0x1C1BF394, 0x6B7981B1), LIMB_PAIR(0x955690EF, 0x6EF79537) },
+            { LIMB_PAIR(0x38AC1D9D, 0x317BD4C9), LIMB_PAIR(0xD43A48C8, 0x120B22AB), LIMB_PAIR(0x25BA47C7, 0xD373691A), LIMB_PAIR(0xDDE79E2D, 0x444F44EB) },
+        },
+        { // 13
+            { LIMB_PAIR(0x2BF4376A, 0x6FF950EA), LIMB_PAIR(0x5B86DB4A, 0x970D30F6), LIMB_PAIR(0xD2EE3EB1, 0xFD04F109), LIMB_PAIR(0xB4B8924C, 0x23654DED) },
+            { LIMB_PAIR(0xAA496A92, 0xBB24631D), LIMB_PAIR(0x560F5B8E, 0x9A4DCCAA), LIMB_PAIR(0xFAD2D247, 0x964C615B), LIMB_PAIR(0x65681C6A, 0x0CF07C2D) },
+            { LIMB_PAIR(0xD9512BC6, 0x6B1E6C89), LIMB_PAIR(0xC7992AE0, 0xFF307335), LIMB_PAIR(0x78620616, 0x1E41B439), LIMB_PAIR(0x73477C30, 0x5F5527F0) },
+        },
+        { // 14
+            { LIMB_PAIR(0x6BD68F25, 0xA3819393), LIMB_PAIR(0xFC692AA7, 0x921A6473), LIMB_PAIR(0x102C552B, 0xFBAAB570), LIMB_PAIR(0x0DA1E96D, 0x22260E70) },
+            { LIMB_PAIR(0xDBC441A8, 0xD2DD61E7), LIMB_PAIR(0x3004A0F1, 0xF5A113DB), LIMB_PAIR(0xF70504CE, 0x49F05E44), LIMB_PAIR(0x3B07B9A0, 0x2A59CD57) },
+            { LIMB_PAIR(0xE116AB23, 0x7D785536), LIMB_PAIR(0xE3FEE820, 0x2D2FFA28), LIMB_PAIR(0xC62F75CE, 0xF8D8FFF8), LIMB_PAIR(0x15C34F43, 0x7626171B) },
+        },
+        { // 15
+            { LIMB_PAIR(0x2C8CDC4A, 0x2E9B3E1C), LIMB_PAIR(0x39292B8F, 0xF301BDDB), LIMB_PAIR(0x6F45B448, 0x908063DB), LIMB_PAIR(0x25C80DFF, 0x03D2A9B1) },
+            { LIMB_PAIR(0x72684FB0, 0x3ECADB0A), LIMB_PAIR(0x18C4F682, 0x6DDFB9ED), LIMB_PAIR(0x6DBBBAEF, 0xA94247E4), LIMB_PAIR(0xADB3D562, 0x2C63DF06) },
+            { LIMB_PAIR(0xBA8DD8FC, 0xFD788E43), LIMB_PAIR(0x5EB4E217, 0x30FAE1C2), LIMB_PAIR(0x00568551, 0xBD60C01E), LIMB_PAIR(0xF35C4364, 0x066F5248) },
+        },
+    },
+};
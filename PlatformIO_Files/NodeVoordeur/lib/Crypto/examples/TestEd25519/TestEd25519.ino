@@ -24,6 +24,9 @@
 This example runs tests on the Ed25519 algorithm.
 */
 
+// Enable access to the internals of Ed25519 to test mulBase() directly.
+#define TEST_ED25519_POINT_OPS 1
+
 #include <Crypto.h>
 #include <Ed25519.h>
 #include <RNG.h>
@@ -35,12 +38,13 @@ struct TestVector
     const char *name;
     uint8_t privateKey[32];
     uint8_t publicKey[32];
-    uint8_t message[2];
+    uint8_t message[16];
     size_t len;
     uint8_t signature[64];
 };
 
-// Test vectors for Ed25519 from:
+// Test vectors for Ed25519 from RFC 8032, section 7.1; the first two
+// were already in:
 // https://tools.ietf.org/html/draft-irtf-cfrg-eddsa-05
 static TestVector const testVectorEd25519_1 PROGMEM = {
     .name       = "Ed25519 #1",
@@ -84,6 +88,54 @@ static TestVector const testVectorEd25519_2 PROGMEM = {
                    0x38, 0x7b, 0x2e, 0xae, 0xb4, 0x30, 0x2a, 0xee,
                    0xb0, 0x0d, 0x29, 0x16, 0x12, 0xbb, 0x0c, 0x00}
 };
+static TestVector const testVectorEd25519_3 PROGMEM = {
+    .name       = "Ed25519 #3",
+    .privateKey = {0xc5, 0xaa, 0x8d, 0xf4, 0x3f, 0x9f, 0x83, 0x7b,
+                   0xed, 0xb7, 0x44, 0x2f, 0x31, 0xdc, 0xb7, 0xb1,
+                   0x66, 0xd3, 0x85, 0x35, 0x07, 0x6f, 0x09, 0x4b,
+                   0x85, 0xce, 0x3a, 0x2e, 0x0b, 0x44, 0x58, 0xf7},
+    .publicKey  = {0xfc, 0x51, 0xcd, 0x8e, 0x62, 0x18, 0xa1, 0xa3,
+                   0x8d, 0xa4, 0x7e, 0xd0, 0x02, 0x30, 0xf0, 0x58,
+                   0x08, 0x16, 0xed, 0x13, 0xba, 0x33, 0x03, 0xac,
+                   0x5d, 0xeb, 0x91, 0x15, 0x48, 0x90, 0x80, 0x25},
+    .message    = {0xaf, 0x82, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    .len        = 2,
+    .signature  = {0x62, 0x91, 0xd6, 0x57, 0xde, 0xec, 0x24, 0x02,
+                   0x48, 0x27, 0xe6, 0x9c, 0x3a, 0xbe, 0x01, 0xa3,
+                   0x0c, 0xe5, 0x48, 0xa2, 0x84, 0x74, 0x3a, 0x44,
+                   0x5e, 0x36, 0x80, 0xd7, 0xdb, 0x5a, 0xc3, 0xac,
+                   0x18, 0xff, 0x9b, 0x53, 0x8d, 0x16, 0xf2, 0x90,
+                   0xae, 0x67, 0xf7, 0x60, 0x98, 0x4d, 0xc6, 0x59,
+                   0x4a, 0x7c, 0x15, 0xe9, 0x71, 0x6e, 0xd2, 0x8d,
+                   0xc0, 0x27, 0xbe, 0xce, 0xea, 0x1e, 0xc4, 0x0a}
+};
+
+// Key #1 and a signature whose R has a component of order 8 added;
+// which passes the cofactored check of RFC 8032, section 5.1.7, but not
+// the plain one. Valid for verify() and verifyBatch() alike.
+static TestVector const testVectorEd25519_order8 PROGMEM = {
+    .name       = "Ed25519 small order R",
+    .privateKey = {0x9d, 0x61, 0xb1, 0x9d, 0xef, 0xfd, 0x5a, 0x60,
+                   0xba, 0x84, 0x4a, 0xf4, 0x92, 0xec, 0x2c, 0xc4,
+                   0x44, 0x49, 0xc5, 0x69, 0x7b, 0x32, 0x69, 0x19,
+                   0x70, 0x3b, 0xac, 0x03, 0x1c, 0xae, 0x7f, 0x60},
+    .publicKey  = {0xd7, 0x5a, 0x98, 0x01, 0x82, 0xb1, 0x0a, 0xb7,
+                   0xd5, 0x4b, 0xfe, 0xd3, 0xc9, 0x64, 0x07, 0x3a,
+                   0x0e, 0xe1, 0x72, 0xf3, 0xda, 0xa6, 0x23, 0x25,
+                   0xaf, 0x02, 0x1a, 0x68, 0xf7, 0x07, 0x51, 0x1a},
+    .message    = {0x53, 0x49, 0x47, 0x2f, 0x32, 0x20, 0x63, 0x6f,
+                   0x66, 0x61, 0x63, 0x74, 0x6f, 0x72, 0x00, 0x00},
+    .len        = 14,
+    .signature  = {0x20, 0xe4, 0xd2, 0x4a, 0x8d, 0x8b, 0xb3, 0x3c,
+                   0x68, 0xa7, 0xf3, 0x00, 0x5b, 0xfe, 0x00, 0xf4,
+                   0x76, 0x0d, 0x08, 0xba, 0x9b, 0x08, 0xf4, 0x4b,
+                   0x63, 0xc3, 0xe4, 0x01, 0x06, 0x94, 0x42, 0xb1,
+                   0x46, 0x3a, 0x4c, 0xe6, 0x1c, 0xd6, 0x5f, 0x7b,
+                   0x96, 0x25, 0x77, 0x99, 0xe3, 0x55, 0xb7, 0xac,
+                   0x9e, 0x34, 0x63, 0xb2, 0xe3, 0x63, 0x9c, 0x46,
+                   0x0f, 0x4b, 0x83, 0x01, 0x38, 0x9c, 0xb7, 0x03}
+};
 
 static TestVector testVector;
 
@@ -141,6 +193,35 @@ void testFixedVectors(const struct TestVector *test)
     Serial.print(elapsed);
     Serial.println(" us)");
 
+    // Verify again; with the key prepared once.
+    Serial.print(test->name);
+    Serial.print(" verify prepared ... ");
+    Serial.flush();
+    Ed25519::VerifyKey key;
+    start = micros();
+    verified = Ed25519::prepareVerifyKey(key, test->publicKey) &&
+               Ed25519::verify(signature, key, test->message, test->len);
+    elapsed = micros() - start;
+    if (verified) {
+        Serial.print("ok");
+    } else {
+        Serial.println("failed");
+    }
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+
+    // Neither may accept the signature with a bit of s flipped.
+    Serial.print(test->name);
+    Serial.print(" reject ... ");
+    signature[40] ^= 0x01;
+    if (!Ed25519::verify(signature, test->publicKey, test->message, test->len) &&
+            !Ed25519::verify(signature, key, test->message, test->len)) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+    }
+
     // Check derivation of the public key from the private key.
     Serial.print(test->name);
     Serial.print(" derive public key ... ");
@@ -164,6 +245,179 @@ void testFixedVectors()
 {
     testFixedVectors(&testVectorEd25519_1);
     testFixedVectors(&testVectorEd25519_2);
+    testFixedVectors(&testVectorEd25519_3);
+}
+
+// The cofactored check; plain, prepared and batched must agree.
+void testCofactor()
+{
+    memcpy_P(&testVector, &testVectorEd25519_order8, sizeof(TestVector));
+    const TestVector *test = &testVector;
+
+    Ed25519::VerifyKey key;
+    const uint8_t *sigs[2] = { test->signature, testVectorEd25519_1.signature };
+    const uint8_t *keys[2] = { test->publicKey, test->publicKey };
+    const void *msgs[2] = { test->message, "" };
+    size_t lens[2] = { test->len, 0 };
+
+    Serial.print(test->name);
+    Serial.print(" ... ");
+    bool plain = Ed25519::verify(test->signature, test->publicKey, test->message, test->len);
+    bool prepared = Ed25519::prepareVerifyKey(key, test->publicKey) &&
+                    Ed25519::verify(test->signature, key, test->message, test->len);
+    bool batch = Ed25519::verifyBatch(sigs, keys, msgs, lens, 2);
+    if (plain && prepared && batch) {
+        Serial.println("ok");
+    } else {
+        Serial.println("failed");
+        Serial.print("plain ");
+        Serial.print(plain ? "ok" : "rejected");
+        Serial.print(", prepared ");
+        Serial.print(prepared ? "ok" : "rejected");
+        Serial.print(", batch ");
+        Serial.println(batch ? "ok" : "rejected");
+    }
+}
+
+#define NUM_LIMBS_256BIT (32 / sizeof(limb_t))
+#define NUM_LIMBS_512BIT (64 / sizeof(limb_t))
+
+// Scalars at the edges of the comb: 0, 1, q - 1, q, 2^255 - 1 and every
+// nibble 0xF (so every comb index 15; as an unreduced s in a signature).
+static uint8_t const mulBaseScalars[][32] PROGMEM = {
+    {0x00},
+    {0x01},
+    {0xec, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+     0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10},
+    {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+     0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+     0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}
+};
+
+// The encodings of 0 * B (the neutral element), B and -B.
+static uint8_t const mulBaseExpected[3][32] PROGMEM = {
+    {0x01},
+    {0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+     0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+     0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+     0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66},
+    {0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+     0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+     0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+     0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xe6}
+};
+
+// The comb against the generic double-and-add of s mod q times B.
+void testMulBase()
+{
+    uint8_t scalar[32];
+    uint8_t actual[32];
+    uint8_t expected[32];
+    limb_t s[NUM_LIMBS_256BIT];
+    limb_t t[NUM_LIMBS_512BIT + 1];
+    Ed25519::Point B, P;
+
+    for (uint8_t i = 0; i < sizeof(mulBaseScalars) / 32; ++i) {
+        memcpy_P(scalar, mulBaseScalars[i], 32);
+        Serial.print("mulBase #");
+        Serial.print(i);
+        Serial.print(" ... ");
+
+        BigNumberUtil::unpackLE(s, NUM_LIMBS_256BIT, scalar, 32);
+        Ed25519::mulBase(P, s);
+        Ed25519::encodePoint(actual, P);
+
+        if (i < 3) {
+            memcpy_P(expected, mulBaseExpected[i], 32);
+        } else {
+            memcpy_P(expected, mulBaseExpected[1], 32);
+            Ed25519::decodePoint(B, expected);
+            memset(t, 0, sizeof(t));
+            memcpy(t, s, sizeof(s));
+            Ed25519::reduceQ(s, t);
+            Ed25519::mul(P, s, B);
+            Ed25519::encodePoint(expected, P);
+        }
+        if (memcmp(actual, expected, 32) == 0) {
+            Serial.println("ok");
+        } else {
+            Serial.println("failed");
+            printNumber("actual  ", actual, 32);
+            printNumber("expected", expected, 32);
+        }
+    }
+}
+
+// A batch of messages from the three keys, signed here (so through the
+// comb); then with each signature in turn spoiled. Exactly one bad one
+// must fail the batch.
+void testBatch()
+{
+    static TestVector const *const vectors[3] = {
+        &testVectorEd25519_1, &testVectorEd25519_2, &testVectorEd25519_3
+    };
+    static TestVector keys[3];
+    uint8_t signatures[9][64];
+    char messages[9][8];
+    const uint8_t *sigs[9];
+    const uint8_t *pubs[9];
+    const void *msgs[9];
+    size_t lens[9];
+
+    for (uint8_t i = 0; i < 3; ++i)
+        memcpy_P(&keys[i], vectors[i], sizeof(TestVector));
+    for (uint8_t i = 0; i < 9; ++i) {
+        const TestVector *key = &keys[i % 3];
+        snprintf(messages[i], sizeof(messages[i]), "batch %d", i);
+        Ed25519::sign(signatures[i], key->privateKey, key->publicKey,
+                      messages[i], strlen(messages[i]));
+        sigs[i] = signatures[i];
+        pubs[i] = key->publicKey;
+        msgs[i] = messages[i];
+        lens[i] = strlen(messages[i]);
+    }
+
+    Serial.print("Ed25519 batch of 9, 3 keys ... ");
+    Serial.flush();
+    unsigned long start = micros();
+    bool verified = Ed25519::verifyBatch(sigs, pubs, msgs, lens, 9);
+    unsigned long elapsed = micros() - start;
+    Serial.print(verified ? "ok" : "failed");
+    Serial.print(" (elapsed ");
+    Serial.print(elapsed);
+    Serial.println(" us)");
+
+    Serial.print("Ed25519 batch of 9, one bad ... ");
+    bool ok = true;
+    for (uint8_t i = 0; i < 9; ++i) {
+        signatures[i][i % 2 ? 5 : 37] ^= 0x10;   // In R or in s.
+        if (Ed25519::verifyBatch(sigs, pubs, msgs, lens, 9)) {
+            Serial.print("#");
+            Serial.print(i);
+            Serial.print(" passed ");
+            ok = false;
+        }
+        signatures[i][i % 2 ? 5 : 37] ^= 0x10;
+    }
+    Serial.println(ok ? "ok" : "failed");
+
+    Serial.print("Ed25519 batch of 9, wrong key ... ");
+    pubs[4] = keys[0].publicKey;
+    if (Ed25519::verifyBatch(sigs, pubs, msgs, lens, 9))
+        Serial.println("failed");
+    else
+        Serial.println("ok");
 }
 
 void setup()
@@ -178,6 +432,12 @@ void setup()
     // Perform the tests.
     testFixedVectors();
     Serial.println();
+    testCofactor();
+    Serial.println();
+    testMulBase();
+    Serial.println();
+    testBatch();
+    Serial.println();
 }
 
 void loop()
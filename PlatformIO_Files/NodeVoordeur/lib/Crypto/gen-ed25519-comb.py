@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+#
+# Generates Ed25519Comb.h; the fixed-base comb table that Ed25519::mulBase()
+# uses for r * B when signing (and a * B for deriving a public key).
+#
+#   python3 gen-ed25519-comb.py > Ed25519Comb.h
+#
+# Two combs of 4 teeth, 64 bits apart; comb j, entry i (i = 0..15) is
+#
+#   sum over k = 0..3 of bit k of i * 2^(64 * k + 32 * j) * B
+#
+# as (y + x, y - x, 2 * d * x * y) with z = 1. Entry 0 is the neutral
+# point; so the constant-time lookup needs no special case.
+#
+p = 2**255 - 19
+d = -121665 * pow(121666, p - 2, p) % p
+
+def inv(x):
+    return pow(x, p - 2, p)
+
+def add(P, Q):
+    (x1, y1), (x2, y2) = P, Q
+    t = d * x1 * x2 * y1 * y2 % p
+    return ((x1 * y2 + y1 * x2) * inv(1 + t) % p,
+            (y1 * y2 + x1 * x2) * inv(1 - t) % p)
+
+def mul(n, P):
+    R = (0, 1)
+    while n:
+        if n & 1:
+            R = add(R, P)
+        P = add(P, P)
+        n >>= 1
+    return R
+
+def base():
+    y = 4 * inv(5) % p
+    xx = (y * y - 1) * inv(d * y * y + 1) % p
+    x = pow(xx, (p + 3) // 8, p)
+    if (x * x - xx) % p:
+        x = x * pow(2, (p - 1) // 4, p) % p
+    if x & 1:
+        x = p - x
+    return (x, y)
+
+def limbs(n):
+    words = [(n >> (64 * i)) & (2**64 - 1) for i in range(4)]
+    return ', '.join('LIMB_PAIR(0x%08X, 0x%08X)' % (w & 0xFFFFFFFF, w >> 32) for w in words)
+
+B = base()
+print('// Generated by gen-ed25519-comb.py; do not edit.')
+print('//')
+print('// Fixed-base comb for Ed25519::mulBase(); 2 combs of 16 entries, each')
+print('// (y + x, y - x, 2 * d * x * y) of a sum of multiples of the base point.')
+print('//')
+print('static limb_t const combB[2][16][3][NUM_LIMBS_256BIT] PROGMEM = {')
+for j in range(2):
+    teeth = [mul(2**(64 * k + 32 * j), B) for k in range(4)]
+    print('    {')
+    for i in range(16):
+        P = (0, 1)
+        for k in range(4):
+            if i >> k & 1:
+                P = add(P, teeth[k])
+        x, y = P
+        print('        { // %d' % i)
+        for v in ((y + x) % p, (y - x) % p, 2 * d * x * y % p):
+            print('            { %s },' % limbs(v))
+        print('        },')
+    print('    },')
+print('};')
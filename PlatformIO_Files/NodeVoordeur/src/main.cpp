@@ -151,8 +151,6 @@ unsigned long rejectedCards = 0;
 // For storing the local IP address of the node
 IPAddress theLocalIPAddress;
 
-unsigned long lastCheckNFCReaderTime = 0;
-
 void checkClearEEPromAndCacheButtonPressed(void) {
   unsigned long ButtonPressedTime;
   unsigned long currentSecs;
@@ -279,7 +277,7 @@ void setup() {
   });
 
   node.set_report_period(20 * 1000);
-  node.onReport([](JsonObject  & report) {
+  node.onReport([](ACReport & report) {
     report["state"] = state[machinestate].label;
 
 #ifdef OTA_PASSWD
@@ -343,23 +341,19 @@ void setup() {
 #ifndef ESP32_PoE
   node.begin();
 #endif
+
+  if (USE_NFC_RFID_CARD)
+    node.every("nfccheck", CHECK_NFC_READER_AVAILABLE_TIME_WINDOW, []() {
+      Serial.print("Check Reader Available\n\r");
+      checkNFCReaderAvailable();
+    });
+
   Log.println("Booted: " __FILE__ " " __DATE__ " " __TIME__ );
 }
 
-unsigned long now;
-
 void loop() {
   node.loop();
 
-  if (USE_NFC_RFID_CARD) {
-    now = millis();
-    if ((now - lastCheckNFCReaderTime) > CHECK_NFC_READER_AVAILABLE_TIME_WINDOW) {
-      lastCheckNFCReaderTime = now;
-      Serial.print("Check Reader Available\n\r");
-      checkNFCReaderAvailable();
-    }
-  }
-
   if (laststate != machinestate) {
     Debug.printf("Changed from state <%s> to state <%s>\n",
                  state[laststate].label, state[machinestate].label);